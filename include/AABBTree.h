@@ -0,0 +1,103 @@
+/// \file AABBTree.h
+/// \author plo
+/// \brief A dynamic bounding volume tree for finding what overlaps a box
+///
+/// A uniform grid is great when everything is about the same size, but
+/// levels that mix tiny bullets with bosses and wide platforms either end
+/// up with huge entities spanning dozens of cells or tiny ones crammed
+/// into a few. An AABB tree doesn't care about size: every leaf is a box
+/// with some data attached, and every other node is the box around its two
+/// children, so a query only walks down branches that overlap it.
+///
+/// Leaves are "fat" - padded by a margin - so something that moves a
+/// little stays inside its leaf and the tree is left alone. New leaves are
+/// placed next to whatever sibling grows the tree's surface area the least,
+/// and nodes are rotated on the way back up whenever swapping a child with
+/// a grandchild makes the tree cheaper to query, which keeps it balanced
+/// without ever rebuilding it.
+///
+/// Worlds use this when their broadphase is set to bp_AABBTree (see
+/// jamWorldSetBroadphase), but it works just fine on its own.
+#pragma once
+#include "Constants.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// \brief Called for everything a query finds, returning false stops the query
+typedef bool (*JamAABBTreeCallback)(void* data, void* userData);
+
+/// \brief A single box in the tree, either a leaf with data or the box around two children
+typedef struct {
+	double x1;   ///< Left of the (fat, for leaves) box
+	double y1;   ///< Top of the (fat, for leaves) box
+	double x2;   ///< Right of the (fat, for leaves) box
+	double y2;   ///< Bottom of the (fat, for leaves) box
+	void* data;  ///< Whatever the leaf represents (NULL for branches)
+	int parent;  ///< Parent node or AABB_TREE_NULL for the root (next free node if this is free)
+	int child1;  ///< First child or AABB_TREE_NULL for leaves
+	int child2;  ///< Second child or AABB_TREE_NULL for leaves
+	int height;  ///< 0 for leaves, 1 + the tallest child for branches, and -1 if this node is free
+} JamAABBTreeNode;
+
+/// \brief A dynamic AABB tree
+///
+/// Nodes live in one array and refer to each other by index, so
+/// proxies (leaf indices) stay valid when the array grows.
+typedef struct {
+	JamAABBTreeNode* nodes; ///< Every node, used or not
+	int capacity;           ///< Nodes allocated
+	int count;              ///< Nodes in use
+	int root;               ///< Root node or AABB_TREE_NULL if the tree is empty
+	int freeList;           ///< First unused node
+	double margin;          ///< How much leaves are padded by on every side
+} JamAABBTree;
+
+/// \brief Creates an empty tree
+/// \param margin How far to pad leaves on every side so small movements don't change the tree
+/// \throws ERROR_ALLOC_FAILED
+JamAABBTree* jamAABBTreeCreate(double margin);
+
+/// \brief Puts a box in the tree
+/// \return Returns the leaf's proxy to move or remove it with later, or AABB_TREE_NULL if it could not be added
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_REALLOC_FAILED
+int jamAABBTreeInsert(JamAABBTree* tree, void* data, double x1, double y1, double x2, double y2);
+
+/// \brief Takes a leaf out of the tree
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_OUT_OF_BOUNDS
+void jamAABBTreeRemove(JamAABBTree* tree, int proxy);
+
+/// \brief Tells the tree where a leaf's box is now
+///
+/// Nothing happens if the new box is still inside the leaf's fat box,
+/// otherwise the leaf is taken out and put back in with a new fat box.
+/// The proxy is the same either way.
+///
+/// \return Returns true if the leaf had to be moved in the tree
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_OUT_OF_BOUNDS
+bool jamAABBTreeMove(JamAABBTree* tree, int proxy, double x1, double y1, double x2, double y2);
+
+/// \brief Calls a function with the data of every leaf whose fat box overlaps (or touches) a box
+///
+/// The order leaves are found in only depends on the shape of the tree,
+/// so querying the same box twice without changing the tree finds the
+/// same leaves in the same order. Don't change the tree from the callback.
+///
+/// \throws ERROR_NULL_POINTER
+void jamAABBTreeQuery(JamAABBTree* tree, double x1, double y1, double x2, double y2, JamAABBTreeCallback callback, void* userData);
+
+/// \brief Gets the height of the tree (0 if it is empty or just one leaf)
+/// \throws ERROR_NULL_POINTER
+int jamAABBTreeGetHeight(JamAABBTree* tree);
+
+/// \brief Frees a tree (not whatever its leaves' data points to)
+void jamAABBTreeFree(JamAABBTree* tree);
+
+#ifdef __cplusplus
+}
+#endif
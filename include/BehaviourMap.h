@@ -11,6 +11,7 @@ extern "C" {
 
 struct _JamWorld;
 struct _JamEntity;
+struct _JamMessage;
 
 ///< The arguments that must be present in every behaviour function
 #define BEHAVIOUR_ARGUMENTS struct _JamWorld* world, struct _JamEntity*
@@ -25,6 +26,10 @@ typedef struct {
 	void (*onDestruction)(BEHAVIOUR_ARGUMENTS); ///< Will be executed when this is freed from a world
 	void (*onFrame)(BEHAVIOUR_ARGUMENTS); ///< Will be executed during each frame
 	void (*onDraw)(BEHAVIOUR_ARGUMENTS); ///< Will be executed in place of normal world drawing functionality
+	void (*onMessage)(BEHAVIOUR_ARGUMENTS, struct _JamMessage*); ///< Will be executed for each message posted to this entity (see Message.h)
+	void (*onCollisionEnter)(BEHAVIOUR_ARGUMENTS, struct _JamEntity* other); ///< Will be executed the frame this entity starts touching another (see Contact.h)
+	void (*onCollisionStay)(BEHAVIOUR_ARGUMENTS, struct _JamEntity* other); ///< Will be executed every following frame it is still touching it
+	void (*onCollisionExit)(BEHAVIOUR_ARGUMENTS, struct _JamEntity* other); ///< Will be executed the frame it stops touching it
 } JamBehaviour;
 
 /// \brief A dictionary of strings to behaviours
@@ -42,6 +47,9 @@ JamBehaviourMap* jamBehaviourMapCreate();
 /// 
 /// If the entity doesn't need a behaviour for onCreation, for example,
 /// you can just leave it as NULL and nothing will be executed on creation.
+/// `onMessage` and the `onCollision` functions always start as NULL, set
+/// them on the behaviour from jamBehaviourMapGet if you want the entities
+/// to receive messages or collision events.
 /// 
 /// \warning Strings passed to this function belong to the caller, not the map (It expects just in-code strings)
 /// \throws ERROR_NULL_POINTER
@@ -0,0 +1,144 @@
+/// \file Component.h
+/// \author plo
+/// \brief Optional archetype-based component storage for worlds
+///
+/// Behaviours can keep all of their per-entity state in `JamEntity::data`,
+/// but that means one allocation per entity and a pointer to chase every
+/// time it is touched. Components are an opt-in alternative: you register
+/// plain-old-data component types once, then attach them to entities that
+/// live in a world. The world stores each unique set of components (an
+/// archetype) as a table of tightly packed arrays, one array per component,
+/// so a system that wants "every entity with Position, Velocity, and Enemy"
+/// can iterate straight through memory.
+///
+/// Entities still work exactly like they always have, components are just
+/// extra data that is tied to them. This means entities loaded from .ini
+/// and .tmx files work as usual, and they may even request components from
+/// either file (see the `components` key in the asset handler docs).
+#pragma once
+#include "Constants.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct _JamWorld;
+struct _JamEntity;
+
+/// \brief A set of components, where each bit represents one registered component id
+typedef uint32 JamComponentMask;
+
+///< Converts a component id into its bit in a JamComponentMask
+#define COMPONENT_BIT(id) ((JamComponentMask)1 << (uint32)(id))
+
+/// \brief A table of entities that all have the exact same set of components
+///
+/// Each column is a packed array of `size` components of whatever
+/// type that column represents, and row `i` of every column belongs
+/// to `entities[i]`. Columns for components not in `mask` are NULL.
+///
+/// \warning Tables are moved around in memory whenever components are
+/// added or removed in the world, so don't hold on to column pointers
+/// or component pointers across those calls.
+typedef struct {
+	JamComponentMask mask;                 ///< Which components this archetype holds
+	uint32 size;                           ///< Number of entities (rows) in this table
+	uint32 capacity;                       ///< Rows allocated in each column
+	struct _JamEntity** entities;          ///< The entity that owns each row
+	uint8* columns[MAX_COMPONENTS];        ///< One packed array per component in mask
+} JamArchetype;
+
+/// \brief Registers a component type to be used by every world
+///
+/// Component types are global and should be registered before you
+/// load any assets that request them. Registering a name that already
+/// exists simply returns the old id (as long as the size is the same).
+///
+/// \param name Name of the component (the string belongs to the caller, use in-code strings)
+/// \param size Size of the component in bytes (usually sizeof(MyComponent))
+/// \return Returns the component's id or -1 if it could not be registered
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_OUT_OF_BOUNDS
+/// \throws ERROR_INCORRECT_FORMAT
+int jamComponentRegister(const char* name, uint32 size);
+
+/// \brief Finds a registered component's id from its name, returns -1 if it does not exist
+int jamComponentFind(const char* name);
+
+/// \brief Builds a component mask from a list of names in the form `Name1,Name2,...`
+///
+/// This is what the asset handler and tmx loader use to read the
+/// `components` keys/properties.
+///
+/// \throws ERROR_ASSET_NOT_FOUND
+JamComponentMask jamComponentMaskFromString(const char* names);
+
+/// \brief Adds a component to an entity that is in a world and returns it
+///
+/// The new component is zeroed. If the entity already has this component,
+/// it is left alone and the existing one is returned.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_OUT_OF_BOUNDS
+/// \throws ERROR_INCORRECT_FORMAT
+/// \throws ERROR_REALLOC_FAILED
+void* jamComponentAdd(struct _JamWorld* world, struct _JamEntity* entity, int id);
+
+/// \brief Removes a component from an entity in a world
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_OUT_OF_BOUNDS
+/// \throws ERROR_REALLOC_FAILED
+void jamComponentRemove(struct _JamWorld* world, struct _JamEntity* entity, int id);
+
+/// \brief Gets one of an entity's components or NULL if it doesn't have it
+/// \throws ERROR_NULL_POINTER
+void* jamComponentGet(struct _JamWorld* world, struct _JamEntity* entity, int id);
+
+/// \brief Finds the next archetype in a world that has at least the components in mask
+///
+/// This is meant to be looped, for example
+///
+///     uint32 iterator = 0;
+///     JamArchetype* arch;
+///     while ((arch = jamComponentQuery(world, COMPONENT_BIT(POS) | COMPONENT_BIT(VEL), &iterator)) != NULL) {
+///         Position* pos = jamComponentColumn(arch, POS);
+///         Velocity* vel = jamComponentColumn(arch, VEL);
+///         for (i = 0; i < arch->size; i++) {
+///             pos[i].x += vel[i].x;
+///             pos[i].y += vel[i].y;
+///         }
+///     }
+///
+/// Empty archetypes are skipped.
+///
+/// \param iterator Where to start looking, set it to 0 before the first call
+/// \return Returns the next matching archetype or NULL once there are none left
+///
+/// \throws ERROR_NULL_POINTER
+JamArchetype* jamComponentQuery(struct _JamWorld* world, JamComponentMask mask, uint32* iterator);
+
+/// \brief Gets the packed array of a specific component from an archetype (or NULL)
+/// \throws ERROR_NULL_POINTER
+void* jamComponentColumn(JamArchetype* archetype, int id);
+
+/// \brief Places an entity that was just added to a world into the table for its requested components
+///
+/// Worlds call this automatically when an entity is added to them.
+///
+/// \warning This is for in-engine use
+void _jamComponentAttach(struct _JamWorld* world, struct _JamEntity* entity);
+
+/// \brief Removes an entity's row from its table, used when the world destroys an entity
+///
+/// \warning This is for in-engine use
+void _jamComponentDetach(struct _JamWorld* world, struct _JamEntity* entity);
+
+/// \brief Frees all of a world's component tables
+///
+/// \warning This is for in-engine use
+void _jamComponentFreeTables(struct _JamWorld* world);
+
+#ifdef __cplusplus
+}
+#endif
@@ -25,15 +25,78 @@ typedef signed long long sint64;
 #define ENTITY_LIST_ALLOCATION_AMOUNT 5
 #define MAX_TILEMAPS 5
 
+///< Maximum number of component types that can be registered (JamComponentMask is 32 bits)
+#define MAX_COMPONENTS 32
+
+///< How many frames a world with autoTuneGrid enabled waits between checking its spatial map
+#define GRID_TUNE_INTERVAL 300
+
+///< Smallest cell size (in pixels) a world will pick on its own when tuning its spatial map
+#define GRID_TUNE_MIN_CELL 8
+
+///< How far (in pixels) a world's AABB tree pads entity boxes so small movements don't have to touch the tree
+#define AABB_TREE_MARGIN 8
+
+///< Node index for nothing in an AABB tree (also what entities not in a tree have as their proxy)
+#define AABB_TREE_NULL (-1)
+
+///< How deep an AABB tree query goes before it has to allocate a bigger stack
+#define AABB_TREE_STACK_SIZE 64
+
+///< Bytes of user data each JamMessage can carry
+#define MESSAGE_PAYLOAD_SIZE 32
+
+///< How many messages fit in each block of a thread's message queue
+#define MESSAGE_BLOCK_SIZE 256
+
+///< Most steps GJK will take looking for the origin before giving up on a collision
+#define GJK_MAX_ITERATIONS 32
+
+///< Most points EPA will add while looking for the shortest way out of a collision
+#define EPA_MAX_ITERATIONS 32
+
+///< How close (in pixels) EPA needs to get to the real penetration depth before it stops
+#define EPA_TOLERANCE 0.0001
+
+///< Collision layer entities start on
+#define COLLISION_LAYER_DEFAULT 1
+
+///< Collision mask entities start with (they collide with every layer)
+#define COLLISION_MASK_ALL 0xffffffff
+
+///< Pixels with at least this much alpha are solid in pixel masks
+#define PIXEL_MASK_ALPHA 128
+
+///< How many of a grid cell's boxes jamWorldEntityCollision tests at once (multiple of 32)
+#define COLLISION_BATCH_SIZE 64
+
 ///< The file that error messages will be output to
 #define LOG_FILENAME "jamerrorlog.txt"
 
-///< This is the maximum number vertices jamCheckMapCollision is allowed to check
-#define MAX_GRID_VERTICES 16
-
 ///< Maximum number of cells to check when calling jamSnapEntityToTileMap* as to prevent an infinite loop
 #define MAX_GRID_CHECKS 5
 
+///< Width and height (in tiles) of the pieces tile maps are cached in for jamDrawTileMapCached
+#define TILEMAP_CHUNK_SIZE 16
+
+///< Most tiles jamDrawTileMap sends to SDL in one call (only with SDL 2.0.18 or newer)
+#define TILEMAP_BATCH_SIZE 256
+
+///< Tile maps with at least this many tiles are auto-tiled on multiple threads
+#define TILEMAP_AUTO_PARALLEL_CELLS 262144
+
+///< Most threads jamTileMapAuto will use
+#define TILEMAP_AUTO_THREADS 4
+
+///< Width and height (in tiles) of the pages new paged tile maps are split into
+#define PAGED_TILEMAP_PAGE_SIZE 64
+
+///< How many paths a pathfinder remembers
+#define PATHFINDING_CACHE_SIZE 64
+
+///< Most requests a pathfinder can have waiting at once (must be a power of two)
+#define PATHFINDING_QUEUE_SIZE 64
+
 ///< The ID of an entity not within a world
 #define ID_NOT_ASSIGNED (-1)
 
@@ -0,0 +1,65 @@
+/// \file Contact.h
+/// \author plo
+/// \brief Collision enter/stay/exit events for entities in a world
+///
+/// Pickups, hazards, doors, and other triggers usually only care about
+/// when something starts or stops touching them, but finding that out
+/// with jamWorldEntityCollision means querying every frame and keeping
+/// track of who was there last time yourself. Instead, a world can do
+/// that for you: any entity whose behaviour has `onCollisionEnter`,
+/// `onCollisionStay`, or `onCollisionExit` set has its contacts worked
+/// out once every entity has been processed, compared against last frame's
+/// contacts, and the differences handed to those functions.
+///
+/// Contacts follow the same rules as jamWorldEntityCollision (including
+/// collision layers), so they are one-way: an entity is only told about
+/// things on layers in its own mask. Pairs that were touching last frame
+/// and where neither entity has moved, rotated, scaled, or swapped its
+/// sprite or hitbox (or frame, for pixel masks) since are kept without
+/// checking their hitboxes again.
+#pragma once
+#include "Constants.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct _JamWorld;
+struct _JamEntity;
+
+/// \brief Internal state of a world's contacts
+typedef struct _JamContactCache JamContactCache;
+
+/// \brief Finds every contact in a world and calls the enter/stay/exit behaviour functions
+///
+/// jamWorldProcFrame calls this on its own once every entity has been
+/// processed. Behaviour functions are called after every contact has been
+/// found, so they are free to move or destroy entities.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_REALLOC_FAILED
+void jamWorldUpdateContacts(struct _JamWorld* world);
+
+/// \brief Checks if an entity was touching another as of the last contact update
+///
+/// This only knows about entities whose behaviours have one of the
+/// collision functions, for anything else use jamEntityCheckCollision.
+///
+/// \throws ERROR_NULL_POINTER
+bool jamWorldInContact(struct _JamWorld* world, struct _JamEntity* entity, struct _JamEntity* other);
+
+/// \brief Creates a contact cache for a world
+/// \warning This is for in-engine use
+JamContactCache* _jamContactCacheCreate();
+
+/// \brief Drops every contact with an entity that is about to be freed, calling onCollisionExit for whoever was touching it
+/// \warning This is for in-engine use
+void _jamContactCacheForget(struct _JamWorld* world, struct _JamEntity* entity);
+
+/// \brief Frees a world's contact cache
+/// \warning This is for in-engine use
+void _jamContactCacheFree(JamContactCache* cache);
+
+#ifdef __cplusplus
+}
+#endif
@@ -8,6 +8,7 @@
 #include "Constants.h"
 #include "Sprite.h"
 #include "TileMap.h"
+#include "PagedTileMap.h"
 #include "Vector.h"
 
 #ifdef __cplusplus
@@ -63,6 +64,13 @@ void jamDrawTexture(JamTexture *texture, sint32 x, sint32 y);
 /// and prepped the map for this function, but you can still do this manually.
 /// If you want the x/yInMapEnd to be the end of the map, just put 0.
 ///
+/// Only the tiles in that range the camera can actually see are drawn, so
+/// there is no need to work out the visible range yourself. With SDL 2.0.18
+/// or newer, every tile using the same texture is sent to SDL as one batch
+/// of quads (TILEMAP_BATCH_SIZE at a time) instead of being copied one by one.
+/// Tiles are culled by their cell, so frames bigger than the map's cells may
+/// pop in at the edges of the screen.
+///
 /// \warning All values in the grid must the sprite's frame + 1 (for example,
 /// frame 0 should be 1 in the grid). This is so zero is still considered empty
 /// in the grid itself.
@@ -70,6 +78,34 @@ void jamDrawTexture(JamTexture *texture, sint32 x, sint32 y);
 void jamDrawTileMap(JamTileMap *tileMap, int x, int y, uint32 xInMapStart, uint32 yInMapStart,
 					uint32 xInMapFinish, uint32 yInMapFinish);
 
+/// \brief Draws a tile map from textures of its chunks, only redrawing chunks that changed
+///
+/// The map is split into TILEMAP_CHUNK_SIZE by TILEMAP_CHUNK_SIZE tile chunks,
+/// and each one is drawn onto its own texture the first time it is needed. After
+/// that, drawing the map is one copy per chunk the camera can see, and only
+/// chunks with tiles changed through jamTileMapSet (or every chunk after
+/// jamTileMapRefresh) are drawn again. Chunks without any tiles are never given
+/// a texture.
+///
+/// Tiles are clipped to their chunk, so frames bigger than the map's cells will
+/// be cut off at chunk edges. If textures can't be rendered to, the chunk's tiles
+/// are just drawn one at a time.
+///
+/// \throws ERROR_NULL_POINTER
+void jamDrawTileMapCached(JamTileMap *tileMap, int x, int y);
+
+/// \brief Draws the pages of a paged tile map the camera can see, loading them if needed
+///
+/// Each page is drawn with jamDrawTileMapCached, so a page's chunk textures
+/// stay around until the page is thrown out. When drawing to something other
+/// than the screen buffer every page is drawn, which loads the whole map, so
+/// it is best to only do that with small maps. The map's page budget should
+/// be at least the number of pages the camera can see at once or pages will
+/// be loaded and thrown out every frame.
+///
+/// \throws ERROR_NULL_POINTER
+void jamDrawPagedTileMap(JamPagedTileMap *map, int x, int y);
+
 /// \breif Draws a texture to the current target with a bunch of extra preferences
 /// \param scaleX The x scale of the texture, 1 for normal
 /// \param scaleY The y scale of the texture, 1 for normal
@@ -12,6 +12,7 @@
 #include "Hitbox.h"
 #include "TileMap.h"
 #include "BehaviourMap.h"
+#include "Component.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -19,6 +20,42 @@ extern "C" {
 
 struct _JamTMXData;
 
+/// \brief An entity's hitbox and visible bounds with its rotation and scale applied
+///
+/// Everything here is relative to the entity's x/y, so it only has to
+/// be worked out again when something other than the position changes.
+/// Entities that aren't rotated or scaled never use this. It is only
+/// ever rebuilt by jamEntityUpdateHitbox, so collision checks just read it.
+typedef struct {
+	JamHitbox hitbox;      ///< The rotated/scaled hitbox
+	JamPolygon* polygon;   ///< Polygon owned by hitbox when rotation turns it into one
+	double hitboxX;        ///< Where hitbox sits relative to the entity's x
+	double hitboxY;        ///< Where hitbox sits relative to the entity's y
+	double x1;             ///< Left of the visible bounds relative to x
+	double y1;             ///< Top of the visible bounds relative to y
+	double x2;             ///< Right of the visible bounds relative to x
+	double y2;             ///< Bottom of the visible bounds relative to y
+	bool valid;            ///< Weather or not the entity was rotated or scaled (and this is in use) as of the last update
+	JamHitbox* source;     ///< The entity's hitbox when this was cached
+	JamSprite* sprite;     ///< The entity's sprite when this was cached
+	double rot;            ///< The entity's rotation when this was cached
+	double scaleX;         ///< The entity's x scale when this was cached
+	double scaleY;         ///< The entity's y scale when this was cached
+	double offsetX;        ///< The entity's hitbox x offset when this was cached
+	double offsetY;        ///< The entity's hitbox y offset when this was cached
+} JamEntityTransform;
+
+/// \brief A way to refer to an entity in a world that goes stale once the entity is gone
+///
+/// Worlds hand the ids of removed entities out again, so an id on its own
+/// can end up pointing at whatever was added after. Every entity a world
+/// adds gets its own generation as well, so a handle to an entity that is
+/// gone never matches the one that took its id. See jamWorldFindEntityHandle.
+typedef struct {
+	int id;            ///< The entity's id in its world (ID_NOT_ASSIGNED if it isn't in one)
+	uint32 generation; ///< The entity's generation in its world
+} JamEntityHandle;
+
 /// \brief Defines an in-game entity
 ///
 /// Since all drawing/hitbox functions are done with ints
@@ -27,14 +64,29 @@ struct _JamTMXData;
 /// same way. In other words, it is guaranteed that entities
 /// are drawn and collision-tested with the same set of coords.
 ///
+/// Collisions also follow `rot`, `scaleX`, and `scaleY` the same way
+/// the sprite is drawn with them, so a rotated rectangle hitbox becomes
+/// a rotated polygon. Negative scales only flip the sprite and don't
+/// mirror the hitbox.
+///
+/// `collisionLayer` and `collisionMask` let world queries skip pairs
+/// that will never matter without ever touching their hitboxes. When
+/// jamWorldEntityCollision looks for things an entity hits, only entities
+/// whose layer shares a bit with the entity's mask are considered. For
+/// example, bullets on layer 4 with a mask of ~4 never look at other bullets.
+///
 /// \warning Do not change/use the following variables: `xPrev`,
-/// `yPrev`, `procs`, and `cells`. These variables are required
-/// by whatever world this entity belongs to and changing them
-/// could very easily cause dangling pointers and segfaults.
+/// `yPrev`, `procs`, `cells`, `placed`, `treeProxy`, `archetype`, `archetypeRow`, `spawnNext`, `generation`, and `transform`. These
+/// variables are required by whatever world this entity belongs to and
+/// changing them could very easily cause dangling pointers and segfaults.
+/// Likewise, once an entity is in a world only change `components`
+/// through the functions in Component.h.
 typedef struct _JamEntity {
 	JamSprite* sprite;       ///< This entity's sprite (NULL is safe)
 	JamHitbox* hitbox;       ///< This entity's hitbox (NULL is safe)
 	uint32 type;             ///< Type of entity this is
+	uint32 collisionLayer;   ///< Layer bits this entity is on (COLLISION_LAYER_DEFAULT by default)
+	uint32 collisionMask;    ///< Layer bits this entity checks for collisions against (COLLISION_MASK_ALL by default)
 	double x;                ///< X position in the game world
 	double y;                ///< Y position in the game world
 	JamBehaviour* behaviour; ///< Behaviour mapping of this entity (AssetManagers will resolve this)
@@ -42,6 +94,7 @@ typedef struct _JamEntity {
 	double hitboxOffsetY;    ///< The hitbox's offset from the entity, this ignore the sprite's origin
 	void* data;              ///< A place for the programmer to store their own variables and such
 	int id;                  ///< The ID of this entity (assigned by whatever world this entity belongs to)
+	uint32 generation;       ///< Tells this entity apart from others that had the same id (assigned along with it)
 
 	// Drawing control
 	double rot;          ///< The rotation of the entity when drawn
@@ -60,9 +113,16 @@ typedef struct _JamEntity {
 	uint32 cells;                   ///< How many cells this entity is in in the world map
 	int cellsIn[4];                 ///< The specific cells this entity is in
 	int cellsLoc[4];                ///< Where in the entity list this entity is
+	double placed[4];               ///< The visible box (x1, y1, x2, y2) this entity was last sorted into the world with
+	int treeProxy;                  ///< This entity's leaf in the world's AABB tree (AABB_TREE_NULL if it isn't in one)
 	volatile bool inCache;          ///< Weather or not this specific entity is in entity cache
 	bool destroy;                   ///< Weather or not this entity will be destroyed the next time its processed
 	struct _JamTMXData* properties; ///< Data potentially imported from a .tmx file or NULL
+	JamComponentMask components;    ///< Components this entity has (or will be given once its added to a world)
+	int archetype;                  ///< The component table this entity is in (-1 if none)
+	uint32 archetypeRow;            ///< Where in the component table this entity is
+	struct _JamEntity* spawnNext;   ///< Next entity in a world's spawn queue
+	JamEntityTransform transform;   ///< Cached rotated/scaled hitbox and bounds
 
 	// Utilities not utilized by the engine
 	double hSpeed;   ///< Horizontal speed
@@ -80,6 +140,10 @@ JamEntity* jamEntityCreate(JamSprite *sprite, JamHitbox *hitbox, double x, doubl
 /// \throws ERROR_NULL_POINTER
 JamEntity* jamEntityCopy(JamEntity *baseEntity, double x, double y);
 
+/// \brief Gets a handle to an entity that goes stale once the entity is gone from its world
+/// \throws ERROR_NULL_POINTER
+JamEntityHandle jamEntityGetHandle(JamEntity *entity);
+
 /// \brief Primarily for in-engine use, copies an entity to an already existing entity (typically for vectors)
 /// \warning Since this is for in-engine use, it doesn't check for NULL pointers and as such will happily segfault if misused
 void _jamEntityCopyInPlace(JamEntity *baseEntity, JamEntity *inPlaceEntity, double x, double y);
@@ -96,6 +160,25 @@ void jamDrawEntity(JamEntity *entity);
 /// \throws ERROR_INCORRECT_FORMAT
 bool jamEntityCheckCollision(double x, double y, JamEntity *entity1, JamEntity *entity2);
 
+/// \brief Checks if two entities are colliding and how to push entity1 out of entity2
+///
+/// Like jamEntityCheckCollision this uses x/y for entity 1, and if they
+/// collide moving entity 1 by `info->normalX * info->depth` and
+/// `info->normalY * info->depth` from there separates them. Both entities
+/// need hitboxes. See jamHitboxCollisionInfo.
+///
+/// \throws ERROR_NULL_POINTER
+bool jamEntityCollisionInfo(double x, double y, JamEntity *entity1, JamEntity *entity2, JamCollisionInfo *info);
+
+/// \brief Primarily for in-engine use, finds a box that an entity at x/y can't collide outside of
+///
+/// This accounts for rotation/scale and every hitbox type. Entities without
+/// a sprite or hitbox get a box that covers everything, since
+/// jamEntityCheckCollision has its own rules for those.
+///
+/// \warning Since this is for in-engine use, it doesn't check for NULL pointers and as such will happily segfault if misused
+void _jamEntityHitboxBounds(JamEntity *entity, double x, double y, double *x1, double *y1, double *x2, double *y2);
+
 /// \brief Checks if an entity is colliding with a tile map
 ///
 /// This function uses the rx/ry coordinates for the entity, not the entity's x/y
@@ -103,6 +186,25 @@ bool jamEntityCheckCollision(double x, double y, JamEntity *entity1, JamEntity *
 /// \throws ERROR_INCORRECT_FORMAT
 bool jamEntityTileMapCollision(JamEntity *entity, JamTileMap *tileMap, double rx, double ry);
 
+/// \brief Checks if an entity is colliding with a tile map and finds the block of tiles it hit
+///
+/// Just like jamEntityTileMapCollision, but also gives back the block the
+/// entity overlaps (see jamTileMapCollisionRect).
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_INCORRECT_FORMAT
+bool jamEntityTileMapCollisionRect(JamEntity *entity, JamTileMap *tileMap, double rx, double ry, JamTileRect *rect);
+
+/// \brief Moves an entity's hitbox through a tile map by dx/dy and finds where it stops
+///
+/// This does not move the entity, `result->x`/`result->y` are where the
+/// entity's x/y should go. Rotated/scaled entities use the box around
+/// their hitbox like jamEntityTileMapCollision. See jamTileMapSweep.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_INCORRECT_FORMAT
+bool jamEntityTileMapSweep(JamEntity *entity, JamTileMap *tileMap, double dx, double dy, JamTileSweep *result);
+
 /// \brief Sets an entity's x component as close to a tilemap's edge as possible
 ///
 /// `direction` should be either 1 or -1 to represent right and left respectively.
@@ -131,6 +233,22 @@ void jamEntitySnapY(JamEntity *entity, JamTileMap *tilemap, int direction);
 /// \throws ERROR_NULL_POINTER
 void jamEntitySetSprite(JamEntity* ent, JamSprite* spr);
 
+/// \brief Brings an entity's collision data up to date with its rotation, scale, hitbox and sprite
+///
+/// Collision checks only read an entity's rotated/scaled hitbox and its
+/// sprite's pixel masks so any number of threads can check against it
+/// at once, and this is where they get built. Worlds call it every time
+/// they update an entity (right after its onFrame), so you only need it
+/// for entities outside a world or to have a change show up in
+/// collisions before the world gets to the entity.
+///
+/// \warning Don't call this while another thread may be checking
+/// collisions against the same entity.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_ALLOC_FAILED
+void jamEntityUpdateHitbox(JamEntity* entity);
+
 /// \brief Calculates the visible x1 (top-left) of an entity
 /// \param entity Entity to calculate for
 /// \param x x Value to start from (usually just the entity's current x value)
@@ -0,0 +1,91 @@
+/// \file FieldOfView.h
+/// \author plo
+/// \brief Works out which cells of a tile map can be seen from a cell
+///
+/// This uses symmetric shadowcasting, which scans outwards from the viewer
+/// a row at a time in each of the four directions, narrowing the slopes it
+/// scans between as solid tiles cast shadows. It has the useful property
+/// that if an open cell A can see another open cell B, B can see A as well,
+/// so stealth checks work the same both ways. Solid tiles are visible if
+/// any part of them is, so walls don't flicker in and out at the edge of
+/// what can be seen.
+///
+/// Each viewer gets its own JamFieldOfView with a bitset covering the whole
+/// map, which is only worked out again when the viewer moves to another
+/// cell, its radius changes, or the map's revision moves (that is, a tile
+/// changed between solid and empty). Any number of viewers can call
+/// jamFieldOfViewUpdate every frame and only pay for the ones that moved.
+///
+/// For a single check between two cells, jamTileMapLineOfSight is much
+/// cheaper than a whole field of view.
+#pragma once
+#include "Constants.h"
+#include "TileMap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// \brief A row being scanned for a field of view, slopes are kept as fractions so they are exact
+typedef struct {
+	int depth;      ///< How far the row is from the viewer
+	int startNum;   ///< Slope the row starts at (startNum / startDen)
+	int startDen;   ///< Slope the row starts at (startNum / startDen), always positive
+	int endNum;     ///< Slope the row ends at (endNum / endDen)
+	int endDen;     ///< Slope the row ends at (endNum / endDen), always positive
+} JamFieldOfViewRow;
+
+/// \brief Which cells of a tile map can be seen by one viewer
+///
+/// \warning The map must not be freed or resized while this exists.
+typedef struct {
+	JamTileMap* map;          ///< The map being looked at
+	uint32 width;             ///< Width of the map in cells
+	uint32 height;            ///< Height of the map in cells
+	uint32 words;             ///< How many uint64 make up each row of visible
+	uint64* visible;          ///< Bit `x % 64` of `visible[y * words + x / 64]` is set if cell (x, y) can be seen
+
+	int viewerX;              ///< Cell the field of view was worked out from
+	int viewerY;              ///< Cell the field of view was worked out from
+	uint32 radius;            ///< How far the viewer could see (0 for no limit)
+	uint32 revision;          ///< The map's revision when the field of view was worked out
+	bool valid;               ///< Weather or not visible has been worked out at all
+	int left;                 ///< Leftmost visible cell, so only the visible area has to be cleared next time
+	int top;                  ///< Topmost visible cell
+	int right;                ///< Rightmost visible cell (less than left if nothing is visible)
+	int bottom;               ///< Bottommost visible cell
+
+	JamFieldOfViewRow* rows;  ///< Rows waiting to be scanned
+	uint32 rowCount;          ///< Rows waiting to be scanned
+	uint32 rowCapacity;       ///< Rows there's room for
+} JamFieldOfView;
+
+/// \brief Creates a field of view for a tile map with nothing visible
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_ALLOC_FAILED
+JamFieldOfView* jamFieldOfViewCreate(JamTileMap *map);
+
+/// \brief Works out what can be seen from a cell, unless it was already worked out
+/// \param fov Field of view to update
+/// \param x Cell the viewer is in
+/// \param y Cell the viewer is in
+/// \param radius How far the viewer can see in cells (0 for no limit)
+/// \return Returns true if the field of view had to be worked out again, false if it was cached
+///
+/// A viewer outside the map sees nothing. The viewer's own cell is always
+/// visible.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_REALLOC_FAILED
+bool jamFieldOfViewUpdate(JamFieldOfView *fov, int x, int y, uint32 radius);
+
+/// \brief Checks if a cell could be seen as of the last jamFieldOfViewUpdate
+/// \throws ERROR_NULL_POINTER
+bool jamFieldOfViewVisible(JamFieldOfView *fov, int x, int y);
+
+/// \brief Frees a field of view (but not its map)
+void jamFieldOfViewFree(JamFieldOfView *fov);
+
+#ifdef __cplusplus
+}
+#endif
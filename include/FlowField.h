@@ -0,0 +1,148 @@
+/// \file FlowField.h
+/// \author plo
+/// \brief Points every cell of a tile map towards one goal, for crowds heading the same way
+///
+/// Finding a path for each of hundreds of enemies chasing the player is far
+/// too slow. A flow field instead runs one Dijkstra pass out from the goal
+/// that finds how far every cell is from it and which of its 8 neighbours is
+/// the next step on the way. After that any number of agents can look up
+/// which way to go from wherever they are in O(1). Steps follow the same
+/// rules as JamPathfinder: diagonals cost the square root of two and never
+/// cut the corner of a solid tile.
+///
+/// Like the pathfinder, the field works from its own copy of the map's solid
+/// tiles and only looks at the map again when its revision changes. When it
+/// does, only the cells whose way to the goal went through a changed tile
+/// (and those that can now get there faster) are worked out again, so
+/// opening a door doesn't redo the whole map. Changing the goal redoes
+/// everything.
+///
+/// A field can also be made threaded, in which case the pass runs on a
+/// worker thread into a back buffer and jamFlowFieldUpdate swaps it in once
+/// it's done. Agents always sample the front buffer, so they never see a
+/// half finished field and never wait for the worker.
+#pragma once
+#include "Constants.h"
+#include "TileMap.h"
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// \brief Which way to go from every cell of a tile map to get to a goal
+///
+/// \warning The map must not be freed or resized while the field exists.
+typedef struct {
+	JamTileMap* map;      ///< The map the field covers
+	uint32 width;         ///< Width of the map in cells
+	uint32 height;        ///< Height of the map in cells
+	uint32 solidWords;    ///< How many uint64 make up each row of solid
+	uint32 goalX;         ///< Cell everything points to
+	uint32 goalY;         ///< Cell everything points to
+	bool goalChanged;     ///< Weather or not the goal changed since it was last handed to the integration pass
+	uint32 revision;      ///< The map's revision when solid was last handed to the integration pass
+
+	// What agents sample, these are the same as distance/directions if the field isn't threaded
+	float* frontDistance;   ///< How far each cell is from the goal (FLT_MAX if it can't get there)
+	uint8* frontDirections; ///< Which neighbour is the next step from each cell (see jamFlowFieldGet)
+	float* backDistance;    ///< Where the worker puts a finished pass (NULL if not threaded)
+	uint8* backDirections;  ///< Where the worker puts a finished pass (NULL if not threaded)
+
+	// The integration pass, only touched by the worker if the field is threaded
+	uint64* solid;        ///< The solid bits distance and directions were worked out for
+	uint64* incoming;     ///< The solid bits the next pass works them out for
+	uint32 passGoal;      ///< The goal distance and directions were worked out for
+	bool built;           ///< Weather or not distance and directions have been worked out at all
+	float* distance;      ///< How far each cell is from passGoal
+	uint8* directions;    ///< Next step from each cell to passGoal
+	uint32* heap;         ///< Binary heap of cells waiting to pass their distance on
+	uint32* heapPos;      ///< Where each cell is in the heap (or if its not in it)
+	uint32 heapSize;      ///< Cells in the heap
+	uint32* changed;      ///< Cells that lost their way to the goal during an update
+
+	// Worker thread
+	bool threaded;              ///< Weather or not the pass runs on a worker thread
+	uint64* pendingSolid;       ///< Solid bits waiting to be picked up by the worker (NULL if not threaded)
+	uint32 pendingGoal;         ///< Goal waiting to be picked up by the worker
+	bool pending;               ///< Weather or not the worker has something new to pick up
+	bool pendingRebuild;        ///< Weather or not the worker needs to redo everything
+	bool ready;                 ///< Weather or not the back buffer holds a pass that hasn't been swapped in yet
+	bool quit;                  ///< Tells the worker to stop
+	pthread_mutex_t lock;       ///< Protects the pending/ready/quit state and pendingSolid
+	pthread_cond_t signal;      ///< Wakes the worker when there's something new or the back buffer frees up
+	pthread_t worker;           ///< Thread that runs the passes
+	bool workerStarted;         ///< Weather or not the worker is running
+} JamFlowField;
+
+/// \brief Creates a flow field over a tile map
+/// \param map Map the field covers
+/// \param threaded Weather or not to run the integration pass on a worker thread
+///
+/// The field starts with its goal at cell (0, 0) and nothing worked out,
+/// call jamFlowFieldSetGoal then jamFlowFieldUpdate before sampling it.
+/// This allocates about 17 bytes per cell of the map, 27 if threaded.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_ALLOC_FAILED
+JamFlowField* jamFlowFieldCreate(JamTileMap *map, bool threaded);
+
+/// \brief Moves a flow field's goal, which will be worked out on the next jamFlowFieldUpdate
+///
+/// Setting the goal to the cell it's already at does nothing, so this may
+/// be called every frame with wherever the player is.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_OUT_OF_BOUNDS
+void jamFlowFieldSetGoal(JamFlowField *field, uint32 x, uint32 y);
+
+/// \brief Brings a flow field up to date with its goal and its map
+///
+/// If the field isn't threaded the integration pass happens right here.
+/// If it is, this hands the map and goal to the worker and swaps in the
+/// last pass the worker finished (if there is one), so what agents see
+/// lags the map by at least a frame. Call this once a frame.
+///
+/// \throws ERROR_NULL_POINTER
+void jamFlowFieldUpdate(JamFlowField *field);
+
+/// \brief Gets which way to step from a cell to get to the goal
+/// \param field Field to sample
+/// \param x Cell to step from
+/// \param y Cell to step from
+/// \param dx Where to put the x of the step (-1, 0, or 1), can be NULL
+/// \param dy Where to put the y of the step (-1, 0, or 1), can be NULL
+/// \return Returns false if the cell is outside the map or there is no way to the goal from it
+///
+/// The goal itself gives a step of (0, 0).
+///
+/// \throws ERROR_NULL_POINTER
+bool jamFlowFieldGet(JamFlowField *field, int x, int y, int *dx, int *dy);
+
+/// \brief Gets how far a cell is from the goal (in cells), or -1 if it can't get there
+/// \throws ERROR_NULL_POINTER
+double jamFlowFieldDistance(JamFlowField *field, int x, int y);
+
+/// \brief Gets which way to move from a point in the world to get to the goal
+/// \param field Field to sample
+/// \param x X in the world in pixels
+/// \param y Y in the world in pixels
+/// \param dx Where to put the x of the direction, can be NULL
+/// \param dy Where to put the y of the direction, can be NULL
+/// \return Returns false if the point is outside the map or there is no way to the goal from it
+///
+/// This takes the map's xInWorld/yInWorld into account and gives a
+/// direction with a length of 1 (or 0 at the goal) that can be multiplied
+/// by an agent's speed.
+///
+/// \throws ERROR_NULL_POINTER
+bool jamFlowFieldSample(JamFlowField *field, double x, double y, double *dx, double *dy);
+
+/// \brief Stops the worker thread (if any) and frees the field
+///
+/// This does not free the map.
+void jamFlowFieldFree(JamFlowField *field);
+
+#ifdef __cplusplus
+}
+#endif
@@ -5,6 +5,7 @@
 #pragma once
 #include "Constants.h"
 #include "Vector.h"
+#include "PixelMask.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,10 +15,18 @@ extern "C" {
 typedef enum {
 	ht_Circle,
 	ht_Rectangle,
-	ht_ConvexPolygon
+	ht_ConvexPolygon,
+	ht_PixelMask
 } JamHitboxType;
 
 /// \brief An all-encompassing hitbox
+///
+/// Pixel mask hitboxes use width and height as their bounding box and
+/// only collide where their mask has a solid pixel. If mask is NULL,
+/// entities use the mask of their sprite's current frame (shared through
+/// the sprite, see jamPixelMaskFromSprite) and anything else treats it as
+/// a plain rectangle. A mask set here belongs to the hitbox. Pixel masks
+/// are checked in whole pixels, so their positions are rounded.
 typedef struct {
 	JamHitboxType type; ///< What type of hitbox this thing is
 	union {
@@ -26,14 +35,27 @@ typedef struct {
 		struct {
 			double width; ///< For rectangle collisions
 			double height; ///< For rectangle collisions
+			JamPixelMask* mask; ///< For pixel mask collisions
 		};
 	};
 } JamHitbox;
 
+/// \brief How two hitboxes overlap, as filled in by jamHitboxCollisionInfo
+///
+/// Moving the first hitbox by `(normalX * depth, normalY * depth)` puts it
+/// right up against the second one, so resolving a collision only takes
+/// one step instead of inching away a pixel at a time.
+typedef struct {
+	double normalX; ///< X of the unit direction that pushes hitbox 1 out of hitbox 2
+	double normalY; ///< Y of the unit direction that pushes hitbox 1 out of hitbox 2
+	double depth;   ///< How far hitbox 1 needs to move along the normal to stop overlapping
+} JamCollisionInfo;
+
 /// \brief Creates a hitbox
 ///
 /// If you pass a polygon to a hitbox, the polygon now belongs to the
-/// hitbox (It will be freed by the hitbox).
+/// hitbox (It will be freed by the hitbox). Pixel mask hitboxes are
+/// created with a NULL mask and use width/height.
 ///
 /// \throws ERROR_ALLOC_FAILED
 JamHitbox* jamHitboxCreate(JamHitboxType type, double radius, double width, double height, JamPolygon *polygon);
@@ -50,6 +72,41 @@ bool jamHitboxPolygonCollision(JamPolygon *poly1, JamPolygon *poly2, double x1,
 /// \throws ERROR_NULL_POINTER
 bool jamHitboxCollision(JamHitbox *hitbox1, double x1, double y1, JamHitbox *hitbox2, double x2, double y2);
 
+/// \brief Checks for a collision between two hitboxes and works out how deep it is
+///
+/// Any combination of hitboxes works. The collision is found with GJK on the
+/// Minkowski difference of the two hitboxes and EPA then finds the shortest
+/// way out, so this costs more than jamHitboxCollision and should be saved
+/// for when you actually need to resolve the collision. Circles are curved,
+/// so their depth is accurate to a small fraction of a pixel rather than
+/// exact. Pixel masks are treated as their bounding box here.
+///
+/// \param info Where to put the normal and depth, it is left alone if there is no collision
+/// \return Returns true if the hitboxes overlap
+///
+/// \throws ERROR_NULL_POINTER
+bool jamHitboxCollisionInfo(JamHitbox *hitbox1, double x1, double y1, JamHitbox *hitbox2, double x2, double y2, JamCollisionInfo *info);
+
+/// \brief Checks one axis-aligned box against a whole array of them at once
+///
+/// This is meant for weeding out everything that obviously isn't colliding
+/// before doing real hitbox checks. `boxes` is packed as `count` left edges,
+/// then `count` top edges, then `count` right edges, and finally `count`
+/// bottom edges, so 4 (SSE2) or 8 (AVX) boxes can be checked in one go.
+/// Like rectangle hitboxes, boxes that only touch are not overlapping.
+///
+/// \param x1 Left of the box to check
+/// \param y1 Top of the box to check
+/// \param x2 Right of the box to check
+/// \param y2 Bottom of the box to check
+/// \param boxes The boxes to check against, 4 * count floats
+/// \param count How many boxes there are
+/// \param hits Bit i of `hits[i / 32]` is set if box i overlaps, must have room for (count + 31) / 32 values
+/// \return Returns how many boxes overlap
+///
+/// \throws ERROR_NULL_POINTER
+uint32 jamHitboxBatchAABB(float x1, float y1, float x2, float y2, const float *boxes, uint32 count, uint32 *hits);
+
 /// \brief Clears a hitbox from memory
 void jamHitboxFree(JamHitbox *hitbox);
 
@@ -13,6 +13,7 @@
 #include <Clock.h>
 #include <Sprite.h>
 #include <Hitbox.h>
+#include <PixelMask.h>
 #include <Renderer.h>
 #include <Input.h>
 #include <AssetHandler.h>
@@ -21,9 +22,17 @@
 #include <WorldHandler.h>
 #include <World.h>
 #include <TileMap.h>
+#include <PagedTileMap.h>
+#include <Pathfinding.h>
+#include <FlowField.h>
+#include <FieldOfView.h>
 #include <World.h>
 #include <EntityList.h>
 #include <BehaviourMap.h>
+#include <Component.h>
+#include <Message.h>
+#include <Contact.h>
+#include <AABBTree.h>
 #include <TMXWorldLoader.h>
 #include <Audio.h>
 #include <Tweening.h>
@@ -0,0 +1,97 @@
+/// \file Message.h
+/// \author plo
+/// \brief Batched messages between entities in a world
+///
+/// Instead of having an entity reach into another entity's `data` to
+/// tell it something, it can post a message to that entity's handle (see
+/// JamEntityHandle). Messages are small fixed-size structs that are copied
+/// into queues owned by the world and they are held until the world reaches
+/// the end of its frame. At that point every message is sorted by receiver
+/// and handed to the receiver's behaviour's `onMessage` one entity after
+/// another.
+///
+/// Each thread that posts to a world gets a queue of its own the first
+/// time it does, made of blocks of MESSAGE_BLOCK_SIZE messages. Only that
+/// thread writes to the queue and only delivery reads from it, so posting
+/// takes no locks and never waits on another thread (registering a new
+/// thread's queue takes a mutex once). A thread that fills its current
+/// block allocates another, and delivery frees the blocks it has emptied.
+///
+/// This means nothing an entity does in `onFrame` has to touch any other
+/// entity, and a receiver gets all of its mail at once instead of being
+/// poked at random throughout the frame. The trade-off is that messages
+/// always arrive at the end of the frame they were posted in, so don't use
+/// them for things that must happen immediately.
+#pragma once
+#include "Constants.h"
+#include "Entity.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct _JamWorld;
+struct _JamEntity;
+
+/// \brief A single message from one entity to another
+///
+/// The payload is yours to use however you like, but it is copied by
+/// value so don't put anything in it that will be gone by the end of
+/// the frame.
+typedef struct _JamMessage {
+	uint32 type;                        ///< What kind of message this is, its meaning is up to you
+	uint32 size;                        ///< How many bytes of payload were posted
+	JamEntityHandle sender;             ///< Entity that posted this (id of ID_NOT_ASSIGNED if it wasn't an entity), see jamWorldFindEntityHandle
+	JamEntityHandle receiver;           ///< Entity this message is for
+	uint8 payload[MESSAGE_PAYLOAD_SIZE]; ///< Whatever data was posted with the message
+} JamMessage;
+
+/// \brief Internal state of a world's message queues
+typedef struct _JamMessageBus JamMessageBus;
+
+/// \brief Posts a message to an entity in a world
+///
+/// The message will be delivered to the receiver's `onMessage` behaviour
+/// function at the end of the current jamWorldProcFrame (or the next one
+/// if you post outside of it). Messages to entities that are gone from
+/// the world or have no `onMessage` by then are simply dropped, even if
+/// another entity was given the same id in the meantime. This is safe to
+/// call from any thread.
+///
+/// \param world World the receiver is in
+/// \param sender Entity posting the message or NULL if its not from an entity
+/// \param receiver Handle of the entity to post to (see jamEntityGetHandle)
+/// \param type Your own message type
+/// \param payload Data to copy into the message (NULL is fine if size is 0)
+/// \param size Size of the payload in bytes (up to MESSAGE_PAYLOAD_SIZE)
+/// \return Returns true if the message was queued
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_OUT_OF_BOUNDS
+/// \throws ERROR_ALLOC_FAILED
+bool jamWorldPostMessage(struct _JamWorld* world, struct _JamEntity* sender, JamEntityHandle receiver, uint32 type, const void* payload, uint32 size);
+
+/// \brief Delivers every message posted in a world so far
+///
+/// jamWorldProcFrame calls this on its own once every entity has been
+/// processed, you only need it if you want messages delivered at some
+/// other point. Messages posted while delivering are held for the next
+/// delivery.
+///
+/// \warning Only one thread may deliver a world's messages at a time.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_REALLOC_FAILED
+void jamWorldDeliverMessages(struct _JamWorld* world);
+
+/// \brief Creates a message bus for a world
+/// \warning This is for in-engine use
+JamMessageBus* _jamMessageBusCreate();
+
+/// \brief Frees a world's message bus and any messages that were never delivered
+/// \warning This is for in-engine use
+void _jamMessageBusFree(JamMessageBus* bus);
+
+#ifdef __cplusplus
+}
+#endif
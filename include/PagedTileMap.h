@@ -0,0 +1,167 @@
+/// \file PagedTileMap.h
+/// \author plo
+/// \brief Tile maps too big to keep in memory, loaded from disk a page at a time
+///
+/// A regular JamTileMap keeps every tile in memory, which for a 4096x4096
+/// map is 128mb of frame pointers before anything else. A paged tile map
+/// instead splits the map into square pages (PAGED_TILEMAP_PAGE_SIZE tiles
+/// on each side when created) and keeps only the pages that were recently
+/// used in memory. When a page is needed and the map already has its budget
+/// of pages loaded, the page that was used longest ago is written back to
+/// disk (if it was changed) and thrown out. A changed page that can't be
+/// written is kept in memory instead so the changes aren't lost, and if
+/// every page in memory is like that no other pages can be loaded.
+///
+/// On disk tiles are 16-bit numbers where 0 is empty and n is frame n - 1
+/// of the map's tile set, so the file is a quarter the size of the map in
+/// memory. The file starts with this header (all native byte order):
+///
+///  + "JPTM"
+///  + uint32 version (currently 1)
+///  + uint32 width, height, cellWidth, cellHeight (in tiles/pixels)
+///  + uint32 page size (in tiles)
+///
+/// followed by every page, left to right then top to bottom, each being page
+/// size * page size tiles row by row (pages on the right/bottom edges are
+/// padded). The file may end early in which case everything past the end is
+/// empty, so a fresh map's file is only the header.
+///
+/// Each page in memory is an indexed JamTileMap (see jamTileMapCreateIndexed)
+/// whose palette is the tile set, so pages hold the same numbers in memory as
+/// in the file and anything that works on a tile map works on a page as well.
+#pragma once
+#include "Constants.h"
+#include "TileMap.h"
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// \brief A tile map that lives on disk and is loaded in pages as its used
+///
+/// \warning Only ever change tiles through jamPagedTileMapSet, otherwise the
+/// page won't know its been changed and the change will be lost once its thrown out.
+typedef struct {
+	int xInWorld;          ///< X position in the world of the map in cells (for collisions only, drawing ignores this)
+	int yInWorld;          ///< Y position in the world of the map in cells (for collisions only, drawing ignores this)
+	uint32 width;          ///< Map's width in tiles
+	uint32 height;         ///< Map's height in tiles
+	uint32 cellWidth;      ///< Width of any given cell in the map
+	uint32 cellHeight;     ///< Height of any given cell in the map
+	uint32 pageSize;       ///< Width and height of every page in tiles
+	uint32 pagesAcross;    ///< Pages across the map
+	uint32 pagesDown;      ///< Pages down the map
+	JamSprite* tileSet;    ///< Tile n in the file is frame n - 1 of this
+
+	FILE* file;            ///< The file pages come from and go back to
+	bool readOnly;         ///< Weather or not the file could only be opened for reading, in which case tiles can't be set
+	uint16* pageBuffer;    ///< Page size * page size tiles used to read/write a page
+	JamTileMap** pages;    ///< Each page (y * pagesAcross + x), NULL if its not in memory
+	bool* pagesModified;   ///< Weather or not each page has been changed since it was loaded
+	uint64* pagesLastUsed; ///< When each page was last used (see clock)
+	uint32* resident;      ///< Indices of the pages that are in memory
+	uint32 residentCount;  ///< How many pages are in memory
+	uint32 pageBudget;     ///< Most pages that will be in memory at once
+	uint64 clock;          ///< Goes up every time a page is used
+} JamPagedTileMap;
+
+/// \brief Creates a new, empty paged tile map at a file
+/// \param filename File to create (anything already there is overwritten)
+/// \param width Width of the map in tiles
+/// \param height Height of the map in tiles
+/// \param cellWidth Width of each cell in pixels
+/// \param cellHeight Height of each cell in pixels
+/// \param tileSet Sprite whose frames are the tiles
+/// \param pageBudget Most pages to keep in memory at once (at least 1)
+/// \return Returns the new map or NULL
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_OUT_OF_BOUNDS
+/// \throws ERROR_OPEN_FAILED
+/// \throws ERROR_ALLOC_FAILED
+JamPagedTileMap* jamPagedTileMapCreate(const char *filename, uint32 width, uint32 height, uint32 cellWidth,
+									   uint32 cellHeight, JamSprite *tileSet, uint32 pageBudget);
+
+/// \brief Opens a paged tile map that was saved to a file
+/// \param filename File to open
+/// \param tileSet Sprite whose frames are the tiles
+/// \param pageBudget Most pages to keep in memory at once (at least 1)
+/// \return Returns the map or NULL
+///
+/// If the file can only be read, the map can still be looked at but
+/// jamPagedTileMapSet will fail.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_OPEN_FAILED
+/// \throws ERROR_INCORRECT_FORMAT
+/// \throws ERROR_ALLOC_FAILED
+JamPagedTileMap* jamPagedTileMapLoad(const char *filename, JamSprite *tileSet, uint32 pageBudget);
+
+/// \brief Makes sure the pages under a rectangle are in memory
+///
+/// This is meant to be called every frame with wherever the action is
+/// (usually around the camera) so those pages are loaded ahead of time
+/// and aren't the ones thrown out to make room for others. If the area
+/// needs more pages than the budget, only as many as fit are loaded.
+///
+/// \param map Map to load pages from
+/// \param x X of the area in the world in pixels
+/// \param y Y of the area in the world in pixels
+/// \param w Width of the area in pixels
+/// \param h Height of the area in pixels
+///
+/// \throws ERROR_NULL_POINTER
+void jamPagedTileMapFocus(JamPagedTileMap *map, int x, int y, int w, int h);
+
+/// \brief Gets a page of a paged tile map, loading it if it isn't in memory
+/// \return Returns the page or NULL if it is outside the map or couldn't be loaded
+///
+/// The page's xInWorld/yInWorld are set to where it sits in the world so
+/// tile map collision functions can be used on it with world coordinates.
+///
+/// \warning The page may be freed the next time any other page is loaded,
+/// and tiles changed through it directly won't be saved.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_ALLOC_FAILED
+/// \throws ERROR_FILE_FAILED
+JamTileMap* jamPagedTileMapGetPage(JamPagedTileMap *map, uint32 pageX, uint32 pageY);
+
+/// \brief Gets a tile in a paged tile map, loading its page if needed
+/// \throws ERROR_NULL_POINTER
+JamFrame* jamPagedTileMapGet(JamPagedTileMap *map, uint32 x, uint32 y);
+
+/// \brief Sets a tile in a paged tile map, loading its page if needed
+///
+/// The frame must be NULL or one of the tile set's frames since only tile
+/// numbers are saved to the file.
+///
+/// \return Returns false if the tile is outside the map, the frame isn't in the tile set,
+/// the map's file can only be read, or the page couldn't be loaded
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_INCORRECT_FORMAT
+/// \throws ERROR_FILE_FAILED
+bool jamPagedTileMapSet(JamPagedTileMap *map, uint32 x, uint32 y, JamFrame *val);
+
+/// \brief Checks if a rectangle in the world hits any tiles, loading the pages under it if needed
+///
+/// This works just like jamTileMapCollision across every page the
+/// rectangle covers.
+///
+/// \throws ERROR_NULL_POINTER
+bool jamPagedTileMapCollision(JamPagedTileMap *map, int x, int y, int w, int h);
+
+/// \brief Writes every changed page in memory back to the file
+/// \return Returns false if any page couldn't be written
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_FILE_FAILED
+bool jamPagedTileMapFlush(JamPagedTileMap *map);
+
+/// \brief Writes any changes to the file, then frees the map and closes the file
+void jamPagedTileMapFree(JamPagedTileMap *map);
+
+#ifdef __cplusplus
+}
+#endif
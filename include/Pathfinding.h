@@ -0,0 +1,174 @@
+/// \file Pathfinding.h
+/// \author plo
+/// \brief Finds paths through tile maps, right away or on a worker thread
+///
+/// Paths move between the 8 cells around each cell, and never cut the
+/// corner of a solid tile (a diagonal step needs both cells beside it to be
+/// open). When every open cell costs the same the search uses Jump Point
+/// Search, which skips straight over open areas and only stops at cells
+/// where the path could turn, so it looks at a tiny fraction of the cells
+/// plain A* would. When the pathfinder is given a cost for each cell it
+/// falls back to A*.
+///
+/// Everything a search needs (including its heap) is allocated once when
+/// the pathfinder is made, so finding a path never allocates unless the
+/// path itself has to grow. The last PATHFINDING_CACHE_SIZE paths found are
+/// kept around, keyed by their start, goal, and the map's revision, so asking
+/// for the same path again before the map changes just copies it.
+///
+/// Searches use the pathfinder's own copy of the map's solid tiles, which is
+/// brought up to date whenever the map's revision changes and a pathfinder
+/// function is called. This is what lets requests be served on a worker
+/// thread while the game keeps changing the map.
+#pragma once
+#include "Constants.h"
+#include "TileMap.h"
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// \brief A path through a tile map as a list of cells
+typedef struct {
+	uint32* x;       ///< X of each cell in the path, from the start to the goal (both included)
+	uint32* y;       ///< Y of each cell in the path, from the start to the goal (both included)
+	uint32 length;   ///< Cells in the path, 0 if there is no path
+	uint32 capacity; ///< Cells x and y have room for
+} JamPath;
+
+/// \brief Called with a finished path from jamPathfinderRequest (path->length is 0 if there is none)
+///
+/// The path belongs to the pathfinder and is only valid during the call.
+typedef void (*JamPathCallback)(const JamPath* path, void* userData);
+
+/// \brief A path waiting to be (or that has been) found on the worker thread
+typedef struct {
+	uint32 startX;            ///< Cell the path starts from
+	uint32 startY;            ///< Cell the path starts from
+	uint32 goalX;             ///< Cell the path goes to
+	uint32 goalY;             ///< Cell the path goes to
+	JamPathCallback callback; ///< What to give the path to once its found
+	void* userData;           ///< Given to the callback
+	JamPath path;             ///< The path once its found
+} JamPathRequest;
+
+/// \brief A path that was found before
+typedef struct {
+	bool used;       ///< Weather or not anything is stored here
+	uint32 start;    ///< Start cell (y * width + x)
+	uint32 goal;     ///< Goal cell (y * width + x)
+	uint32 revision; ///< The map's revision when the path was found
+	JamPath path;    ///< The path itself (length 0 if there wasn't one)
+} JamPathCacheEntry;
+
+/// \brief Finds paths through one tile map
+///
+/// \warning The map must not be freed or resized while the pathfinder exists.
+typedef struct {
+	JamTileMap* map;    ///< The map paths go through
+	const uint8* costs; ///< Cost of stepping into each cell (y * width + x, 0 blocks the cell) or NULL if every cell costs 1
+	uint32 width;       ///< Width of the map in cells
+	uint32 height;      ///< Height of the map in cells
+	uint32 solidWords;  ///< How many uint64 make up each row of solid
+	uint64* solid;      ///< The pathfinder's copy of the map's solid bits
+	uint32 revision;    ///< The map's revision when solid was copied
+
+	// Search scratch space, one of each per cell
+	float* g;         ///< Cost of the best way found to each cell
+	float* f;         ///< g plus the guess of how far each cell is from the goal
+	uint32* parent;   ///< Cell each cell was reached from
+	uint32* heapPos;  ///< Where each cell is in the heap (or if its not in it)
+	uint32* visited;  ///< Which search last touched each cell, so nothing has to be cleared between searches
+	uint32* heap;     ///< Binary heap of open cells by f
+	uint32 heapSize;  ///< Cells in the heap
+	uint32 search;    ///< Goes up every search
+
+	JamPathCacheEntry cache[PATHFINDING_CACHE_SIZE]; ///< Paths found before
+
+	// Worker thread, requests in the queue from queueHead to queueNext are done and
+	// those from queueNext to queueTail are waiting (all wrap around PATHFINDING_QUEUE_SIZE)
+	JamPathRequest queue[PATHFINDING_QUEUE_SIZE]; ///< Requests waiting to be found or given back
+	uint32 queueHead;             ///< Oldest request that hasn't been given back yet
+	uint32 queueNext;             ///< Next request the worker will find
+	uint32 queueTail;             ///< Where the next request goes
+	pthread_mutex_t queueLock;    ///< Protects the queue positions and quit
+	pthread_cond_t queueSignal;   ///< Wakes the worker when there is a request
+	pthread_mutex_t searchLock;   ///< Held for every search and whenever solid is updated
+	pthread_t worker;             ///< Thread that serves requests
+	bool workerStarted;           ///< Weather or not the worker has been started (it is started by the first request)
+	bool quit;                    ///< Tells the worker to stop
+} JamPathfinder;
+
+/// \brief Creates an empty path
+/// \throws ERROR_ALLOC_FAILED
+JamPath* jamPathCreate();
+
+/// \brief Frees a path
+void jamPathFree(JamPath *path);
+
+/// \brief Creates a pathfinder for a tile map
+///
+/// This allocates about 24 bytes per cell of the map.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_ALLOC_FAILED
+JamPathfinder* jamPathfinderCreate(JamTileMap *map);
+
+/// \brief Gives a pathfinder a cost for each cell, making it use A* instead of Jump Point Search
+///
+/// Stepping into a cell costs the cell's cost (times the square root of two
+/// for diagonal steps), and cells with a cost of 0 can't be walked through
+/// at all. The array is not copied and must be width * height long. If
+/// the costs are changed, call this again so cached paths are thrown out.
+/// Passing NULL goes back to every open cell costing 1.
+///
+/// \warning Don't change the costs while requests are still waiting.
+///
+/// \throws ERROR_NULL_POINTER
+void jamPathfinderSetCosts(JamPathfinder *pathfinder, const uint8 *costs);
+
+/// \brief Finds the cheapest path between two cells right away
+/// \param pathfinder Pathfinder to use
+/// \param startX Cell to start from
+/// \param startY Cell to start from
+/// \param goalX Cell to go to
+/// \param goalY Cell to go to
+/// \param path Where to put the path (its length will be 0 if there is no path)
+/// \return Returns true if a path was found
+///
+/// If the worker thread is busy with a request this waits for it to finish.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_REALLOC_FAILED
+bool jamPathfinderFind(JamPathfinder *pathfinder, uint32 startX, uint32 startY, uint32 goalX, uint32 goalY, JamPath *path);
+
+/// \brief Asks for a path to be found on the pathfinder's worker thread
+///
+/// The callback is called from jamPathfinderUpdate once the path is found,
+/// so it is always called on the thread that calls jamPathfinderUpdate.
+/// Requests are finished and given back in the order they were made.
+///
+/// \return Returns false if the queue is full (PATHFINDING_QUEUE_SIZE requests) or the worker couldn't be started
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_OUT_OF_BOUNDS
+bool jamPathfinderRequest(JamPathfinder *pathfinder, uint32 startX, uint32 startY, uint32 goalX, uint32 goalY,
+						  JamPathCallback callback, void *userData);
+
+/// \brief Gives finished requests to their callbacks and catches the pathfinder up with map changes
+///
+/// Call this once a frame while using jamPathfinderRequest.
+///
+/// \throws ERROR_NULL_POINTER
+void jamPathfinderUpdate(JamPathfinder *pathfinder);
+
+/// \brief Stops the worker thread and frees the pathfinder
+///
+/// Requests that haven't been given back yet are dropped without calling
+/// their callbacks. This does not free the map.
+void jamPathfinderFree(JamPathfinder *pathfinder);
+
+#ifdef __cplusplus
+}
+#endif
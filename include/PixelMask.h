@@ -0,0 +1,93 @@
+/// \file PixelMask.h
+/// \author plo
+/// \brief Pixel-perfect collision masks built from sprite frames
+///
+/// A pixel mask is one bit per pixel of whether or not that pixel is solid,
+/// packed 64 pixels to a word so two masks can be checked against each
+/// other a whole word at a time. Textures loaded from files keep the bits
+/// of their alpha channel around so masks can be cut from any frame of a
+/// sprite without going back to the GPU, and sprites cache the mask for
+/// each of their frames so every entity using the sprite shares them.
+///
+/// Masks are used through ht_PixelMask hitboxes (see Hitbox.h), but the
+/// functions here work on their own too.
+#pragma once
+#include "Constants.h"
+#include "Vector.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct _JamTexture;
+struct _JamSprite;
+
+/// \brief One bit per pixel of whether or not the pixel is solid
+///
+/// Pixel (x, y) is bit `x % 64` of `bits[y * words + x / 64]`, and bits
+/// past the width of a row are always 0.
+typedef struct {
+	uint32 width;  ///< Width of the mask in pixels
+	uint32 height; ///< Height of the mask in pixels
+	uint32 words;  ///< How many uint64 make up each row
+	uint64* bits;  ///< The rows, one after another
+} JamPixelMask;
+
+/// \brief Creates an empty (entirely clear) mask
+/// \throws ERROR_ALLOC_FAILED
+JamPixelMask* jamPixelMaskCreate(uint32 width, uint32 height);
+
+/// \brief Cuts a mask out of a texture's alpha channel
+///
+/// Only textures loaded with jamTextureLoad keep their alpha around,
+/// so this returns NULL for anything else. Pixels with an alpha of at
+/// least PIXEL_MASK_ALPHA are solid.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_ALLOC_FAILED
+JamPixelMask* jamPixelMaskFromTexture(struct _JamTexture* texture, sint32 x, sint32 y, sint32 w, sint32 h);
+
+/// \brief Gets the mask for one frame of a sprite, making it the first time its asked for
+///
+/// The mask belongs to the sprite and is freed with it, so any number of
+/// entities may share it. Asset handlers build the masks for entities with
+/// pixel mask hitboxes while loading and jamEntityUpdateHitbox builds any
+/// that are still missing, so entity collision checks only ever read them.
+///
+/// \return Returns the mask or NULL if the frame's texture has no alpha data
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_OUT_OF_BOUNDS
+/// \throws ERROR_ALLOC_FAILED
+JamPixelMask* jamPixelMaskFromSprite(struct _JamSprite* sprite, uint32 frame);
+
+/// \brief Sets or clears a single pixel of a mask (out of bounds pixels are ignored)
+/// \throws ERROR_NULL_POINTER
+void jamPixelMaskSet(JamPixelMask* mask, uint32 x, uint32 y, bool solid);
+
+/// \brief Checks a single pixel of a mask (out of bounds pixels are never solid)
+/// \throws ERROR_NULL_POINTER
+bool jamPixelMaskGet(JamPixelMask* mask, uint32 x, uint32 y);
+
+/// \brief Checks if two masks with their top-lefts at (x1, y1) and (x2, y2) share a solid pixel
+/// \throws ERROR_NULL_POINTER
+bool jamPixelMaskCollision(JamPixelMask* mask1, int x1, int y1, JamPixelMask* mask2, int x2, int y2);
+
+/// \brief Checks if a mask at (x, y) has a solid pixel whose centre is inside a rectangle
+/// \throws ERROR_NULL_POINTER
+bool jamPixelMaskRectCollision(JamPixelMask* mask, int x, int y, double rx, double ry, double rw, double rh);
+
+/// \brief Checks if a mask at (x, y) has a solid pixel whose centre is inside a circle
+/// \throws ERROR_NULL_POINTER
+bool jamPixelMaskCircleCollision(JamPixelMask* mask, int x, int y, double cx, double cy, double radius);
+
+/// \brief Checks if a mask at (x, y) has a solid pixel whose centre is inside a convex polygon at (px, py)
+/// \throws ERROR_NULL_POINTER
+bool jamPixelMaskPolygonCollision(JamPixelMask* mask, int x, int y, JamPolygon* polygon, double px, double py);
+
+/// \brief Frees a mask
+void jamPixelMaskFree(JamPixelMask* mask);
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,6 +12,7 @@
 #include "Renderer.h"
 #include "Frame.h"
 #include "Constants.h"
+#include "PixelMask.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,7 +38,7 @@ extern "C" {
 /// 16/16 with an origin of 8/8 would be drawn from the center; the
 /// x/y values passed to jamDrawSprite would represent the center of
 /// the sprite and not the top-left.
-typedef struct {
+typedef struct _JamSprite {
 	// Animation things
 	JamFrame** frames;      ///< The list of frames in the sprite's animation
 	uint32 animationLength; ///< The length (in frames) of the animation
@@ -51,6 +52,10 @@ typedef struct {
 	// Things for the sprite to draw properly
 	sint32 originX; ///< The x origin of the sprite
 	sint32 originY; ///< The y origin of the sprite
+
+	// Collision masks
+	JamPixelMask** pixelMasks; ///< Each frame's pixel mask once its been built (see jamPixelMaskFromSprite)
+	uint32 pixelMaskCount;     ///< How many frames pixelMasks has room for
 } JamSprite;
 
 /// \brief Creates a sprite
@@ -20,6 +20,7 @@ struct _JamTexture {
 	sint32 w; ///< Texture's width
 	sint32 h; ///< Texture's height
 	bool renderTarget; ///< Weather or not this texture can be rendered to
+	uint64* alphaMask; ///< One bit per pixel of whether its alpha is at least PIXEL_MASK_ALPHA (only for loaded textures, otherwise NULL)
 };
 
 /// \brief Creates a texture that can be rendered to
@@ -15,11 +15,31 @@
 extern "C" {
 #endif
 
+/// \brief A solid block of tiles found by jamTileMapBake, in cells from the map's top-left
+///
+/// In pixels, a block is at `(x + xInWorld) * cellWidth`, `(y + yInWorld) * cellHeight`
+/// and is `w * cellWidth` by `h * cellHeight`.
+typedef struct {
+	uint32 x; ///< Left-most column of the block
+	uint32 y; ///< Top-most row of the block
+	uint32 w; ///< Columns in the block
+	uint32 h; ///< Rows in the block
+} JamTileRect;
+
+/// \brief The blocks one chunk of a baked tile map is made of
+typedef struct {
+	JamTileRect* rects; ///< Every block in this chunk
+	uint32 count;       ///< Blocks in this chunk
+	uint32 capacity;    ///< Blocks allocated
+} JamTileChunkRects;
+
 /// \brief A simple struct that makes collision checking and tile graphics easier
 ///
 /// Internally, this struct is just a width * height grid of JamFrame pointers.
 /// Any NULL pointer is considered not a collision, and anything not NULL is
-/// considered a collision. Also, the tile map will not free any of the frames
+/// considered a collision. Alongside the grid, the map keeps one bit per cell of
+/// whether or not it is solid, packed 64 cells to a word, which is all collisions
+/// ever look at so a whole row of cells is checked a word at a time. Also, the tile map will not free any of the frames
 /// it holds because it is meant to be used with a JamAssetHandler (so basically
 /// if you use it without it just free the frames yourself).
 ///
@@ -33,6 +53,17 @@ extern "C" {
 /// and cellHeight height. If frames in the grid do not match the expected cellWidth
 /// and cellHeight, you will more likely than not get really wonky collisions and
 /// strange rendering.
+///
+/// Maps made with jamTileMapCreateIndexed don't have a `grid` at all, instead
+/// each cell is a 16-bit index into `palette`, which is a quarter of the memory
+/// and fits four times as many cells in cache. jamTileMapGet and jamTileMapSet
+/// work the same either way, and frames set that aren't in the palette yet are
+/// added to it. Since `tiles` is just numbers, it can be written straight to a
+/// file and read back as long as the palette is rebuilt the same way (paged
+/// tile maps do exactly this).
+///
+/// \warning If you change `grid` (or `tiles`) directly instead of through jamTileMapSet, call
+/// jamTileMapRefresh afterwards or collisions will still use the old tiles.
 typedef struct {
 	int xInWorld;      ///< X position in the world of the grid (for collisions only, drawing ignores this)
 	int yInWorld;      ///< Y position in the world of the grid (for collisions only, drawing ignores this)
@@ -40,9 +71,36 @@ typedef struct {
 	uint32 height;     ///< Grid's height
 	uint32 cellWidth;  ///< Width of any given cell in the map
 	uint32 cellHeight; ///< Height of any given cell in the map
-	JamFrame** grid;   ///< Internal grid of w*h (it is a 1D array of JamFrame pointers)
+	JamFrame** grid;   ///< Internal grid of w*h (it is a 1D array of JamFrame pointers), NULL for indexed maps
+	uint16* tiles;     ///< Indexed maps' cells as w*h indices into palette (NULL if the map uses grid)
+	uint32 solidWords; ///< How many uint64 make up each row of solid
+	uint64* solid;     ///< Bit `x % 64` of `solid[y * solidWords + x / 64]` is set if cell (x, y) isn't NULL
+
+	// Frames the cells of an indexed map refer to (NULL and 0 for maps with a grid)
+	JamFrame** palette;     ///< Frame for each index, palette[0] is always NULL
+	uint32 paletteSize;     ///< Frames in the palette including the NULL at 0
+	uint32 paletteCapacity; ///< Frames the palette has room for
+
+	// Render cache for jamDrawTileMapCached, chunk (x, y) is at index y * chunksAcross + x
+	uint32 chunksAcross;   ///< Chunks across the map (each TILEMAP_CHUNK_SIZE tiles wide)
+	uint32 chunksDown;     ///< Chunks down the map (each TILEMAP_CHUNK_SIZE tiles tall)
+	JamTexture** chunks;   ///< Each chunk drawn onto a texture (NULL until its drawn or if its empty)
+	bool* chunksDirty;     ///< Weather or not each chunk has changed since its texture was drawn
+
+	JamTileChunkRects* chunkRects; ///< Solid blocks in each chunk from jamTileMapBake (NULL if the map isn't baked)
+	uint32 revision;               ///< Goes up every time a tile changes between solid and empty (or the map is refreshed)
 } JamTileMap;
 
+/// \brief The outcome of moving a rectangle through a tile map with jamTileMapSweep (or a ray with jamTileMapRaycast)
+typedef struct {
+	bool hit;       ///< Weather or not the rectangle ran into a tile
+	double time;    ///< How much of the motion happened before the hit, from 0 to 1 (1 if nothing was hit)
+	double normalX; ///< X of the normal of the tile face that was hit (-1, 0, or 1)
+	double normalY; ///< Y of the normal of the tile face that was hit (-1, 0, or 1)
+	double x;       ///< Where the rectangle ended up (up against the tile if it hit one)
+	double y;       ///< Where the rectangle ended up (up against the tile if it hit one)
+} JamTileSweep;
+
 /// \brief Creates a tile map
 ///
 /// Tile maps are initialized with false as every value
@@ -50,16 +108,41 @@ typedef struct {
 /// \throws ERROR_ALLOC_FAILED
 JamTileMap* jamTileMapCreate(uint32 width, uint32 height, uint32 cellWidth, uint32 cellHeight);
 
+/// \brief Creates a tile map that stores 16-bit palette indices instead of frames
+///
+/// The palette starts out as NULL followed by every frame in the tile set, so
+/// frame n of the tile set is index n + 1 (the same numbering Tiled and paged
+/// tile maps use). Any other frame set on the map is added to the end of the
+/// palette, up to 65535 frames in total.
+///
+/// \param tileSet Sprite to start the palette with, or NULL for an empty palette
+///
+/// \throws ERROR_ALLOC_FAILED
+JamTileMap* jamTileMapCreateIndexed(uint32 width, uint32 height, uint32 cellWidth, uint32 cellHeight, JamSprite *tileSet);
+
 /// \brief Sets a position in a tile map
 /// Returns true if it worked
 ///
+/// On indexed maps this looks through the palette for the frame, so it is
+/// slower the more different frames the map has.
+///
 /// \throws ERROR_NULL_POINTER
+/// \throws ERROR_REALLOC_FAILED
+/// \throws ERROR_OUT_OF_BOUNDS
 bool jamTileMapSet(JamTileMap *tileMap, uint32 x, uint32 y, JamFrame *val);
 
 /// \brief Gets a position in a tile map
 /// \throws ERROR_NULL_POINTER
 JamFrame* jamTileMapGet(JamTileMap *tileMap, uint32 x, uint32 y);
 
+/// \brief Rebuilds a tile map's solid bits from its grid and marks every chunk to be redrawn
+///
+/// Only needed if the grid was changed without jamTileMapSet. Baked maps are
+/// baked again.
+///
+/// \throws ERROR_NULL_POINTER
+void jamTileMapRefresh(JamTileMap *tileMap);
+
 /// \brief Auto-tiles a tile map using a 48-frame sprite
 ///
 /// This function takes a 48-frame spritesheet and automatically places
@@ -72,11 +155,35 @@ JamFrame* jamTileMapGet(JamTileMap *tileMap, uint32 x, uint32 y);
 /// it does not care about anything past that. This means it is safe
 /// to use a dummy frame to denote a tile, or even just random data since
 /// this function will never access data inside the pointers in the grid.
+/// It goes by the map's solid bits, so call jamTileMapRefresh first if the
+/// grid was written to directly.
+///
+/// Each tile's eight neighbours are packed into a byte that indexes a table
+/// of frames. Maps with at least TILEMAP_AUTO_PARALLEL_CELLS tiles are split
+/// into bands of rows that are auto-tiled on up to TILEMAP_AUTO_THREADS threads.
 ///
 /// \throws ERROR_NULL_POINTER
 /// \throws ERROR_INCORRECT_FORMAT
 void jamTileMapAuto(JamTileMap *map, JamSprite *spr);
 
+/// \brief Places or removes a tile and auto-tiles the spots around it
+///
+/// This only re-tiles the tile and its eight neighbours instead of the whole
+/// map like jamTileMapAuto, so it is meant for maps that change while the
+/// game is running. The rest of the map is assumed to already be auto-tiled
+/// with the same sprite.
+///
+/// \param map Map to change
+/// \param spr 48-frame (or 47) sprite to auto-tile with
+/// \param x Tile x to change
+/// \param y Tile y to change
+/// \param solid Weather or not the tile should be there
+/// \return Returns false if the tile is outside the map
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_INCORRECT_FORMAT
+bool jamTileMapAutoSet(JamTileMap *map, JamSprite *spr, uint32 x, uint32 y, bool solid);
+
 /// \brief Checks For a collision
 ///
 /// This check is only reliable if the rectangle who's
@@ -90,16 +197,102 @@ bool jamTileMapFastCollision(JamTileMap *tileMap, int x, int y, int w, int h);
 
 /// \brief Checks for a collision in a tile map
 ///
-/// This collision check takes more memory and cycles to
-/// perform than checkMapCollFast but can handle any rectangle
-/// whereas the aforementioned can only properly check for
-/// rectangles that are smaller/equal to the size of the
-/// tile map's cells.
+/// Unlike jamTileMapFastCollision this can handle a rectangle
+/// of any size. Every row of cells the rectangle covers is
+/// checked 64 cells at a time against the map's solid bits,
+/// so even huge rectangles only cost a few word tests per row.
 ///
 /// \throws ERROR_NULL_POINTER
-/// \throws ERROR_OUT_OF_BOUNDS
 bool jamTileMapCollision(JamTileMap *tileMap, int x, int y, int w, int h);
 
+/// \brief Moves a rectangle through a tile map and stops it at the first tile it hits
+///
+/// Instead of checking the destination and backing off a pixel at a time,
+/// this walks only the cells the rectangle's leading edges pass through
+/// on the way there, so it costs one call no matter how fast something
+/// moves and it can't tunnel through thin walls. Tiles the rectangle
+/// already overlaps at the start are ignored so things can always move
+/// out of walls. Just like jamTileMapCollision, a rectangle touching
+/// a tile is not colliding with it.
+///
+/// If you want to slide along walls, sweep each axis on its own.
+///
+/// \param x X of the rectangle's top-left
+/// \param y Y of the rectangle's top-left
+/// \param w Width of the rectangle
+/// \param h Height of the rectangle
+/// \param dx How far to move horizontally
+/// \param dy How far to move vertically
+/// \param result Where the time of impact, normal, and final position are put
+/// \return Returns true if the rectangle hit a tile
+///
+/// \throws ERROR_NULL_POINTER
+bool jamTileMapSweep(JamTileMap *tileMap, double x, double y, double w, double h, double dx, double dy, JamTileSweep *result);
+
+/// \brief Merges a tile map's solid tiles into as few rectangles as it can find
+///
+/// Solid tiles in each TILEMAP_CHUNK_SIZE chunk are greedily merged into
+/// rectangles, taking the widest run of solid tiles in a row and growing it
+/// down while the rows below are solid too. The rectangles are kept per
+/// chunk, which doubles as a spatial index, and once a map is baked,
+/// jamTileMapSet merges the chunk it changed again so the blocks never go
+/// stale. Maps with big solid areas end up with only a handful of blocks to
+/// check in jamTileMapRaycast and jamTileMapCollisionRect.
+///
+/// Baking is optional; everything works on maps that aren't baked, just
+/// tile by tile.
+///
+/// \return Returns false if the blocks could not be allocated
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_ALLOC_FAILED
+/// \throws ERROR_REALLOC_FAILED
+bool jamTileMapBake(JamTileMap *tileMap);
+
+/// \brief Checks for a collision in a tile map and finds the block of tiles that was hit
+///
+/// Works just like jamTileMapCollision, but `rect` is set to the solid block
+/// from jamTileMapBake that the rectangle overlaps (the first one found if
+/// there are several). If the map isn't baked, the block is just the one
+/// tile that was hit.
+///
+/// \param rect Where to put the block that was hit (only set if there was a collision)
+///
+/// \throws ERROR_NULL_POINTER
+bool jamTileMapCollisionRect(JamTileMap *tileMap, int x, int y, int w, int h, JamTileRect *rect);
+
+/// \brief Casts a ray through a tile map and finds the first solid tile it goes into
+///
+/// The ray goes from (x, y) to (x + dx, y + dy). Baked maps test the ray
+/// against the blocks in each chunk it passes through, otherwise it steps
+/// from cell to cell. A ray has to go inside a tile to hit it; just
+/// touching a corner doesn't count, but like the rest of the tile map a
+/// ray running along the top or left edge of a tile is inside it. A ray
+/// that starts inside a solid tile hits it right away with no normal.
+///
+/// \param result Where the time of impact (0 to 1 along dx/dy), normal, and hit point are put
+/// \return Returns true if the ray hit a tile
+///
+/// \throws ERROR_NULL_POINTER
+bool jamTileMapRaycast(JamTileMap *tileMap, double x, double y, double dx, double dy, JamTileSweep *result);
+
+/// \brief Checks if there are no solid tiles on the line between two cells
+///
+/// This walks a Bresenham line between the cells, so it's a lot cheaper
+/// than a raycast or a whole field of view (see FieldOfView.h) when all
+/// that's needed is a yes or no. The two cells themselves aren't checked,
+/// so something standing next to a wall can see the wall, and the line is
+/// always walked in the same direction so checking from A to B gives the
+/// same answer as from B to A. Cells outside the map are never solid.
+///
+/// \throws ERROR_NULL_POINTER
+bool jamTileMapLineOfSight(JamTileMap *tileMap, int x1, int y1, int x2, int y2);
+
+/// \brief Primarily for in-engine use, gets the frame in a cell by its index (y * width + x) whether the map holds frames or palette indices
+///
+/// \warning Since this is for in-engine use, it doesn't check for NULL pointers or bounds and as such will happily segfault if misused
+JamFrame* _jamTileMapCellAt(JamTileMap *tileMap, uint32 index);
+
 /// \brief Frees a tile map from memory
 void jamTileMapFree(JamTileMap *tileMap);
 
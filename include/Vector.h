@@ -10,10 +10,36 @@ extern "C" {
 #endif
 
 /// \brief A polygon struct that is very to-the-point
+///
+/// Alongside the vertices, polygons keep a few things collision checks
+/// need over and over: a unit normal pointing out of each edge (edge `i`
+/// goes from vertex `i` to vertex `i + 1`) and a bounding box and circle.
+/// These are worked out whenever a vertex is added and when
+/// jamPolygonRecalculate is called, never by collision checks themselves
+/// (so threads can check against the same polygon at once). A polygon
+/// from jamPolygonCreate that has its vertices filled in by hand has
+/// none of these yet, so every check works them out on the side instead,
+/// which is correct but slower until jamPolygonRecalculate is called.
+///
+/// \warning Once a polygon's values are cached, nothing notices if you
+/// change `xVerts`/`yVerts` directly. Call jamPolygonRecalculate again
+/// afterwards or the old values are used silently.
 typedef struct {
 	double* xVerts; ///< X component of the vertices
 	double* yVerts; ///< Y component of the vertices
 	unsigned int vertices; ///< The total number of vertices in this polygon
+
+	// Cached for collisions, use jamPolygonRecalculate to update these
+	double* xNormals;   ///< X component of each edge's outward unit normal
+	double* yNormals;   ///< Y component of each edge's outward unit normal
+	double boundsX1;    ///< Left side of the bounding box
+	double boundsY1;    ///< Top of the bounding box
+	double boundsX2;    ///< Right side of the bounding box
+	double boundsY2;    ///< Bottom of the bounding box
+	double centreX;     ///< X of the bounding circle's centre
+	double centreY;     ///< Y of the bounding circle's centre
+	double radius;      ///< Radius of the bounding circle
+	bool cached;        ///< Weather or not the values above match the vertices
 } JamPolygon;
 
 /// \brief Creates a polygon
@@ -35,6 +61,30 @@ JamPolygon* jamPolygonLoad(const char *string);
 /// \throws ERROR_REALLOC_FAILED
 void jamPolygonAddVertex(JamPolygon *poly, double x, double y);
 
+/// \brief Works out a polygon's edge normals and bounds again after its vertices change
+///
+/// jamPolygonAddVertex and jamPolygonLoad take care of this on their own,
+/// you only need this if you edit the vertices directly.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_REALLOC_FAILED
+void jamPolygonRecalculate(JamPolygon *poly);
+
+/// \brief Primarily for in-engine use, gets a polygon whose cached values are up to date without changing it
+///
+/// Cached polygons are returned as is. Otherwise scratch is filled in to share
+/// the polygon's vertices, with normals, bounds, and circle worked out into
+/// memory kept by the calling thread, and scratch is returned. It is good
+/// until the next call with the same slot on the same thread.
+///
+/// \param slot Which of the thread's two scratch spaces to use (0 or 1)
+/// \return Returns the polygon to check with, or NULL if the scratch space couldn't be grown
+///
+/// \throws ERROR_REALLOC_FAILED
+///
+/// \warning Since this is for in-engine use, it doesn't check for NULL pointers and as such will happily segfault if misused
+JamPolygon* _jamPolygonPrepare(JamPolygon *poly, JamPolygon *scratch, int slot);
+
 /// \brief Frees a polygon from memory
 void jamPolygonFree(JamPolygon *poly);
 
@@ -6,6 +6,10 @@
 #include "TileMap.h"
 #include "Entity.h"
 #include "EntityList.h"
+#include "Component.h"
+#include "Message.h"
+#include "Contact.h"
+#include "AABBTree.h"
 #include "Renderer.h"
 #include <pthread.h>
 
@@ -13,6 +17,62 @@
 extern "C" {
 #endif
 
+/// \brief Statistics on how a world's entities are spread across its spatial map
+///
+/// These are what jamWorldAutoTuneGrid uses to decide on a cell size, but
+/// they are also handy for figuring out by hand if a level's spatial map
+/// is set up poorly. Generally you want few entities per cell, few entities
+/// spanning multiple cells, and nothing in the overflow cell.
+typedef struct {
+	int entities;             ///< Entities in the spatial map
+	int occupiedCells;        ///< Cells (not counting the overflow cell) holding at least one entity
+	double entitiesPerCell;   ///< Average number of entities in each occupied cell
+	int maxEntitiesInCell;    ///< Most entities found in any single cell
+	double multiCellRatio;    ///< Fraction of entities that are in more than one cell
+	int overflowEntities;     ///< Entities in the out-of-bounds cell
+	double averageWidth;      ///< Average visible width of the entities
+	double averageHeight;     ///< Average visible height of the entities
+	int suggestedCellWidth;   ///< Cell width the world would pick if it were to tune itself now
+	int suggestedCellHeight;  ///< Cell height the world would pick if it were to tune itself now
+	int totalSize;            ///< Slots in use across every cell's list (entities plus NULL holes)
+	int totalHoles;           ///< NULL slots left behind in every cell's list by entities that moved
+	int totalCapacity;        ///< Slots allocated across every cell's list
+	int cellsVisited;         ///< Cells looked at to find in-range entities last frame
+} JamWorldGridStats;
+
+/// \brief Information on a single cell of a world's spatial map
+///
+/// Entities that move leave NULL holes in the lists of the cells they
+/// left, which are only reused when something else moves in. A cell
+/// with many holes compared to its entities costs time to loop for
+/// nothing.
+typedef struct {
+	int entities; ///< Entities in this cell
+	int size;     ///< Slots in use in this cell's list (entities plus holes)
+	int holes;    ///< NULL slots inside of size
+	int capacity; ///< Slots allocated for this cell's list
+} JamWorldCellStats;
+
+/// \brief The hitbox bounds of everything in one of a world's grid cells, kept beside the cell's list
+///
+/// Slot i of the cell's list has its box in chunk i / COLLISION_BATCH_SIZE, where each chunk
+/// holds all of its left edges, then its tops, rights, and bottoms, which is just how
+/// jamHitboxBatchAABB wants them. Empty slots have a box that overlaps nothing.
+typedef struct {
+	float* boxes;    ///< capacity * 4 floats, COLLISION_BATCH_SIZE boxes at a time
+	uint32 capacity; ///< Slots there are boxes for, always a multiple of COLLISION_BATCH_SIZE
+} JamWorldCellBoxes;
+
+/// \brief How a world finds the entities near a place
+///
+/// Both sit behind the same functions (jamWorldProcFrame, jamWorldFilter,
+/// jamWorldEntityCollision, and contacts), so switching between them with
+/// jamWorldSetBroadphase changes nothing but performance.
+typedef enum {
+	bp_Grid,    ///< Uniform spatial grid, best when entities are about the same size and spread evenly
+	bp_AABBTree ///< Dynamic AABB tree, best when tiny and huge entities share a level
+} JamBroadphaseType;
+
 /// \brief A thing that holds lots of info for convenience
 typedef struct _JamWorld {
 	JamTileMap* worldMaps[MAX_TILEMAPS]; ///< Worlds can store tilemaps for convenience, its best if you use constants to denote their meaning and not [0] or whatever
@@ -39,11 +99,31 @@ typedef struct _JamWorld {
 	 * as the last cell is used to store each entity that is out of bounds. This is why
 	 * you may see `(gridWidth * gridHeight) + 1` in various functions.
 	 */
-	JamEntityList** entityGrid; ///< List of entity lists, made 2D through trickery (I hate 2D arrays)
-	int gridWidth;              ///< Width of the grid in cells
-	int gridHeight;             ///< Height of the grid in cells
-	int cellWidth;              ///< Width of any given cell in pixels
-	int cellHeight;             ///< Height of any given cell in pixels
+	JamEntityList** entityGrid;   ///< List of entity lists, made 2D through trickery (I hate 2D arrays)
+	JamWorldCellBoxes* cellBoxes; ///< The hitbox bounds of each cell of entityGrid, for jamWorldEntityCollision
+	int gridWidth;                ///< Width of the grid in cells
+	int gridHeight;               ///< Height of the grid in cells
+	int cellWidth;                ///< Width of any given cell in pixels
+	int cellHeight;               ///< Height of any given cell in pixels
+	bool autoTuneGrid;            ///< Weather or not jamWorldProcFrame occasionally retunes the cell size on its own
+	int framesSinceTune;          ///< Frames since autoTuneGrid last checked the spatial map
+	int cellsVisited;             ///< How many cells were looked at to find in-range entities last frame
+	bool drawGridHeatmap;         ///< Weather or not jamWorldProcFrame draws jamDrawWorldGridHeatmap over the entities
+
+	// The grid above is only used if broadphase is bp_Grid, otherwise entities are kept in the tree
+	JamBroadphaseType broadphase;   ///< Which of the two entities are sorted into (change with jamWorldSetBroadphase)
+	JamAABBTree* entityTree;        ///< Every entity's visible box when broadphase is bp_AABBTree (NULL otherwise)
+	pthread_mutex_t entityTreeLock; ///< Held while entityTree is changed, and while the caching thread walks it
+	JamEntityList* inRangeScratch;  ///< In-range entities found in the tree each frame when not caching
+
+	// Optional component storage, see Component.h
+	JamArchetype** archetypes; ///< Every component table in this world
+	uint32 archetypeCount;     ///< Number of component tables in this world
+
+	JamMessageBus* messageBus; ///< Messages waiting to be delivered, see Message.h
+	uint32 generations;        ///< Generations handed out to entities so far, see JamEntityHandle
+	JamEntity* spawnQueue;     ///< Entities from jamWorldSpawnEntity waiting to be added (newest first, only touch atomically)
+	JamContactCache* contacts; ///< Who was touching who as of the last frame, see Contact.h
 } JamWorld;
 
 /// \brief Creates a world to work with
@@ -69,10 +149,38 @@ JamWorld* jamWorldCreate(int gridWidth, int gridHeight, int cellWidth, int cellH
 /// 		ent = jamWorldEntityCollision(world, entity, x, y);
 ///		}
 ///
+/// Where the loop is up to is kept per thread, so any number of threads
+/// can loop their own entities at once so long as nothing in the world is
+/// being moved, added, or removed while they do.
+///
+/// With the grid, other entities are only looked at if the hitbox bounds they
+/// had when they were last updated overlap ent's, so an entity moved by something
+/// else's onFrame is found where it was until its own turn comes.
 ///
 /// \throws ERROR_NULL_POINTER
 JamEntity* jamWorldEntityCollision(JamWorld* world, JamEntity* ent, double x, double y);
 
+/// \brief Switches the structure a world sorts its entities into
+///
+/// Every entity is moved over in one pass. The grid's cell size is kept
+/// around, so switching back to bp_Grid later puts everything back into
+/// a grid of the same size.
+///
+/// \warning Don't call this from inside a behaviour's function, the world
+/// has to lock its spatial map to do this safely.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_ALLOC_FAILED
+void jamWorldSetBroadphase(JamWorld* world, JamBroadphaseType broadphase);
+
+/// \brief Finds the spatial map cells an entity at x/y could collide with anything in
+///
+/// \param cells Where to put the cells (indices into `entityGrid`), needs room for 4
+/// \return Returns how many different cells there are
+///
+/// \warning This is for in-engine use
+int _jamWorldEntityCells(JamWorld* world, JamEntity* ent, double x, double y, int* cells);
+
 /// \brief Enables entity caching for a given world if it isn't already enabled
 ///
 /// Assuming this function works, it will immediately halt the program to
@@ -93,11 +201,42 @@ void jamWorldEnableCaching(JamWorld* world);
 /// \throws ERROR_INCORRECT_FORMAT
 void jamWorldAddEntity(JamWorld *world, JamEntity *entity);
 
+/// \brief Queues an entity to be added to the world without ever waiting on a lock
+///
+/// jamWorldAddEntity has to wait for the caching thread to finish filtering
+/// before it can touch the spatial map, which can stall a frame. This instead
+/// pushes the entity onto a lock-free queue and returns immediately, and it is
+/// safe to call from any thread at any time (an asset streaming thread for
+/// example). At the start of each jamWorldProcFrame the queue is emptied into
+/// the world all at once in the order entities were spawned, unless the caching
+/// thread is busy in which case they wait until the next frame. onCreation
+/// is called when the entity actually enters the world, not when it is spawned.
+///
+/// \warning Don't touch the entity from other threads after spawning it, it
+/// belongs to the world from this point on.
+///
+/// \throws ERROR_NULL_POINTER
+void jamWorldSpawnEntity(JamWorld *world, JamEntity *entity);
+
+/// \brief Adds every entity waiting in the spawn queue to the world right now
+///
+/// Unlike the automatic flush in jamWorldProcFrame, this will wait for the
+/// caching thread if it needs to. Its handy after spawning a level's worth of
+/// entities that you want to exist before the first frame.
+///
+/// \throws ERROR_NULL_POINTER
+void jamWorldFlushSpawns(JamWorld *world);
+
 /// \brief Finds an entity in the world using its ID
 /// \throws ERROR_NULL_POINTER
 /// \throws ERROR_OUT_OF_BOUNDS
 JamEntity* jamWorldFindEntity(JamWorld *world, int id);
 
+/// \brief Finds an entity in the world using a handle from jamEntityGetHandle
+/// \return Returns the entity or NULL if it is no longer in the world
+/// \throws ERROR_NULL_POINTER
+JamEntity* jamWorldFindEntityHandle(JamWorld *world, JamEntityHandle handle);
+
 /// \brief Finds an entity's id from the entity's type (if there are multiple, the first one found is returned)
 /// \throws ERROR_NULL_POINTER
 int jamWorldFindEntityType(JamWorld* world, uint32 type);
@@ -134,6 +273,60 @@ void jamWorldDestroyEntity(JamEntity* entity);
 /// \throws ERROR_NULL_POINTER
 void jamWorldFilter(JamWorld *world);
 
+/// \brief Gathers statistics on how the world's entities are spread across its spatial map
+/// \throws ERROR_NULL_POINTER
+void jamWorldGetGridStats(JamWorld* world, JamWorldGridStats* stats);
+
+/// \brief Gets information on a single cell of a world's spatial map
+///
+/// Any cell outside the grid will give you the overflow cell (where
+/// every out-of-bounds entity goes).
+///
+/// \throws ERROR_NULL_POINTER
+void jamWorldGetCellStats(JamWorld* world, int cellX, int cellY, JamWorldCellStats* stats);
+
+/// \brief Draws a heatmap of how many entities are in each on-screen cell of a world's spatial map
+///
+/// Empty cells are left alone, and cells go from blue to red the closer
+/// they are to the busiest cell on screen. Each cell is also outlined so
+/// you can see the grid itself. This is meant for tuning the cell size of
+/// a level and spotting hotspots, not for release builds.
+///
+/// \param alpha How opaque the heatmap is
+///
+/// \throws ERROR_NULL_POINTER
+void jamDrawWorldGridHeatmap(JamWorld* world, uint8 alpha);
+
+/// \brief Rebuilds the world's spatial map with a new cell size
+///
+/// The new grid covers at least as much of the game world as the
+/// old one did (plus any entities that were out of bounds), and every
+/// entity is moved into it in one pass. The entities themselves are
+/// not touched beyond their cell information, so any pointers to them
+/// stay valid.
+///
+/// \warning Don't call this from inside a behaviour's function, the world
+/// has to lock its spatial map to do this safely.
+///
+/// \throws ERROR_NULL_POINTER
+/// \throws ERROR_ALLOC_FAILED
+/// \throws ERROR_OUT_OF_BOUNDS
+void jamWorldResizeGrid(JamWorld* world, int cellWidth, int cellHeight);
+
+/// \brief Picks a cell size based on the world's entities and rebuilds the spatial map if its better
+///
+/// The chosen cell size is twice the average entity size, which keeps most
+/// entities in one or two cells without putting too many in each. Nothing
+/// happens if the world has no entities with sprites or the size is already
+/// close enough. This is called once after a world is loaded from a tmx file,
+/// and every GRID_TUNE_INTERVAL frames by jamWorldProcFrame if autoTuneGrid is
+/// on. Worlds using bp_AABBTree are left alone.
+///
+/// \return Returns true if the grid was rebuilt
+///
+/// \throws ERROR_NULL_POINTER
+bool jamWorldAutoTuneGrid(JamWorld* world);
+
 /// \brief Frees a world
 ///
 /// Please be aware that this will not free tile maps, only the entities
@@ -0,0 +1,411 @@
+#include "AABBTree.h"
+#include "JamError.h"
+#include <malloc.h>
+#include <string.h>
+
+/// \brief Half the perimeter of a box, which is what 2D surface area heuristics care about
+static inline double _perimeter(double x1, double y1, double x2, double y2) {
+	return (x2 - x1) + (y2 - y1);
+}
+
+/// \brief Perimeter of the box around two nodes
+static inline double _unionPerimeter(JamAABBTreeNode* a, JamAABBTreeNode* b) {
+	return _perimeter(a->x1 < b->x1 ? a->x1 : b->x1, a->y1 < b->y1 ? a->y1 : b->y1,
+					  a->x2 > b->x2 ? a->x2 : b->x2, a->y2 > b->y2 ? a->y2 : b->y2);
+}
+
+static inline double _nodePerimeter(JamAABBTreeNode* node) {
+	return _perimeter(node->x1, node->y1, node->x2, node->y2);
+}
+
+/// \brief Grabs a node off the free list, growing the node array if there are none, returns AABB_TREE_NULL on failure
+static int _allocNode(JamAABBTree* tree) {
+	JamAABBTreeNode* newNodes;
+	int newCapacity, i, node;
+
+	if (tree->freeList == AABB_TREE_NULL) {
+		newCapacity = tree->capacity == 0 ? 16 : tree->capacity * 2;
+		newNodes = (JamAABBTreeNode*)realloc(tree->nodes, newCapacity * sizeof(JamAABBTreeNode));
+		if (newNodes == NULL)
+			return AABB_TREE_NULL;
+
+		// Chain all the new nodes into the free list
+		for (i = tree->capacity; i < newCapacity; i++) {
+			newNodes[i].parent = i + 1 < newCapacity ? i + 1 : AABB_TREE_NULL;
+			newNodes[i].height = -1;
+		}
+		tree->nodes = newNodes;
+		tree->freeList = tree->capacity;
+		tree->capacity = newCapacity;
+	}
+
+	node = tree->freeList;
+	tree->freeList = tree->nodes[node].parent;
+	tree->nodes[node].parent = AABB_TREE_NULL;
+	tree->nodes[node].child1 = AABB_TREE_NULL;
+	tree->nodes[node].child2 = AABB_TREE_NULL;
+	tree->nodes[node].height = 0;
+	tree->nodes[node].data = NULL;
+	tree->count++;
+	return node;
+}
+
+static void _freeNode(JamAABBTree* tree, int node) {
+	tree->nodes[node].parent = tree->freeList;
+	tree->nodes[node].height = -1;
+	tree->freeList = node;
+	tree->count--;
+}
+
+/// \brief Recalculates a branch's box and height from its children
+static void _refit(JamAABBTree* tree, int node) {
+	JamAABBTreeNode* n = &tree->nodes[node];
+	JamAABBTreeNode* c1 = &tree->nodes[n->child1];
+	JamAABBTreeNode* c2 = &tree->nodes[n->child2];
+
+	n->x1 = c1->x1 < c2->x1 ? c1->x1 : c2->x1;
+	n->y1 = c1->y1 < c2->y1 ? c1->y1 : c2->y1;
+	n->x2 = c1->x2 > c2->x2 ? c1->x2 : c2->x2;
+	n->y2 = c1->y2 > c2->y2 ? c1->y2 : c2->y2;
+	n->height = 1 + (c1->height > c2->height ? c1->height : c2->height);
+}
+
+/// \brief Swaps the node in slot (a child of parent) with the node in otherSlot (a child of otherParent)
+static inline void _swapNodes(JamAABBTree* tree, int* slot, int parent, int* otherSlot, int otherParent) {
+	int node = *slot;
+	int other = *otherSlot;
+
+	*slot = other;
+	tree->nodes[other].parent = parent;
+	*otherSlot = node;
+	tree->nodes[node].parent = otherParent;
+}
+
+/// \brief Swaps one of a node's children with a grandchild under its other child if that shrinks the tree
+///
+/// With children B and C, swapping B with one of C's children F/G changes
+/// nothing but C's box, so the best rotation is whichever shrinks the
+/// child it touches the most. The node's own box stays the same.
+static void _rotate(JamAABBTree* tree, int node) {
+	JamAABBTreeNode* a = &tree->nodes[node];
+	JamAABBTreeNode* b;
+	JamAABBTreeNode* c;
+	int iB, iC;
+	double bestGain = 0;
+	double gain;
+	int best = 0;
+
+	if (a->height < 2)
+		return;
+
+	iB = a->child1;
+	iC = a->child2;
+	b = &tree->nodes[iB];
+	c = &tree->nodes[iC];
+
+	// 1/2: B swapped with C's first/second child, 3/4: C swapped with B's first/second child
+	if (c->height > 0) {
+		gain = _nodePerimeter(c) - _unionPerimeter(b, &tree->nodes[c->child2]);
+		if (gain > bestGain) {
+			bestGain = gain;
+			best = 1;
+		}
+		gain = _nodePerimeter(c) - _unionPerimeter(b, &tree->nodes[c->child1]);
+		if (gain > bestGain) {
+			bestGain = gain;
+			best = 2;
+		}
+	}
+	if (b->height > 0) {
+		gain = _nodePerimeter(b) - _unionPerimeter(c, &tree->nodes[b->child2]);
+		if (gain > bestGain) {
+			bestGain = gain;
+			best = 3;
+		}
+		gain = _nodePerimeter(b) - _unionPerimeter(c, &tree->nodes[b->child1]);
+		if (gain > bestGain) {
+			bestGain = gain;
+			best = 4;
+		}
+	}
+
+	if (best == 1) {
+		_swapNodes(tree, &a->child1, node, &c->child1, iC);
+		_refit(tree, iC);
+	} else if (best == 2) {
+		_swapNodes(tree, &a->child1, node, &c->child2, iC);
+		_refit(tree, iC);
+	} else if (best == 3) {
+		_swapNodes(tree, &a->child2, node, &b->child1, iB);
+		_refit(tree, iB);
+	} else if (best == 4) {
+		_swapNodes(tree, &a->child2, node, &b->child2, iB);
+		_refit(tree, iB);
+	}
+
+	if (best != 0)
+		_refit(tree, node);
+}
+
+/// \brief Refits and rotates every node from a node up to the root
+static void _fixUpwards(JamAABBTree* tree, int node) {
+	while (node != AABB_TREE_NULL) {
+		_refit(tree, node);
+		_rotate(tree, node);
+		node = tree->nodes[node].parent;
+	}
+}
+
+/// \brief Cost of putting a leaf somewhere under a child, not counting what the nodes above will pay
+static inline double _descendCost(JamAABBTree* tree, int child, JamAABBTreeNode* leaf) {
+	JamAABBTreeNode* c = &tree->nodes[child];
+	if (c->height == 0)
+		return _unionPerimeter(c, leaf);
+	return _unionPerimeter(c, leaf) - _nodePerimeter(c);
+}
+
+/// \brief Finds the cheapest sibling for a leaf and puts it there, returns false if the parent couldn't be made
+static bool _insertLeaf(JamAABBTree* tree, int leaf) {
+	JamAABBTreeNode* n;
+	int index, sibling, oldParent, newParent;
+	double combined, cost, inherit, cost1, cost2;
+
+	if (tree->root == AABB_TREE_NULL) {
+		tree->root = leaf;
+		tree->nodes[leaf].parent = AABB_TREE_NULL;
+		return true;
+	}
+
+	// Walk down while it's cheaper to push the leaf into a child than to pair it with this node
+	index = tree->root;
+	while (tree->nodes[index].height > 0) {
+		n = &tree->nodes[index];
+		combined = _unionPerimeter(n, &tree->nodes[leaf]);
+		cost = 2 * combined;
+		inherit = 2 * (combined - _nodePerimeter(n));
+		cost1 = _descendCost(tree, n->child1, &tree->nodes[leaf]) + inherit;
+		cost2 = _descendCost(tree, n->child2, &tree->nodes[leaf]) + inherit;
+
+		if (cost < cost1 && cost < cost2)
+			break;
+		index = cost1 < cost2 ? n->child1 : n->child2;
+	}
+	sibling = index;
+
+	// The new parent may move the node array so only indices are kept across it
+	newParent = _allocNode(tree);
+	if (newParent == AABB_TREE_NULL)
+		return false;
+	oldParent = tree->nodes[sibling].parent;
+	tree->nodes[newParent].parent = oldParent;
+	tree->nodes[newParent].child1 = sibling;
+	tree->nodes[newParent].child2 = leaf;
+	tree->nodes[sibling].parent = newParent;
+	tree->nodes[leaf].parent = newParent;
+
+	if (oldParent == AABB_TREE_NULL)
+		tree->root = newParent;
+	else if (tree->nodes[oldParent].child1 == sibling)
+		tree->nodes[oldParent].child1 = newParent;
+	else
+		tree->nodes[oldParent].child2 = newParent;
+
+	_fixUpwards(tree, newParent);
+	return true;
+}
+
+/// \brief Unhooks a leaf from the tree without freeing it
+static void _removeLeaf(JamAABBTree* tree, int leaf) {
+	int parent, grandParent, sibling;
+
+	if (leaf == tree->root) {
+		tree->root = AABB_TREE_NULL;
+		return;
+	}
+
+	// The leaf's sibling takes its parent's place
+	parent = tree->nodes[leaf].parent;
+	grandParent = tree->nodes[parent].parent;
+	sibling = tree->nodes[parent].child1 == leaf ? tree->nodes[parent].child2 : tree->nodes[parent].child1;
+
+	if (grandParent != AABB_TREE_NULL) {
+		if (tree->nodes[grandParent].child1 == parent)
+			tree->nodes[grandParent].child1 = sibling;
+		else
+			tree->nodes[grandParent].child2 = sibling;
+		tree->nodes[sibling].parent = grandParent;
+		_freeNode(tree, parent);
+		_fixUpwards(tree, grandParent);
+	} else {
+		tree->root = sibling;
+		tree->nodes[sibling].parent = AABB_TREE_NULL;
+		_freeNode(tree, parent);
+	}
+}
+
+static inline void _setFatBox(JamAABBTree* tree, int leaf, double x1, double y1, double x2, double y2) {
+	tree->nodes[leaf].x1 = x1 - tree->margin;
+	tree->nodes[leaf].y1 = y1 - tree->margin;
+	tree->nodes[leaf].x2 = x2 + tree->margin;
+	tree->nodes[leaf].y2 = y2 + tree->margin;
+}
+
+static inline bool _isLeaf(JamAABBTree* tree, int proxy) {
+	return proxy >= 0 && proxy < tree->capacity && tree->nodes[proxy].height == 0;
+}
+
+///////////////////////////////////////////////////////////////
+JamAABBTree* jamAABBTreeCreate(double margin) {
+	JamAABBTree* tree = (JamAABBTree*)calloc(1, sizeof(JamAABBTree));
+
+	if (tree != NULL) {
+		tree->root = AABB_TREE_NULL;
+		tree->freeList = AABB_TREE_NULL;
+		tree->margin = margin;
+	} else {
+		jSetError(ERROR_ALLOC_FAILED, "Failed to allocate AABB tree (jamAABBTreeCreate)");
+	}
+
+	return tree;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+int jamAABBTreeInsert(JamAABBTree* tree, void* data, double x1, double y1, double x2, double y2) {
+	int leaf = AABB_TREE_NULL;
+
+	if (tree != NULL) {
+		leaf = _allocNode(tree);
+		if (leaf != AABB_TREE_NULL) {
+			tree->nodes[leaf].data = data;
+			_setFatBox(tree, leaf, x1, y1, x2, y2);
+			if (!_insertLeaf(tree, leaf)) {
+				_freeNode(tree, leaf);
+				leaf = AABB_TREE_NULL;
+			}
+		}
+
+		if (leaf == AABB_TREE_NULL)
+			jSetError(ERROR_REALLOC_FAILED, "Failed to grow AABB tree (jamAABBTreeInsert)");
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Tree does not exist (jamAABBTreeInsert)");
+	}
+
+	return leaf;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void jamAABBTreeRemove(JamAABBTree* tree, int proxy) {
+	if (tree != NULL && _isLeaf(tree, proxy)) {
+		_removeLeaf(tree, proxy);
+		_freeNode(tree, proxy);
+	} else {
+		if (tree == NULL)
+			jSetError(ERROR_NULL_POINTER, "Tree does not exist (jamAABBTreeRemove)");
+		else
+			jSetError(ERROR_OUT_OF_BOUNDS, "Proxy %i is not a leaf (jamAABBTreeRemove)", proxy);
+	}
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+bool jamAABBTreeMove(JamAABBTree* tree, int proxy, double x1, double y1, double x2, double y2) {
+	JamAABBTreeNode* leaf;
+
+	if (tree != NULL && _isLeaf(tree, proxy)) {
+		// Still inside its fat box, so the tree doesn't need to know
+		leaf = &tree->nodes[proxy];
+		if (x1 >= leaf->x1 && y1 >= leaf->y1 && x2 <= leaf->x2 && y2 <= leaf->y2)
+			return false;
+
+		// Taking the leaf out frees a branch, so putting it back in never needs to allocate
+		_removeLeaf(tree, proxy);
+		_setFatBox(tree, proxy, x1, y1, x2, y2);
+		_insertLeaf(tree, proxy);
+		return true;
+	} else {
+		if (tree == NULL)
+			jSetError(ERROR_NULL_POINTER, "Tree does not exist (jamAABBTreeMove)");
+		else
+			jSetError(ERROR_OUT_OF_BOUNDS, "Proxy %i is not a leaf (jamAABBTreeMove)", proxy);
+	}
+
+	return false;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void jamAABBTreeQuery(JamAABBTree* tree, double x1, double y1, double x2, double y2, JamAABBTreeCallback callback, void* userData) {
+	int localStack[AABB_TREE_STACK_SIZE];
+	int* stack = localStack;
+	int* newStack;
+	int capacity = AABB_TREE_STACK_SIZE;
+	int top = 0;
+	JamAABBTreeNode* n;
+
+	if (tree != NULL && callback != NULL) {
+		if (tree->root != AABB_TREE_NULL)
+			stack[top++] = tree->root;
+
+		while (top > 0) {
+			n = &tree->nodes[stack[--top]];
+			if (n->x1 > x2 || n->x2 < x1 || n->y1 > y2 || n->y2 < y1)
+				continue;
+
+			if (n->height == 0) {
+				if (!callback(n->data, userData))
+					break;
+			} else {
+				// Lopsided trees can be deeper than the stack on hand
+				if (top + 2 > capacity) {
+					newStack = (int*)malloc(capacity * 2 * sizeof(int));
+					if (newStack == NULL) {
+						jSetError(ERROR_ALLOC_FAILED, "Failed to grow query stack (jamAABBTreeQuery)");
+						break;
+					}
+					memcpy(newStack, stack, top * sizeof(int));
+					if (stack != localStack)
+						free(stack);
+					stack = newStack;
+					capacity *= 2;
+				}
+
+				// Second child goes on first so the first child is looked at first
+				stack[top++] = n->child2;
+				stack[top++] = n->child1;
+			}
+		}
+
+		if (stack != localStack)
+			free(stack);
+	} else {
+		if (tree == NULL)
+			jSetError(ERROR_NULL_POINTER, "Tree does not exist (jamAABBTreeQuery)");
+		if (callback == NULL)
+			jSetError(ERROR_NULL_POINTER, "Callback does not exist (jamAABBTreeQuery)");
+	}
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+int jamAABBTreeGetHeight(JamAABBTree* tree) {
+	if (tree != NULL) {
+		if (tree->root != AABB_TREE_NULL)
+			return tree->nodes[tree->root].height;
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Tree does not exist (jamAABBTreeGetHeight)");
+	}
+
+	return 0;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void jamAABBTreeFree(JamAABBTree* tree) {
+	if (tree != NULL) {
+		free(tree->nodes);
+		free(tree);
+	}
+}
+///////////////////////////////////////////////////////////////
@@ -5,6 +5,7 @@
 #include "AssetHandler.h"
 #include "INI.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <INI.h>
 #include <StringMap.h>
@@ -136,6 +137,7 @@ static void _assetLoadEntity(JamAssetHandler *assetHandler, JamINI *ini, const c
 	JamEntity* ent;
 	const char* typeString;
 	const char* behaviourString;
+	uint32 frame;
 	// Make sure we have all necessary assets
 	if (jamGetAssetFromHandler(assetHandler, (jamINIGetKey(ini, headerName, "sprite_id", "0"))) != NULL
 		&& jamGetAssetFromHandler(assetHandler, (jamINIGetKey(ini, headerName, "hitbox_id", "0"))) != NULL) {
@@ -153,12 +155,25 @@ static void _assetLoadEntity(JamAssetHandler *assetHandler, JamINI *ini, const c
 		// Alert the user if a behaviour was expected but not found
 		if (strcmp(behaviourString, "default") != 0 && ent->behaviour == NULL)
 			jSetError(ERROR_WARNING, "Expected behaviour '%s' for entity '%s'", behaviourString, headerName);
+
+		// Pixel masks are built now so the first collision doesn't have to, sized to the sprite if no size was given
+		if (ent->hitbox != NULL && ent->hitbox->type == ht_PixelMask && ent->sprite != NULL) {
+			if (ent->hitbox->width == 0 && ent->hitbox->height == 0) {
+				ent->hitbox->width = ent->sprite->width;
+				ent->hitbox->height = ent->sprite->height;
+			}
+			for (frame = 0; frame < ent->sprite->animationLength; frame++)
+				jamPixelMaskFromSprite(ent->sprite, frame);
+		}
 		
 		// Figure out the type
 		ent->type = (uint32)atof(jamINIGetKey(ini, headerName, "type", "none"));
 		ent->rot = atof(jamINIGetKey(ini, headerName, "rotation", "0"));
 		ent->alpha = (uint8)atof(jamINIGetKey(ini, headerName, "alpha", "255"));
 		ent->updateOnDraw = (bool)atof(jamINIGetKey(ini, headerName, "update_on_draw", "1"));
+		ent->components = jamComponentMaskFromString(jamINIGetKey(ini, headerName, "components", ""));
+		ent->collisionLayer = (uint32)strtoul(jamINIGetKey(ini, headerName, "collision_layer", "1"), NULL, 0);
+		ent->collisionMask = (uint32)strtoul(jamINIGetKey(ini, headerName, "collision_mask", "0xffffffff"), NULL, 0);
 		jamAssetHandlerLoadAsset(assetHandler, createAsset(ent, at_Entity, headerName + 1), (headerName + 1));
 	} else {
 		jSetError(ERROR_ASSET_NOT_FOUND, "Failed to load entity of id %s (jamAssetHandlerLoadINI)", headerName + 1);
@@ -171,6 +186,7 @@ static void _assetLoadHitbox(JamAssetHandler *assetHandler, JamINI *ini, const c
 	if (strcmp(key, "rectangle") == 0) hType = ht_Rectangle;
 	else if (strcmp(key, "cirlce") == 0) hType = ht_Circle;
 	else if (strcmp(key, "polygon") == 0) hType = ht_ConvexPolygon;
+	else if (strcmp(key, "pixelmask") == 0) hType = ht_PixelMask;
 	jamAssetHandlerLoadAsset(
 			assetHandler,
 			createAsset(jamHitboxCreate(
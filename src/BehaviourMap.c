@@ -38,6 +38,10 @@ void jamBehaviourMapAdd(JamBehaviourMap *map, const char *name, void (*onCreatio
 			behaviour->onDestruction = onDestruction;
 			behaviour->onFrame = onFrame;
 			behaviour->onDraw = onDraw;
+			behaviour->onMessage = NULL;
+			behaviour->onCollisionEnter = NULL;
+			behaviour->onCollisionStay = NULL;
+			behaviour->onCollisionExit = NULL;
 		} else {
 			jSetError(ERROR_REALLOC_FAILED, "Failed to reallocate map (jamBehaviourMapAdd)");
 		}
@@ -0,0 +1,329 @@
+#include "Component.h"
+#include "World.h"
+#include "Entity.h"
+#include "JamError.h"
+#include "File.h"
+#include <malloc.h>
+#include <string.h>
+
+// The global component registry, the tables themselves belong to each world
+static const char* gComponentNames[MAX_COMPONENTS];
+static uint32 gComponentSizes[MAX_COMPONENTS];
+static int gComponentCount;
+
+///////////////////////////////////////////////////////////////
+int jamComponentRegister(const char* name, uint32 size) {
+	int id = -1;
+
+	if (name != NULL) {
+		id = jamComponentFind(name);
+
+		if (id != -1 && gComponentSizes[id] != size) {
+			jSetError(ERROR_INCORRECT_FORMAT, "Component %s was already registered with a different size (jamComponentRegister)", name);
+			id = -1;
+		} else if (id == -1 && gComponentCount < MAX_COMPONENTS) {
+			id = gComponentCount++;
+			gComponentNames[id] = name;
+			gComponentSizes[id] = size;
+		} else if (id == -1) {
+			jSetError(ERROR_OUT_OF_BOUNDS, "No more than %i components may be registered (jamComponentRegister)", MAX_COMPONENTS);
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Component name does not exist (jamComponentRegister)");
+	}
+
+	return id;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+int jamComponentFind(const char* name) {
+	int i;
+
+	if (name != NULL)
+		for (i = 0; i < gComponentCount; i++)
+			if (strcmp(gComponentNames[i], name) == 0)
+				return i;
+
+	return -1;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+JamComponentMask jamComponentMaskFromString(const char* names) {
+	JamComponentMask mask = 0;
+	JamStringList* list;
+	int i, id;
+
+	if (names != NULL && names[0] != 0) {
+		list = jamStringExplode(names, ',', false);
+
+		if (list != NULL) {
+			for (i = 0; i < list->size; i++) {
+				id = jamComponentFind(list->strList[i]);
+				if (id != -1)
+					mask |= COMPONENT_BIT(id);
+				else
+					jSetError(ERROR_ASSET_NOT_FOUND, "Component %s has not been registered (jamComponentMaskFromString)", list->strList[i]);
+			}
+		}
+
+		jamStringListFree(list);
+	}
+
+	return mask;
+}
+///////////////////////////////////////////////////////////////
+
+/// \brief Finds the archetype for a mask in a world or creates it, returns -1 if it fails
+static int _findArchetype(JamWorld* world, JamComponentMask mask) {
+	JamArchetype** newList;
+	JamArchetype* arch;
+	uint32 i;
+
+	for (i = 0; i < world->archetypeCount; i++)
+		if (world->archetypes[i]->mask == mask)
+			return i;
+
+	newList = (JamArchetype**)realloc(world->archetypes, (world->archetypeCount + 1) * sizeof(JamArchetype*));
+	arch = (JamArchetype*)calloc(1, sizeof(JamArchetype));
+
+	if (newList != NULL && arch != NULL) {
+		arch->mask = mask;
+		world->archetypes = newList;
+		world->archetypes[world->archetypeCount] = arch;
+		return world->archetypeCount++;
+	} else {
+		if (newList != NULL)
+			world->archetypes = newList;
+		free(arch);
+		jSetError(ERROR_REALLOC_FAILED, "Failed to create archetype (_findArchetype)");
+	}
+
+	return -1;
+}
+
+/// \brief Makes sure an archetype has room for one more row
+static bool _reserveRow(JamArchetype* arch) {
+	uint32 newCapacity;
+	JamEntity** newEntities;
+	uint8* newColumn;
+	int i;
+
+	if (arch->size < arch->capacity)
+		return true;
+
+	newCapacity = arch->capacity == 0 ? ENTITY_LIST_ALLOCATION_AMOUNT : arch->capacity * 2;
+	newEntities = (JamEntity**)realloc(arch->entities, newCapacity * sizeof(JamEntity*));
+	if (newEntities == NULL) {
+		jSetError(ERROR_REALLOC_FAILED, "Failed to grow archetype (_reserveRow)");
+		return false;
+	}
+	arch->entities = newEntities;
+
+	for (i = 0; i < gComponentCount; i++) {
+		if (arch->mask & COMPONENT_BIT(i)) {
+			newColumn = (uint8*)realloc(arch->columns[i], newCapacity * gComponentSizes[i]);
+			if (newColumn == NULL) {
+				jSetError(ERROR_REALLOC_FAILED, "Failed to grow archetype column (_reserveRow)");
+				return false;
+			}
+			arch->columns[i] = newColumn;
+		}
+	}
+
+	arch->capacity = newCapacity;
+	return true;
+}
+
+/// \brief Takes a row out of an archetype by moving the last row into its place
+static void _removeRow(JamArchetype* arch, uint32 row) {
+	uint32 last = arch->size - 1;
+	int i;
+
+	if (row != last) {
+		for (i = 0; i < gComponentCount; i++)
+			if (arch->mask & COMPONENT_BIT(i))
+				memcpy(arch->columns[i] + row * gComponentSizes[i], arch->columns[i] + last * gComponentSizes[i], gComponentSizes[i]);
+		arch->entities[row] = arch->entities[last];
+		arch->entities[row]->archetypeRow = row;
+	}
+
+	arch->entities[last] = NULL;
+	arch->size--;
+}
+
+/// \brief Moves an entity from whatever table it is in to the table for mask, copying shared components
+static bool _moveEntity(JamWorld* world, JamEntity* ent, JamComponentMask mask) {
+	JamArchetype* from = ent->archetype != -1 ? world->archetypes[ent->archetype] : NULL;
+	JamArchetype* to;
+	int index;
+	uint32 row;
+	int i;
+
+	if (mask == 0) {
+		if (from != NULL)
+			_removeRow(from, ent->archetypeRow);
+		ent->archetype = -1;
+		ent->archetypeRow = 0;
+		ent->components = 0;
+		return true;
+	}
+
+	index = _findArchetype(world, mask);
+	if (index == -1)
+		return false;
+	to = world->archetypes[index];
+
+	if (!_reserveRow(to))
+		return false;
+
+	// Copy over what both tables have in common and zero what's new
+	row = to->size;
+	for (i = 0; i < gComponentCount; i++) {
+		if (mask & COMPONENT_BIT(i)) {
+			if (from != NULL && (from->mask & COMPONENT_BIT(i)))
+				memcpy(to->columns[i] + row * gComponentSizes[i], from->columns[i] + ent->archetypeRow * gComponentSizes[i], gComponentSizes[i]);
+			else
+				memset(to->columns[i] + row * gComponentSizes[i], 0, gComponentSizes[i]);
+		}
+	}
+	to->entities[row] = ent;
+	to->size++;
+
+	if (from != NULL)
+		_removeRow(from, ent->archetypeRow);
+
+	ent->archetype = index;
+	ent->archetypeRow = row;
+	ent->components = mask;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////
+void* jamComponentAdd(JamWorld* world, JamEntity* entity, int id) {
+	if (world != NULL && entity != NULL && id >= 0 && id < gComponentCount) {
+		if (entity->id == ID_NOT_ASSIGNED) {
+			jSetError(ERROR_INCORRECT_FORMAT, "Entity must be in a world to add components, use the components field instead (jamComponentAdd)");
+		} else if (entity->archetype != -1 && (entity->components & COMPONENT_BIT(id))) {
+			return jamComponentGet(world, entity, id);
+		} else if (_moveEntity(world, entity, (entity->archetype != -1 ? entity->components : 0) | COMPONENT_BIT(id))) {
+			return jamComponentGet(world, entity, id);
+		}
+	} else {
+		if (world == NULL)
+			jSetError(ERROR_NULL_POINTER, "World does not exist (jamComponentAdd)");
+		if (entity == NULL)
+			jSetError(ERROR_NULL_POINTER, "Entity does not exist (jamComponentAdd)");
+		if (id < 0 || id >= gComponentCount)
+			jSetError(ERROR_OUT_OF_BOUNDS, "Component %i has not been registered (jamComponentAdd)", id);
+	}
+
+	return NULL;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void jamComponentRemove(JamWorld* world, JamEntity* entity, int id) {
+	if (world != NULL && entity != NULL && id >= 0 && id < gComponentCount) {
+		if (entity->archetype != -1 && (entity->components & COMPONENT_BIT(id)))
+			_moveEntity(world, entity, entity->components & ~COMPONENT_BIT(id));
+	} else {
+		if (world == NULL)
+			jSetError(ERROR_NULL_POINTER, "World does not exist (jamComponentRemove)");
+		if (entity == NULL)
+			jSetError(ERROR_NULL_POINTER, "Entity does not exist (jamComponentRemove)");
+		if (id < 0 || id >= gComponentCount)
+			jSetError(ERROR_OUT_OF_BOUNDS, "Component %i has not been registered (jamComponentRemove)", id);
+	}
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void* jamComponentGet(JamWorld* world, JamEntity* entity, int id) {
+	JamArchetype* arch;
+
+	if (world != NULL && entity != NULL) {
+		if (entity->archetype != -1 && id >= 0 && id < gComponentCount && (entity->components & COMPONENT_BIT(id))) {
+			arch = world->archetypes[entity->archetype];
+			return arch->columns[id] + entity->archetypeRow * gComponentSizes[id];
+		}
+	} else {
+		if (world == NULL)
+			jSetError(ERROR_NULL_POINTER, "World does not exist (jamComponentGet)");
+		if (entity == NULL)
+			jSetError(ERROR_NULL_POINTER, "Entity does not exist (jamComponentGet)");
+	}
+
+	return NULL;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+JamArchetype* jamComponentQuery(JamWorld* world, JamComponentMask mask, uint32* iterator) {
+	JamArchetype* arch;
+
+	if (world != NULL && iterator != NULL) {
+		while (*iterator < world->archetypeCount) {
+			arch = world->archetypes[(*iterator)++];
+			if (arch->size > 0 && (arch->mask & mask) == mask)
+				return arch;
+		}
+	} else {
+		if (world == NULL)
+			jSetError(ERROR_NULL_POINTER, "World does not exist (jamComponentQuery)");
+		if (iterator == NULL)
+			jSetError(ERROR_NULL_POINTER, "Iterator does not exist (jamComponentQuery)");
+	}
+
+	return NULL;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void* jamComponentColumn(JamArchetype* archetype, int id) {
+	if (archetype != NULL) {
+		if (id >= 0 && id < MAX_COMPONENTS)
+			return archetype->columns[id];
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Archetype does not exist (jamComponentColumn)");
+	}
+
+	return NULL;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void _jamComponentAttach(JamWorld* world, JamEntity* entity) {
+	// Entities copied from an asset only carry the mask they want, not a row
+	entity->archetype = -1;
+	if (entity->components != 0)
+		_moveEntity(world, entity, entity->components);
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void _jamComponentDetach(JamWorld* world, JamEntity* entity) {
+	if (entity->archetype != -1) {
+		_removeRow(world->archetypes[entity->archetype], entity->archetypeRow);
+		entity->archetype = -1;
+	}
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void _jamComponentFreeTables(JamWorld* world) {
+	uint32 i;
+	int j;
+
+	for (i = 0; i < world->archetypeCount; i++) {
+		for (j = 0; j < MAX_COMPONENTS; j++)
+			free(world->archetypes[i]->columns[j]);
+		free(world->archetypes[i]->entities);
+		free(world->archetypes[i]);
+	}
+	free(world->archetypes);
+	world->archetypes = NULL;
+	world->archetypeCount = 0;
+}
+///////////////////////////////////////////////////////////////
@@ -0,0 +1,312 @@
+#include "Contact.h"
+#include "World.h"
+#include "Entity.h"
+#include "JamError.h"
+#include <malloc.h>
+#include <stdlib.h>
+
+/// \brief Everything about an entity that decides what it collides with
+typedef struct {
+	double x;
+	double y;
+	double rot;
+	float scaleX;
+	float scaleY;
+	double hitboxOffsetX;
+	double hitboxOffsetY;
+	JamHitbox* hitbox;
+	JamSprite* sprite;
+	uint32 currentFrame;
+} _JamContactPose;
+
+/// \brief One entity touching another
+typedef struct {
+	uint64 key;                 ///< Entity's id in the high 32 bits and other's in the low 32, contacts are sorted by this
+	JamEntity* entity;          ///< Entity that is told about the contact
+	JamEntity* other;           ///< What it is touching
+	_JamContactPose entityPose; ///< Where entity was when the contact was found
+	_JamContactPose otherPose;  ///< Where other was when the contact was found
+} _JamContact;
+
+struct _JamContactCache {
+	_JamContact* contacts; ///< Contacts as of the last update, sorted by key
+	uint32 size;           ///< Number of contacts
+	uint32 capacity;       ///< Contacts allocated
+	_JamContact* found;    ///< Contacts found during an update, these become contacts once its done
+	uint32 foundSize;      ///< Number of contacts found so far
+	uint32 foundCapacity;  ///< Contacts allocated in found
+};
+
+/// \brief Grows an array of contacts to hold at least count contacts, returns false if it can't
+static bool _reserveContacts(_JamContact** contacts, uint32* capacity, uint32 count) {
+	uint32 newCapacity;
+	_JamContact* newContacts;
+
+	if (count <= *capacity)
+		return true;
+
+	newCapacity = *capacity == 0 ? 64 : *capacity;
+	while (newCapacity < count)
+		newCapacity *= 2;
+	newContacts = (_JamContact*)realloc(*contacts, newCapacity * sizeof(_JamContact));
+	if (newContacts == NULL)
+		return false;
+
+	*contacts = newContacts;
+	*capacity = newCapacity;
+	return true;
+}
+
+/// \brief Records everything about an entity that could change what it collides with
+static inline void _recordPose(JamEntity* ent, _JamContactPose* pose) {
+	pose->x = ent->x;
+	pose->y = ent->y;
+	pose->rot = ent->rot;
+	pose->scaleX = ent->scaleX;
+	pose->scaleY = ent->scaleY;
+	pose->hitboxOffsetX = ent->hitboxOffsetX;
+	pose->hitboxOffsetY = ent->hitboxOffsetY;
+	pose->hitbox = ent->hitbox;
+	pose->sprite = ent->sprite;
+	pose->currentFrame = ent->currentFrame;
+}
+
+/// \brief Checks if an entity is still exactly where a pose says it was
+static inline bool _samePose(JamEntity* ent, _JamContactPose* pose) {
+	return pose->x == ent->x && pose->y == ent->y && pose->rot == ent->rot && pose->scaleX == ent->scaleX &&
+		   pose->scaleY == ent->scaleY && pose->hitboxOffsetX == ent->hitboxOffsetX &&
+		   pose->hitboxOffsetY == ent->hitboxOffsetY && pose->hitbox == ent->hitbox && pose->sprite == ent->sprite &&
+		   (ent->hitbox->type != ht_PixelMask || pose->currentFrame == ent->currentFrame);
+}
+
+/// \brief Weather or not a world needs to find contacts for an entity
+static inline bool _tracksContacts(JamEntity* ent) {
+	return ent->hitbox != NULL && ent->behaviour != NULL && (ent->behaviour->onCollisionEnter != NULL ||
+		   ent->behaviour->onCollisionStay != NULL || ent->behaviour->onCollisionExit != NULL);
+}
+
+static inline uint64 _contactKey(JamEntity* entity, JamEntity* other) {
+	return ((uint64)(uint32)entity->id << 32) | (uint32)other->id;
+}
+
+static int _compareContacts(const void* a, const void* b) {
+	uint64 keyA = ((const _JamContact*)a)->key;
+	uint64 keyB = ((const _JamContact*)b)->key;
+	return keyA < keyB ? -1 : (keyA > keyB ? 1 : 0);
+}
+
+/// \brief Binary searches the last update's contacts for a key
+static _JamContact* _findContact(JamContactCache* cache, uint64 key) {
+	uint32 low = 0;
+	uint32 high = cache->size;
+	uint32 mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (cache->contacts[mid].key < key)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low < cache->size && cache->contacts[low].key == key ? &cache->contacts[low] : NULL;
+}
+
+/// \brief Checks if an entity is touching another and records it if it is, returns false if it couldn't be recorded
+static bool _findContactWith(JamContactCache* cache, JamEntity* ent, JamEntity* other) {
+	_JamContact* old;
+	_JamContact* contact;
+	uint64 key;
+	bool touching;
+
+	if (other == NULL || other == ent || other->destroy || (ent->collisionMask & other->collisionLayer) == 0)
+		return true;
+
+	// Pairs that were touching and haven't budged since don't need their hitboxes checked again
+	key = _contactKey(ent, other);
+	old = _findContact(cache, key);
+	if (old != NULL && old->entity == ent && old->other == other &&
+		_samePose(ent, &old->entityPose) && _samePose(other, &old->otherPose))
+		touching = true;
+	else
+		touching = jamEntityCheckCollision(ent->x, ent->y, ent, other);
+
+	if (touching) {
+		if (!_reserveContacts(&cache->found, &cache->foundCapacity, cache->foundSize + 1))
+			return false;
+		contact = &cache->found[cache->foundSize++];
+		contact->key = key;
+		contact->entity = ent;
+		contact->other = other;
+		_recordPose(ent, &contact->entityPose);
+		_recordPose(other, &contact->otherPose);
+	}
+
+	return true;
+}
+
+/// \brief What a world's tree is walked with to find an entity's contacts
+typedef struct {
+	JamContactCache* cache;
+	JamEntity* ent;
+	bool failed;
+} _JamContactQuery;
+
+static bool _findContactInTree(void* data, void* userData) {
+	_JamContactQuery* query = userData;
+	query->failed = !_findContactWith(query->cache, query->ent, data);
+	return !query->failed;
+}
+
+///////////////////////////////////////////////////////////////
+JamContactCache* _jamContactCacheCreate() {
+	JamContactCache* cache = (JamContactCache*)calloc(1, sizeof(JamContactCache));
+
+	if (cache == NULL)
+		jSetError(ERROR_ALLOC_FAILED, "Failed to allocate contact cache (_jamContactCacheCreate)");
+
+	return cache;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void jamWorldUpdateContacts(JamWorld* world) {
+	JamContactCache* cache;
+	JamEntityList* list;
+	JamEntity* ent;
+	_JamContact* contact;
+	_JamContact* swapContacts;
+	uint32 swapCapacity, previousSize, i, j, k;
+	int cells[4];
+	int cellCount, c;
+	_JamContactQuery query;
+
+	if (world != NULL && world->contacts != NULL) {
+		cache = world->contacts;
+		cache->foundSize = 0;
+
+		// Find every contact for entities that care about them
+		for (i = 0; i < world->worldEntities->size; i++) {
+			ent = world->worldEntities->entities[i];
+			if (ent == NULL || ent->destroy || !_tracksContacts(ent))
+				continue;
+
+			if (world->broadphase == bp_AABBTree) {
+				query.cache = cache;
+				query.ent = ent;
+				query.failed = false;
+				jamAABBTreeQuery(world->entityTree, jamEntityVisibleX1(ent, ent->x), jamEntityVisibleY1(ent, ent->y),
+								 jamEntityVisibleX2(ent, ent->x), jamEntityVisibleY2(ent, ent->y), _findContactInTree, &query);
+				if (query.failed) {
+					jSetError(ERROR_REALLOC_FAILED, "Failed to grow contacts (jamWorldUpdateContacts)");
+					return;
+				}
+			} else {
+				cellCount = _jamWorldEntityCells(world, ent, ent->x, ent->y, cells);
+				for (c = 0; c < cellCount; c++) {
+					list = world->entityGrid[cells[c]];
+					for (k = 0; k < list->size; k++) {
+						if (!_findContactWith(cache, ent, list->entities[k])) {
+							jSetError(ERROR_REALLOC_FAILED, "Failed to grow contacts (jamWorldUpdateContacts)");
+							return;
+						}
+					}
+				}
+			}
+		}
+
+		// Entities in more than one of the same cells show up more than once
+		if (cache->foundSize > 1)
+			qsort(cache->found, cache->foundSize, sizeof(_JamContact), _compareContacts);
+		for (i = 0, j = 0; i < cache->foundSize; i++)
+			if (j == 0 || cache->found[i].key != cache->found[j - 1].key)
+				cache->found[j++] = cache->found[i];
+		cache->foundSize = j;
+
+		// What was found becomes the contacts, and last update's are kept around just long enough to compare
+		swapContacts = cache->contacts;
+		swapCapacity = cache->capacity;
+		previousSize = cache->size;
+		cache->contacts = cache->found;
+		cache->capacity = cache->foundCapacity;
+		cache->size = cache->foundSize;
+		cache->found = swapContacts;
+		cache->foundCapacity = swapCapacity;
+		cache->foundSize = 0;
+
+		// Both lists are sorted, so walk them together to find what started, continued, and ended
+		for (i = 0, j = 0; i < cache->size || j < previousSize;) {
+			if (j >= previousSize || (i < cache->size && cache->contacts[i].key < cache->found[j].key)) {
+				contact = &cache->contacts[i++];
+				if (contact->entity->behaviour != NULL && contact->entity->behaviour->onCollisionEnter != NULL)
+					(*contact->entity->behaviour->onCollisionEnter)(world, contact->entity, contact->other);
+			} else if (i >= cache->size || cache->found[j].key < cache->contacts[i].key) {
+				contact = &cache->found[j++];
+				if (contact->entity->behaviour != NULL && contact->entity->behaviour->onCollisionExit != NULL)
+					(*contact->entity->behaviour->onCollisionExit)(world, contact->entity, contact->other);
+			} else {
+				contact = &cache->contacts[i++];
+				j++;
+				if (contact->entity->behaviour != NULL && contact->entity->behaviour->onCollisionStay != NULL)
+					(*contact->entity->behaviour->onCollisionStay)(world, contact->entity, contact->other);
+			}
+		}
+	} else {
+		if (world == NULL)
+			jSetError(ERROR_NULL_POINTER, "World does not exist (jamWorldUpdateContacts)");
+	}
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+bool jamWorldInContact(JamWorld* world, JamEntity* entity, JamEntity* other) {
+	_JamContact* contact;
+
+	if (world != NULL && entity != NULL && other != NULL) {
+		if (world->contacts != NULL && entity->id != ID_NOT_ASSIGNED && other->id != ID_NOT_ASSIGNED) {
+			contact = _findContact(world->contacts, _contactKey(entity, other));
+			return contact != NULL && contact->entity == entity && contact->other == other;
+		}
+	} else {
+		if (world == NULL)
+			jSetError(ERROR_NULL_POINTER, "World does not exist (jamWorldInContact)");
+		if (entity == NULL)
+			jSetError(ERROR_NULL_POINTER, "Entity does not exist (jamWorldInContact)");
+		if (other == NULL)
+			jSetError(ERROR_NULL_POINTER, "Other entity does not exist (jamWorldInContact)");
+	}
+
+	return false;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void _jamContactCacheForget(JamWorld* world, JamEntity* entity) {
+	JamContactCache* cache = world->contacts;
+	uint32 i, j;
+
+	if (cache == NULL)
+		return;
+
+	// Let whoever was touching it know first, then drop the contacts
+	for (i = 0; i < cache->size; i++)
+		if (cache->contacts[i].other == entity && cache->contacts[i].entity != entity &&
+			cache->contacts[i].entity->behaviour != NULL && cache->contacts[i].entity->behaviour->onCollisionExit != NULL)
+			(*cache->contacts[i].entity->behaviour->onCollisionExit)(world, cache->contacts[i].entity, entity);
+
+	for (i = 0, j = 0; i < cache->size; i++)
+		if (cache->contacts[i].entity != entity && cache->contacts[i].other != entity)
+			cache->contacts[j++] = cache->contacts[i];
+	cache->size = j;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void _jamContactCacheFree(JamContactCache* cache) {
+	if (cache != NULL) {
+		free(cache->contacts);
+		free(cache->found);
+		free(cache);
+	}
+}
+///////////////////////////////////////////////////////////////
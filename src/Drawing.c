@@ -9,6 +9,7 @@
 #include <Vector.h>
 #include "JamError.h"
 #include <SDL.h>
+#include <math.h>
 
 //////////////////////////////////////////////////////////////
 void jamDrawSetColour(uint8 r, uint8 g, uint8 b, uint8 a) {
@@ -136,25 +137,139 @@ void jamDrawTexture(JamTexture *texture, sint32 x, sint32 y) {
 }
 //////////////////////////////////////////////////////////////
 
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+// Tiles waiting to be sent to SDL as quads that all use one texture
+typedef struct {
+	JamTexture* texture;
+	SDL_Color colour;
+	int quads;
+	SDL_Vertex vertices[TILEMAP_BATCH_SIZE * 4];
+	int indices[TILEMAP_BATCH_SIZE * 6];
+} _JamTileBatch;
+
+// Sends every quad in a batch to SDL in one call
+static void _flushTileBatch(_JamTileBatch* batch) {
+	if (batch->quads > 0)
+		SDL_RenderGeometry(jamRendererGetInternalRenderer(), batch->texture->tex, batch->vertices, batch->quads * 4,
+						   batch->indices, batch->quads * 6);
+	batch->quads = 0;
+}
+
+// Adds a frame with its top-left at (x, y) to a batch, flushing it if its full
+static void _batchTile(_JamTileBatch* batch, JamFrame* frame, int x, int y) {
+	SDL_Vertex* vertex = &batch->vertices[batch->quads * 4];
+	int* index = &batch->indices[batch->quads * 6];
+	int i;
+
+	// Corners go clockwise from the top-left
+	for (i = 0; i < 4; i++) {
+		vertex[i].position.x = (float)(i == 1 || i == 2 ? x + frame->w : x);
+		vertex[i].position.y = (float)(i >= 2 ? y + frame->h : y);
+		vertex[i].tex_coord.x = (float)(i == 1 || i == 2 ? frame->x + frame->w : frame->x) / frame->tex->w;
+		vertex[i].tex_coord.y = (float)(i >= 2 ? frame->y + frame->h : frame->y) / frame->tex->h;
+		vertex[i].color = batch->colour;
+	}
+	index[0] = index[3] = batch->quads * 4;
+	index[1] = batch->quads * 4 + 1;
+	index[2] = index[4] = batch->quads * 4 + 2;
+	index[5] = batch->quads * 4 + 3;
+
+	if (++batch->quads == TILEMAP_BATCH_SIZE)
+		_flushTileBatch(batch);
+}
+#endif
+
+// Draws columns colLo to colHi of rows rowLo to rowHi of a map to the current target with (x, y) as
+// where tile (colLo, rowLo) goes (the camera is not applied), returning false if there were no tiles
+//
+// When SDL can draw geometry, tiles are drawn a texture at a time so every tile from the same
+// tileset goes to SDL in as few calls as possible. Each pass over the tiles draws one texture
+// and looks for the next one up (by address) so nothing needs to be sorted or remembered.
+static bool _drawTiles(JamTileMap* map, uint32 colLo, uint32 colHi, uint32 rowLo, uint32 rowHi, int x, int y) {
+	JamFrame* frame;
+	uint32 i, j;
+	bool any = false;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	_JamTileBatch batch;
+	JamTexture* next;
+
+	batch.texture = NULL;
+	batch.quads = 0;
+	do {
+		next = NULL;
+		for (i = rowLo; i <= rowHi; i++) {
+			for (j = colLo; j <= colHi; j++) {
+				frame = _jamTileMapCellAt(map, i * map->width + j);
+				if (frame != NULL) {
+					any = true;
+					if (frame->tex != NULL && frame->tex == batch.texture)
+						_batchTile(&batch, frame, x + (j - colLo) * map->cellWidth, y + (i - rowLo) * map->cellHeight);
+					else if (frame->tex != NULL && (batch.texture == NULL || (uintptr_t)frame->tex > (uintptr_t)batch.texture) &&
+							 (next == NULL || (uintptr_t)frame->tex < (uintptr_t)next))
+						next = frame->tex;
+				}
+			}
+		}
+
+		// Geometry doesn't pick up the texture's colour and alpha mods on its own
+		_flushTileBatch(&batch);
+		batch.texture = next;
+		if (next != NULL) {
+			SDL_GetTextureColorMod(next->tex, &batch.colour.r, &batch.colour.g, &batch.colour.b);
+			SDL_GetTextureAlphaMod(next->tex, &batch.colour.a);
+		}
+	} while (batch.texture != NULL);
+#else
+	SDL_Rect src, dest;
+
+	for (i = rowLo; i <= rowHi; i++) {
+		for (j = colLo; j <= colHi; j++) {
+			frame = _jamTileMapCellAt(map, i * map->width + j);
+			if (frame != NULL) {
+				any = true;
+				if (frame->tex != NULL) {
+					src.x = frame->x;
+					src.y = frame->y;
+					src.w = dest.w = frame->w;
+					src.h = dest.h = frame->h;
+					dest.x = x + (j - colLo) * map->cellWidth;
+					dest.y = y + (i - rowLo) * map->cellHeight;
+					SDL_RenderCopy(jamRendererGetInternalRenderer(), frame->tex->tex, &src, &dest);
+				}
+			}
+		}
+	}
+#endif
+
+	return any;
+}
+
 //////////////////////////////////////////////////////////////
 void jamDrawTileMap(JamTileMap *map, int x, int y, uint32 xInMapStart, uint32 yInMapStart,
 					uint32 xInMapFinish, uint32 yInMapFinish) {
-	int i, j, originalX;
-	originalX = x;
-	JamFrame* val;
+	int firstX, firstY, lastX, lastY, camX, camY;
+
 	if (jamRendererGetInternalRenderer() != NULL && map != NULL) {
-		if (xInMapFinish == 0) xInMapFinish = map->width - 1;
-		if (yInMapFinish == 0) yInMapFinish = map->height - 1;
-
-		for (i = yInMapStart; i <= yInMapFinish; i++) {
-			for (j = xInMapStart; j <= xInMapFinish; j++) {
-				val = jamTileMapGet(map, (uint16) j, (uint16) i);
-				if (val != NULL)
-					jamDrawFrame(val, x, y);
-				x += map->cellWidth;
-			}
-			x = originalX;
-			y += map->cellHeight;
+		firstX = (int)xInMapStart;
+		firstY = (int)yInMapStart;
+		lastX = xInMapFinish == 0 || xInMapFinish >= map->width ? (int)map->width - 1 : (int)xInMapFinish;
+		lastY = yInMapFinish == 0 || yInMapFinish >= map->height ? (int)map->height - 1 : (int)yInMapFinish;
+
+		// Cut the range down to the tiles the camera can see (tile xInMapStart is drawn at x)
+		if (jamRendererTargetIsScreenBuffer()) {
+			camX = (int)floor(jamRendererGetCameraX()) - x;
+			camY = (int)floor(jamRendererGetCameraY()) - y;
+			firstX = (int)fmax(firstX, xInMapStart + floor((double)camX / map->cellWidth));
+			firstY = (int)fmax(firstY, yInMapStart + floor((double)camY / map->cellHeight));
+			lastX = (int)fmin(lastX, xInMapStart + floor((double)(camX + (int)jamRendererGetBufferWidth()) / map->cellWidth));
+			lastY = (int)fmin(lastY, yInMapStart + floor((double)(camY + (int)jamRendererGetBufferHeight()) / map->cellHeight));
+		}
+
+		if (firstX <= lastX && firstY <= lastY) {
+			x += (firstX - (int)xInMapStart) * (int)map->cellWidth;
+			y += (firstY - (int)yInMapStart) * (int)map->cellHeight;
+			jamRendererCalculateForCamera(&x, &y);
+			_drawTiles(map, (uint32)firstX, (uint32)lastX, (uint32)firstY, (uint32)lastY, x, y);
 		}
 	} else {
 		if (jamRendererGetInternalRenderer() == NULL)
@@ -165,6 +280,130 @@ void jamDrawTileMap(JamTileMap *map, int x, int y, uint32 xInMapStart, uint32 yI
 }
 //////////////////////////////////////////////////////////////
 
+// Draws every tile in a chunk with (x, y) as the chunk's top-left, see _drawTiles
+static bool _drawChunkTiles(JamTileMap* map, uint32 chunkX, uint32 chunkY, int x, int y) {
+	uint32 lastX = (chunkX + 1) * TILEMAP_CHUNK_SIZE > map->width ? map->width - 1 : (chunkX + 1) * TILEMAP_CHUNK_SIZE - 1;
+	uint32 lastY = (chunkY + 1) * TILEMAP_CHUNK_SIZE > map->height ? map->height - 1 : (chunkY + 1) * TILEMAP_CHUNK_SIZE - 1;
+	return _drawTiles(map, chunkX * TILEMAP_CHUNK_SIZE, lastX, chunkY * TILEMAP_CHUNK_SIZE, lastY, x, y);
+}
+
+// Redraws a chunk's texture, freeing it instead if the chunk is empty
+static void _refreshChunk(JamTileMap* map, uint32 chunkX, uint32 chunkY) {
+	SDL_Renderer* renderer = jamRendererGetInternalRenderer();
+	SDL_Texture* previousTarget = SDL_GetRenderTarget(renderer);
+	JamTexture** chunk = &map->chunks[chunkY * map->chunksAcross + chunkX];
+	int w = map->cellWidth * ((chunkX + 1) * TILEMAP_CHUNK_SIZE > map->width ? map->width - chunkX * TILEMAP_CHUNK_SIZE : TILEMAP_CHUNK_SIZE);
+	int h = map->cellHeight * ((chunkY + 1) * TILEMAP_CHUNK_SIZE > map->height ? map->height - chunkY * TILEMAP_CHUNK_SIZE : TILEMAP_CHUNK_SIZE);
+	uint8 r, g, b, a;
+
+	if (*chunk == NULL)
+		*chunk = jamTextureCreate(w, h);
+
+	// The target is swapped behind the renderer's back so whatever was being drawn to is left alone
+	if (*chunk != NULL) {
+		SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+		SDL_SetRenderTarget(renderer, (*chunk)->tex);
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+		SDL_RenderClear(renderer);
+		if (!_drawChunkTiles(map, chunkX, chunkY, 0, 0)) {
+			jamTextureFree(*chunk);
+			*chunk = NULL;
+		}
+		SDL_SetRenderTarget(renderer, previousTarget);
+		SDL_SetRenderDrawColor(renderer, r, g, b, a);
+		map->chunksDirty[chunkY * map->chunksAcross + chunkX] = false;
+	}
+}
+
+//////////////////////////////////////////////////////////////
+void jamDrawTileMapCached(JamTileMap *map, int x, int y) {
+	int chunkW, chunkH, firstX, firstY, lastX, lastY, i, j, drawX, drawY;
+
+	if (jamRendererGetInternalRenderer() != NULL && map != NULL) {
+		chunkW = map->cellWidth * TILEMAP_CHUNK_SIZE;
+		chunkH = map->cellHeight * TILEMAP_CHUNK_SIZE;
+		firstX = 0;
+		firstY = 0;
+		lastX = (int)map->chunksAcross - 1;
+		lastY = (int)map->chunksDown - 1;
+
+		// Only the chunks the camera can see are worth drawing
+		if (jamRendererTargetIsScreenBuffer()) {
+			drawX = (int)floor(jamRendererGetCameraX()) - x;
+			drawY = (int)floor(jamRendererGetCameraY()) - y;
+			firstX = drawX < 0 ? 0 : drawX / chunkW;
+			firstY = drawY < 0 ? 0 : drawY / chunkH;
+			drawX += (int)jamRendererGetBufferWidth();
+			drawY += (int)jamRendererGetBufferHeight();
+			lastX = drawX < 0 ? -1 : (drawX / chunkW < lastX ? drawX / chunkW : lastX);
+			lastY = drawY < 0 ? -1 : (drawY / chunkH < lastY ? drawY / chunkH : lastY);
+		}
+
+		for (i = firstY; i <= lastY; i++) {
+			for (j = firstX; j <= lastX; j++) {
+				if (map->chunksDirty[i * map->chunksAcross + j])
+					_refreshChunk(map, (uint32)j, (uint32)i);
+
+				// A chunk still dirty here couldn't get a texture, so its tiles are drawn directly
+				if (map->chunks[i * map->chunksAcross + j] != NULL) {
+					jamDrawTexture(map->chunks[i * map->chunksAcross + j], x + j * chunkW, y + i * chunkH);
+				} else if (map->chunksDirty[i * map->chunksAcross + j]) {
+					drawX = x + j * chunkW;
+					drawY = y + i * chunkH;
+					jamRendererCalculateForCamera(&drawX, &drawY);
+					_drawChunkTiles(map, (uint32)j, (uint32)i, drawX, drawY);
+				}
+			}
+		}
+	} else {
+		if (jamRendererGetInternalRenderer() == NULL)
+			jSetError(ERROR_NULL_POINTER, "JamRenderer does not exist (jamDrawTileMapCached)");
+		if (map == NULL)
+			jSetError(ERROR_NULL_POINTER, "Map does not exist (jamDrawTileMapCached)");
+	}
+}
+//////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////
+void jamDrawPagedTileMap(JamPagedTileMap *map, int x, int y) {
+	int pageW, pageH, firstX, firstY, lastX, lastY, i, j, camX, camY;
+	JamTileMap* page;
+
+	if (jamRendererGetInternalRenderer() != NULL && map != NULL) {
+		pageW = map->cellWidth * map->pageSize;
+		pageH = map->cellHeight * map->pageSize;
+		firstX = 0;
+		firstY = 0;
+		lastX = (int)map->pagesAcross - 1;
+		lastY = (int)map->pagesDown - 1;
+
+		// Pages the camera can't see aren't loaded at all
+		if (jamRendererTargetIsScreenBuffer()) {
+			camX = (int)floor(jamRendererGetCameraX()) - x;
+			camY = (int)floor(jamRendererGetCameraY()) - y;
+			firstX = (int)fmax(firstX, floor((double)camX / pageW));
+			firstY = (int)fmax(firstY, floor((double)camY / pageH));
+			lastX = (int)fmin(lastX, floor((double)(camX + (int)jamRendererGetBufferWidth()) / pageW));
+			lastY = (int)fmin(lastY, floor((double)(camY + (int)jamRendererGetBufferHeight()) / pageH));
+		}
+
+		// Pages keep their chunk textures for as long as they're in memory
+		for (i = firstY; i <= lastY; i++) {
+			for (j = firstX; j <= lastX; j++) {
+				page = jamPagedTileMapGetPage(map, (uint32)j, (uint32)i);
+				if (page != NULL)
+					jamDrawTileMapCached(page, x + j * pageW, y + i * pageH);
+			}
+		}
+	} else {
+		if (jamRendererGetInternalRenderer() == NULL)
+			jSetError(ERROR_NULL_POINTER, "JamRenderer does not exist (jamDrawPagedTileMap)");
+		if (map == NULL)
+			jSetError(ERROR_NULL_POINTER, "Map does not exist (jamDrawPagedTileMap)");
+	}
+}
+//////////////////////////////////////////////////////////////
+
 //////////////////////////////////////////////////////////////
 void jamDrawTextureExt(JamTexture *texture, sint32 x, sint32 y, sint32 originX, sint32 originY,
 					   float scaleX, float scaleY, double rot, Uint8 alpha) {
@@ -28,6 +28,132 @@ static inline double _getEntHitY2(JamEntity* ent, double y) {
 	return y - ent->sprite->originY + ent->hitbox->height + ent->hitboxOffsetY;
 }
 
+// Moves a point in the sprite's texture to where it ends up relative to the entity's x/y after
+// being scaled and rotated the way jamDrawSpriteFrame does it (scale from the top-left, rotate
+// clockwise around the origin)
+static inline void _transformPoint(JamEntity* ent, double c, double s, double sx, double sy, double u, double v, double* outX, double* outY) {
+	double px = u * sx - ent->sprite->originX;
+	double py = v * sy - ent->sprite->originY;
+	*outX = px * c - py * s;
+	*outY = px * s + py * c;
+}
+
+// Updates an entity's cached rotated/scaled hitbox and bounds if anything they depend on
+// has changed, leaving the cache unused if the entity isn't rotated or scaled
+static void _updateEntTransform(JamEntity* ent) {
+	JamEntityTransform* t = &ent->transform;
+	double sx = fabs(ent->scaleX);
+	double sy = fabs(ent->scaleY);
+	double c, s, px, py;
+	double u[4], v[4];
+	unsigned int i, count;
+	JamHitbox* hitbox = ent->hitbox;
+
+	if (ent->sprite == NULL || (fmod(ent->rot, 360) == 0 && sx == 1 && sy == 1)) {
+		t->valid = false;
+		return;
+	}
+	if (t->valid && t->rot == ent->rot && t->scaleX == sx && t->scaleY == sy && t->source == hitbox &&
+		t->sprite == ent->sprite && t->offsetX == ent->hitboxOffsetX && t->offsetY == ent->hitboxOffsetY)
+		return;
+
+	c = cos(ent->rot * (M_PI / 180));
+	s = sin(ent->rot * (M_PI / 180));
+
+	// Visible bounds are the box around the transformed sprite
+	u[0] = 0; v[0] = 0;
+	u[1] = ent->sprite->width; v[1] = 0;
+	u[2] = ent->sprite->width; v[2] = ent->sprite->height;
+	u[3] = 0; v[3] = ent->sprite->height;
+	for (i = 0; i < 4; i++) {
+		_transformPoint(ent, c, s, sx, sy, u[i], v[i], &px, &py);
+		t->x1 = i == 0 || px < t->x1 ? px : t->x1;
+		t->y1 = i == 0 || py < t->y1 ? py : t->y1;
+		t->x2 = i == 0 || px > t->x2 ? px : t->x2;
+		t->y2 = i == 0 || py > t->y2 ? py : t->y2;
+	}
+
+	if (hitbox != NULL && hitbox->type == ht_Circle) {
+		t->hitbox.type = ht_Circle;
+		t->hitbox.radius = hitbox->radius * (sx > sy ? sx : sy);
+		_transformPoint(ent, c, s, sx, sy, ent->hitboxOffsetX, ent->hitboxOffsetY, &t->hitboxX, &t->hitboxY);
+	} else if (hitbox != NULL && hitbox->type != ht_ConvexPolygon && fmod(ent->rot, 360) == 0) {
+		// Only scaled, so it can stay a rectangle (pixel masks can't be scaled so they become their box)
+		t->hitbox.type = ht_Rectangle;
+		t->hitbox.width = hitbox->width * sx;
+		t->hitbox.height = hitbox->height * sy;
+		_transformPoint(ent, c, s, sx, sy, ent->hitboxOffsetX, ent->hitboxOffsetY, &t->hitboxX, &t->hitboxY);
+	} else if (hitbox != NULL) {
+		count = hitbox->type != ht_ConvexPolygon ? 4 : hitbox->polygon->vertices;
+		if (t->polygon == NULL || t->polygon->vertices != count) {
+			jamPolygonFree(t->polygon);
+			t->polygon = jamPolygonCreate(count);
+			if (t->polygon == NULL) {
+				t->valid = false;
+				return;
+			}
+		}
+
+		for (i = 0; i < count; i++) {
+			if (hitbox->type != ht_ConvexPolygon) {
+				px = i == 1 || i == 2 ? hitbox->width : 0;
+				py = i >= 2 ? hitbox->height : 0;
+			} else {
+				px = hitbox->polygon->xVerts[i];
+				py = hitbox->polygon->yVerts[i];
+			}
+			_transformPoint(ent, c, s, sx, sy, ent->hitboxOffsetX + px, ent->hitboxOffsetY + py, &t->polygon->xVerts[i], &t->polygon->yVerts[i]);
+		}
+		jamPolygonRecalculate(t->polygon);
+
+		t->hitbox.type = ht_ConvexPolygon;
+		t->hitbox.polygon = t->polygon;
+		t->hitboxX = 0;
+		t->hitboxY = 0;
+	}
+
+	t->valid = true;
+	t->source = hitbox;
+	t->sprite = ent->sprite;
+	t->rot = ent->rot;
+	t->scaleX = sx;
+	t->scaleY = sy;
+	t->offsetX = ent->hitboxOffsetX;
+	t->offsetY = ent->hitboxOffsetY;
+}
+
+// Checks if an entity's transform cache is in use without touching it, which is as of the last
+// jamEntityUpdateHitbox (the cache is ignored if the hitbox or sprite were swapped since then)
+static inline bool _entTransformed(JamEntity* ent) {
+	return ent->transform.valid && ent->transform.source == ent->hitbox && ent->transform.sprite == ent->sprite;
+}
+
+// Grabs the hitbox an entity at x/y collides with as well as where it is (does not check for null pointers),
+// scratch is a hitbox owned by the caller that is filled in if the entity has nothing to point to
+static JamHitbox* _getEntHitbox(JamEntity* ent, double x, double y, double* hitX, double* hitY, JamHitbox* scratch) {
+	if (ent->hitbox != NULL && _entTransformed(ent)) {
+		*hitX = x + ent->transform.hitboxX;
+		*hitY = y + ent->transform.hitboxY;
+		return &ent->transform.hitbox;
+	}
+
+	*hitX = _getEntHitX(ent, x);
+	*hitY = _getEntHitY(ent, y);
+
+	// Pixel masks without a mask of their own use the one already built for the sprite's current frame,
+	// which goes in the caller's scratch hitbox so checking an entity never writes to it (and threads can share it)
+	if (ent->hitbox != NULL && ent->hitbox->type == ht_PixelMask && ent->hitbox->mask == NULL &&
+		ent->currentFrame < ent->sprite->animationLength) {
+		scratch->type = ht_PixelMask;
+		scratch->width = ent->hitbox->width;
+		scratch->height = ent->hitbox->height;
+		scratch->mask = ent->currentFrame < ent->sprite->pixelMaskCount ? ent->sprite->pixelMasks[ent->currentFrame] : NULL;
+		return scratch;
+	}
+
+	return ent->hitbox;
+}
+
 // Rounds a double down to an int
 static inline int _roundDoubleToInt(double x) {
 	return (int)round(x);
@@ -74,19 +200,29 @@ JamEntity* jamEntityCreate(JamSprite *sprite, JamHitbox *hitbox, double x, doubl
 		ent->vSpeed = 0;
 		ent->friction = 0;
 		ent->type = 0;
+		ent->collisionLayer = COLLISION_LAYER_DEFAULT;
+		ent->collisionMask = COLLISION_MASK_ALL;
 		ent->behaviour = behaviour;
 		ent->data = NULL;
 		ent->id = ID_NOT_ASSIGNED;
+		ent->generation = 0;
 		ent->xPrev = 0;
 		ent->yPrev = 0;
 		ent->proc = false;
 		ent->properties = NULL;
 		ent->draw = false;
 		ent->cells = 0;
+		ent->treeProxy = AABB_TREE_NULL;
 		ent->destroy = false;
 		ent->inCache = false;
 		ent->frameTimer = 0;
 		ent->currentFrame = 0;
+		ent->components = 0;
+		ent->archetype = -1;
+		ent->archetypeRow = 0;
+		ent->spawnNext = NULL;
+		ent->transform.valid = false;
+		ent->transform.polygon = NULL;
 	} else {
 		jSetError(ERROR_ALLOC_FAILED, "Failed to create JamEntity struct");
 	}
@@ -104,6 +240,8 @@ JamEntity* jamEntityCopy(JamEntity *baseEntity, double x, double y) {
 								 baseEntity->hitboxOffsetY, baseEntity->behaviour);
 		if (newEnt != NULL) {
 			newEnt->type = baseEntity->type;
+			newEnt->collisionLayer = baseEntity->collisionLayer;
+			newEnt->collisionMask = baseEntity->collisionMask;
 			newEnt->rot = baseEntity->rot;
 			newEnt->alpha = baseEntity->alpha;
 			newEnt->updateOnDraw = baseEntity->updateOnDraw;
@@ -114,6 +252,7 @@ JamEntity* jamEntityCopy(JamEntity *baseEntity, double x, double y) {
 			newEnt->vSpeed = baseEntity->vSpeed;
 			newEnt->friction = baseEntity->friction;
 			newEnt->z = baseEntity->z;
+			newEnt->components = baseEntity->components;
 		}
 	} else {
 		jSetError(ERROR_NULL_POINTER, "Base entity doesn't exist");
@@ -123,9 +262,26 @@ JamEntity* jamEntityCopy(JamEntity *baseEntity, double x, double y) {
 }
 //////////////////////////////////////////////////////////
 
+//////////////////////////////////////////////////////////
+JamEntityHandle jamEntityGetHandle(JamEntity *entity) {
+	JamEntityHandle handle = {ID_NOT_ASSIGNED, 0};
+
+	if (entity != NULL) {
+		handle.id = entity->id;
+		handle.generation = entity->generation;
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Entity doesn't exist");
+	}
+
+	return handle;
+}
+//////////////////////////////////////////////////////////
+
 //////////////////////////////////////////////////////////
 void _jamEntityCopyInPlace(JamEntity *baseEntity, JamEntity *inPlaceEntity, double x, double y) {
 	inPlaceEntity->type = baseEntity->type;
+	inPlaceEntity->collisionLayer = baseEntity->collisionLayer;
+	inPlaceEntity->collisionMask = baseEntity->collisionMask;
 	inPlaceEntity->rot = baseEntity->rot;
 	inPlaceEntity->alpha = baseEntity->alpha;
 	inPlaceEntity->updateOnDraw = baseEntity->updateOnDraw;
@@ -136,6 +292,7 @@ void _jamEntityCopyInPlace(JamEntity *baseEntity, JamEntity *inPlaceEntity, doub
 	inPlaceEntity->vSpeed = baseEntity->vSpeed;
 	inPlaceEntity->friction = baseEntity->friction;
 	inPlaceEntity->z = baseEntity->z;
+	inPlaceEntity->components = baseEntity->components;
 }
 //////////////////////////////////////////////////////////
 
@@ -165,18 +322,19 @@ void jamDrawEntity(JamEntity *entity) {
 bool jamEntityCheckCollision(double x, double y, JamEntity *entity1, JamEntity *entity2) {
 	bool coll = false;
 	double x1, y1, x2, y2; // Accounting for origins
+	JamHitbox* hitbox1;
+	JamHitbox* hitbox2;
+	JamHitbox scratch1, scratch2;
 
 	// Check both things exist
 	if (entity1 != NULL && entity2 != NULL && entity1->hitbox != NULL
 		&& entity2->hitbox != NULL) {
-		// Load up the values
-		x1 = _getEntHitX(entity1, x);
-		y1 = _getEntHitY(entity1, y);
-		x2 = _getEntHitX(entity2, entity2->x);
-		y2 = _getEntHitY(entity2, entity2->y);
+		// Load up the values (and the hitboxes themselves, in case they are rotated or scaled)
+		hitbox1 = _getEntHitbox(entity1, x, y, &x1, &y1, &scratch1);
+		hitbox2 = _getEntHitbox(entity2, entity2->x, entity2->y, &x2, &y2, &scratch2);
 		
 		// Now check the collision itself
-		coll = jamHitboxCollision(entity1->hitbox, x1, y1, entity2->hitbox, x2, y2);
+		coll = jamHitboxCollision(hitbox1, x1, y1, hitbox2, x2, y2);
 	} else if (entity1 != NULL && entity2 != NULL && ((entity1->hitbox == NULL
 			   && entity2->hitbox != NULL) || (entity1->hitbox != NULL && entity2->hitbox == NULL))) {
 		if (entity1->hitbox == NULL)
@@ -218,23 +376,116 @@ bool jamEntityCheckCollision(double x, double y, JamEntity *entity1, JamEntity *
 }
 //////////////////////////////////////////////////////////
 
+//////////////////////////////////////////////////////////
+bool jamEntityCollisionInfo(double x, double y, JamEntity *entity1, JamEntity *entity2, JamCollisionInfo *info) {
+	bool coll = false;
+	double x1, y1, x2, y2;
+	JamHitbox* hitbox1;
+	JamHitbox* hitbox2;
+	JamHitbox scratch1, scratch2;
+
+	if (entity1 != NULL && entity2 != NULL && entity1->hitbox != NULL && entity2->hitbox != NULL) {
+		hitbox1 = _getEntHitbox(entity1, x, y, &x1, &y1, &scratch1);
+		hitbox2 = _getEntHitbox(entity2, entity2->x, entity2->y, &x2, &y2, &scratch2);
+		coll = jamHitboxCollisionInfo(hitbox1, x1, y1, hitbox2, x2, y2, info);
+	} else {
+		if (entity1 == NULL || entity1->hitbox == NULL)
+			jSetError(ERROR_NULL_POINTER, "entity1 or its hitbox does not exist (jamEntityCollisionInfo)");
+		if (entity2 == NULL || entity2->hitbox == NULL)
+			jSetError(ERROR_NULL_POINTER, "entity2 or its hitbox does not exist (jamEntityCollisionInfo)");
+	}
+
+	return coll;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+void _jamEntityHitboxBounds(JamEntity *entity, double x, double y, double *x1, double *y1, double *x2, double *y2) {
+	JamHitbox* hitbox;
+	JamHitbox scratch;
+	JamPolygon* polygon;
+	JamPolygon scratchPolygon;
+	double hitX, hitY;
+
+	// Anything the narrowphase can't place gets an infinite box so it is never skipped
+	*x1 = -INFINITY;
+	*y1 = -INFINITY;
+	*x2 = INFINITY;
+	*y2 = INFINITY;
+
+	if (entity->hitbox != NULL && entity->sprite != NULL) {
+		hitbox = _getEntHitbox(entity, x, y, &hitX, &hitY, &scratch);
+		if (hitbox->type == ht_Rectangle || hitbox->type == ht_PixelMask) {
+			*x1 = hitX;
+			*y1 = hitY;
+			*x2 = hitX + hitbox->width;
+			*y2 = hitY + hitbox->height;
+		} else if (hitbox->type == ht_Circle) {
+			*x1 = hitX - hitbox->radius;
+			*y1 = hitY - hitbox->radius;
+			*x2 = hitX + hitbox->radius;
+			*y2 = hitY + hitbox->radius;
+		} else if (hitbox->polygon != NULL && hitbox->polygon->vertices >= 3) {
+			// Polygons that were never cached get their bounds worked out just for this
+			polygon = _jamPolygonPrepare(hitbox->polygon, &scratchPolygon, 0);
+			if (polygon != NULL) {
+				*x1 = hitX + polygon->boundsX1;
+				*y1 = hitY + polygon->boundsY1;
+				*x2 = hitX + polygon->boundsX2;
+				*y2 = hitY + polygon->boundsY2;
+			}
+		}
+	}
+}
+//////////////////////////////////////////////////////////
+
+// Finds the box an entity takes up against tile maps if it were at rx/ry, the entity must have a hitbox
+static void _getEntTileBox(JamEntity* entity, double rx, double ry, double* x, double* y, double* w, double* h) {
+	JamEntityTransform* t = &entity->transform;
+	*x = _getEntHitX(entity, rx);
+	*y = _getEntHitY(entity, ry);
+	*w = entity->hitbox->width;
+	*h = entity->hitbox->height;
+
+	// Rotated/scaled entities check the box around their hitbox instead
+	if (_entTransformed(entity)) {
+		if (t->hitbox.type == ht_Rectangle) {
+			*x = rx + t->hitboxX;
+			*y = ry + t->hitboxY;
+			*w = t->hitbox.width;
+			*h = t->hitbox.height;
+		} else if (t->hitbox.type == ht_Circle) {
+			// Circles sit on their centre
+			*x = rx + t->hitboxX - t->hitbox.radius;
+			*y = ry + t->hitboxY - t->hitbox.radius;
+			*w = t->hitbox.radius * 2;
+			*h = t->hitbox.radius * 2;
+		} else if (t->hitbox.type == ht_ConvexPolygon) {
+			*x = rx + t->polygon->boundsX1;
+			*y = ry + t->polygon->boundsY1;
+			*w = t->polygon->boundsX2 - t->polygon->boundsX1;
+			*h = t->polygon->boundsY2 - t->polygon->boundsY1;
+		}
+	}
+}
+
 //////////////////////////////////////////////////////////
 bool jamEntityTileMapCollision(JamEntity *entity, JamTileMap *tileMap, double rx, double ry) {
 	bool coll = false;
 	double x, y; // Accounting for origins
+	double w, h;
 
 	// Check both things exist
 	if (entity != NULL && entity->hitbox != NULL && tileMap != NULL) {
-		x = _getEntHitX(entity, rx);
-		y = _getEntHitY(entity, ry);
+		_getEntTileBox(entity, rx, ry, &x, &y, &w, &h);
 
 		// Now check the collision itself
 		coll = jamTileMapCollision(
 				tileMap,
 				_roundDoubleToInt(x),
 				_roundDoubleToInt(y),
-				(int)entity->hitbox->width,
-				(int)entity->hitbox->height
+				(int)w,
+				(int)h
 		);
 	} else {
 		if (entity == NULL) {
@@ -256,6 +507,56 @@ bool jamEntityTileMapCollision(JamEntity *entity, JamTileMap *tileMap, double rx
 }
 //////////////////////////////////////////////////////////
 
+//////////////////////////////////////////////////////////
+bool jamEntityTileMapCollisionRect(JamEntity *entity, JamTileMap *tileMap, double rx, double ry, JamTileRect *rect) {
+	double x, y, w, h;
+	bool coll = false;
+
+	if (entity != NULL && entity->hitbox != NULL && tileMap != NULL && rect != NULL) {
+		_getEntTileBox(entity, rx, ry, &x, &y, &w, &h);
+		coll = jamTileMapCollisionRect(tileMap, _roundDoubleToInt(x), _roundDoubleToInt(y), (int)w, (int)h, rect);
+	} else {
+		if (entity == NULL)
+			jSetError(ERROR_NULL_POINTER, "Entity does not exist (jamEntityTileMapCollisionRect)");
+		else if (entity->hitbox == NULL)
+			jSetError(ERROR_INCORRECT_FORMAT, "Entity does not have a hitbox (jamEntityTileMapCollisionRect)");
+		if (tileMap == NULL)
+			jSetError(ERROR_NULL_POINTER, "Tile map does not exist (jamEntityTileMapCollisionRect)");
+		if (rect == NULL)
+			jSetError(ERROR_NULL_POINTER, "Rect does not exist (jamEntityTileMapCollisionRect)");
+	}
+
+	return coll;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+bool jamEntityTileMapSweep(JamEntity *entity, JamTileMap *tileMap, double dx, double dy, JamTileSweep *result) {
+	double x, y, w, h;
+	bool hit = false;
+
+	if (entity != NULL && entity->hitbox != NULL && tileMap != NULL && result != NULL) {
+		_getEntTileBox(entity, entity->x, entity->y, &x, &y, &w, &h);
+		hit = jamTileMapSweep(tileMap, x, y, w, h, dx, dy, result);
+
+		// Give the position back in terms of the entity instead of its hitbox
+		result->x += entity->x - x;
+		result->y += entity->y - y;
+	} else {
+		if (entity == NULL)
+			jSetError(ERROR_NULL_POINTER, "Entity does not exist (jamEntityTileMapSweep)");
+		else if (entity->hitbox == NULL)
+			jSetError(ERROR_INCORRECT_FORMAT, "Entity does not have a hitbox (jamEntityTileMapSweep)");
+		if (tileMap == NULL)
+			jSetError(ERROR_NULL_POINTER, "Tile map does not exist (jamEntityTileMapSweep)");
+		if (result == NULL)
+			jSetError(ERROR_NULL_POINTER, "Result does not exist (jamEntityTileMapSweep)");
+	}
+
+	return hit;
+}
+//////////////////////////////////////////////////////////
+
 //////////////////////////////////////////////////////////
 void jamEntitySnapX(JamEntity *entity, JamTileMap *tilemap, int direction) {
 	int gridX, gridY;
@@ -366,10 +667,30 @@ void jamEntitySetSprite(JamEntity* ent, JamSprite* spr) {
 }
 //////////////////////////////////////////////////////////
 
+//////////////////////////////////////////////////////////
+void jamEntityUpdateHitbox(JamEntity* entity) {
+	uint32 frame;
+
+	if (entity != NULL) {
+		_updateEntTransform(entity);
+
+		// Sprites that gained frames (or never went through an asset handler) get the rest of their masks now
+		if (entity->hitbox != NULL && entity->hitbox->type == ht_PixelMask && entity->hitbox->mask == NULL &&
+			entity->sprite != NULL && entity->sprite->pixelMaskCount < entity->sprite->animationLength)
+			for (frame = 0; frame < entity->sprite->animationLength; frame++)
+				jamPixelMaskFromSprite(entity->sprite, frame);
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Entity doesn't exist");
+	}
+}
+//////////////////////////////////////////////////////////
+
 //////////////////////////////////////////////////////////
 double jamEntityVisibleX1(JamEntity* entity, double x) {
 	if (entity != NULL) {
-		if (entity->sprite != NULL)
+		if (_entTransformed(entity))
+			return x + entity->transform.x1;
+		else if (entity->sprite != NULL)
 			return x - entity->sprite->originX;
 		else
 			return x;
@@ -384,7 +705,9 @@ double jamEntityVisibleX1(JamEntity* entity, double x) {
 //////////////////////////////////////////////////////////
 double jamEntityVisibleY1(JamEntity* entity, double y) {
 	if (entity != NULL) {
-		if (entity->sprite != NULL)
+		if (_entTransformed(entity))
+			return y + entity->transform.y1;
+		else if (entity->sprite != NULL)
 			return y - entity->sprite->originY;
 		else
 			return y;
@@ -399,7 +722,9 @@ double jamEntityVisibleY1(JamEntity* entity, double y) {
 //////////////////////////////////////////////////////////
 double jamEntityVisibleX2(JamEntity* entity, double x) {
 	if (entity != NULL) {
-		if (entity->sprite != NULL)
+		if (_entTransformed(entity))
+			return x + entity->transform.x2;
+		else if (entity->sprite != NULL)
 			return x - entity->sprite->originX + entity->sprite->width;
 		else
 			return x;
@@ -414,7 +739,9 @@ double jamEntityVisibleX2(JamEntity* entity, double x) {
 //////////////////////////////////////////////////////////
 double jamEntityVisibleY2(JamEntity* entity, double y) {
 	if (entity != NULL) {
-		if (entity->sprite != NULL)
+		if (_entTransformed(entity))
+			return y + entity->transform.y2;
+		else if (entity->sprite != NULL)
 			return y - entity->sprite->originY + entity->sprite->height;
 		else
 			return y;
@@ -436,6 +763,7 @@ void jamEntityFree(JamEntity *entity, bool destroyHitbox, bool destroySprite, bo
 		if (destroySprite)
 			jamSpriteFree(entity->sprite, destroyFrames, false);
 		jamTMXDataFree(entity->properties);
+		jamPolygonFree(entity->transform.polygon);
 		free(entity);
 	}
 }
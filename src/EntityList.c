@@ -96,7 +96,8 @@ JamEntity* jamEntityListCollision(int x, int y, JamEntity* entity, JamEntityList
 	JamEntity* output = NULL;
 	if (list != NULL && entity != NULL) {
 		for (i = 0; i < list->size && output == NULL; i++)
-			if (list->entities[i] != NULL && jamEntityCheckCollision(x, y, entity, list->entities[i]))
+			if (list->entities[i] != NULL && (entity->collisionMask & list->entities[i]->collisionLayer) != 0 &&
+				jamEntityCheckCollision(x, y, entity, list->entities[i]))
 				output = list->entities[i];
 	} else {
 		if (list == NULL)
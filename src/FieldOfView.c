@@ -0,0 +1,214 @@
+#include "FieldOfView.h"
+#include "JamError.h"
+#include <stdlib.h>
+#include <string.h>
+
+// How many rows the scan stack starts with room for
+#define FOV_STARTING_ROWS 64
+
+// floor(a / b) and ceil(a / b) for b > 0
+static inline sint64 _floorDiv(sint64 a, sint64 b) {
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static inline sint64 _ceilDiv(sint64 a, sint64 b) {
+	return -_floorDiv(-a, b);
+}
+
+// Turns a depth/column in one of the 4 quadrants (up, right, down, left) into a cell
+static inline void _quadrantCell(int quadrant, int originX, int originY, int depth, int col, int* x, int* y) {
+	switch (quadrant) {
+		case 0: *x = originX + col; *y = originY - depth; break;
+		case 1: *x = originX + depth; *y = originY + col; break;
+		case 2: *x = originX + col; *y = originY + depth; break;
+		default: *x = originX - depth; *y = originY + col; break;
+	}
+}
+
+// Marks a cell as visible and grows the visible area to fit it
+static inline void _reveal(JamFieldOfView* fov, int x, int y) {
+	fov->visible[y * fov->words + x / 64] |= (uint64)1 << (x % 64);
+	if (x < fov->left) fov->left = x;
+	if (x > fov->right) fov->right = x;
+	if (y < fov->top) fov->top = y;
+	if (y > fov->bottom) fov->bottom = y;
+}
+
+// Puts a row on the scan stack, growing it if needed
+static bool _pushRow(JamFieldOfView* fov, int depth, int startNum, int startDen, int endNum, int endDen) {
+	JamFieldOfViewRow* newRows;
+	JamFieldOfViewRow* row;
+
+	if (fov->rowCount == fov->rowCapacity) {
+		newRows = (JamFieldOfViewRow*)realloc(fov->rows, sizeof(JamFieldOfViewRow) * fov->rowCapacity * 2);
+		if (newRows == NULL) {
+			jSetError(ERROR_REALLOC_FAILED, "Failed to grow scan stack (jamFieldOfViewUpdate)");
+			return false;
+		}
+		fov->rows = newRows;
+		fov->rowCapacity *= 2;
+	}
+
+	row = &fov->rows[fov->rowCount++];
+	row->depth = depth;
+	row->startNum = startNum;
+	row->startDen = startDen;
+	row->endNum = endNum;
+	row->endDen = endDen;
+	return true;
+}
+
+// Shadowcasts one quadrant, returning false if the scan stack couldn't grow
+static bool _scanQuadrant(JamFieldOfView* fov, int quadrant) {
+	JamFieldOfViewRow row;
+	sint64 minCol, maxCol, col;
+	int x, y, prev;
+	bool wall, inMap;
+	sint64 radiusSq = (sint64)fov->radius * fov->radius;
+
+	fov->rowCount = 0;
+	if (!_pushRow(fov, 1, -1, 1, 1, 1))
+		return false;
+
+	while (fov->rowCount > 0) {
+		row = fov->rows[--fov->rowCount];
+		if (fov->radius != 0 && row.depth > (int)fov->radius)
+			continue;
+
+		// Columns whose centres are between the slopes, rounding ties towards the middle
+		minCol = _floorDiv(2 * (sint64)row.depth * row.startNum + row.startDen, 2 * (sint64)row.startDen);
+		maxCol = _ceilDiv(2 * (sint64)row.depth * row.endNum - row.endDen, 2 * (sint64)row.endDen);
+
+		// -1 is nothing yet, 0 is open, and 1 is solid (cells outside the map count as solid)
+		prev = -1;
+		for (col = minCol; col <= maxCol; col++) {
+			_quadrantCell(quadrant, fov->viewerX, fov->viewerY, row.depth, (int)col, &x, &y);
+			inMap = x >= 0 && y >= 0 && x < (int)fov->width && y < (int)fov->height;
+			wall = !inMap || (fov->map->solid[y * fov->map->solidWords + x / 64] >> (x % 64)) & 1;
+
+			// Open cells are only visible if their centre is in the scanned area, which is what makes this symmetric
+			if (inMap && (fov->radius == 0 || (sint64)row.depth * row.depth + col * col <= radiusSq) &&
+				(wall || (col * row.startDen >= (sint64)row.depth * row.startNum && col * row.endDen <= (sint64)row.depth * row.endNum)))
+				_reveal(fov, x, y);
+
+			if (prev == 1 && !wall) {
+				row.startNum = (int)(2 * col - 1);
+				row.startDen = 2 * row.depth;
+			}
+			if (prev == 0 && wall) {
+				if (!_pushRow(fov, row.depth + 1, row.startNum, row.startDen, (int)(2 * col - 1), 2 * row.depth))
+					return false;
+			}
+			prev = wall ? 1 : 0;
+		}
+
+		if (prev == 0 && !_pushRow(fov, row.depth + 1, row.startNum, row.startDen, row.endNum, row.endDen))
+			return false;
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////
+JamFieldOfView* jamFieldOfViewCreate(JamTileMap *map) {
+	JamFieldOfView* fov = NULL;
+
+	if (map != NULL) {
+		fov = (JamFieldOfView*)calloc(1, sizeof(JamFieldOfView));
+		if (fov != NULL) {
+			fov->map = map;
+			fov->width = map->width;
+			fov->height = map->height;
+			fov->words = (map->width + 63) / 64;
+			fov->right = -1;
+			fov->bottom = -1;
+			fov->rowCapacity = FOV_STARTING_ROWS;
+
+			// An extra word so empty maps still allocate
+			fov->visible = (uint64*)calloc(fov->words * fov->height + 1, sizeof(uint64));
+			fov->rows = (JamFieldOfViewRow*)malloc(sizeof(JamFieldOfViewRow) * fov->rowCapacity);
+
+			if (fov->visible == NULL || fov->rows == NULL) {
+				free(fov->visible);
+				free(fov->rows);
+				free(fov);
+				fov = NULL;
+				jSetError(ERROR_ALLOC_FAILED, "Failed to allocate visibility (jamFieldOfViewCreate)");
+			}
+		} else {
+			jSetError(ERROR_ALLOC_FAILED, "Failed to allocate field of view (jamFieldOfViewCreate)");
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Map does not exist (jamFieldOfViewCreate)");
+	}
+
+	return fov;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+bool jamFieldOfViewUpdate(JamFieldOfView *fov, int x, int y, uint32 radius) {
+	int row, quadrant;
+
+	if (fov != NULL) {
+		if (fov->valid && fov->viewerX == x && fov->viewerY == y && fov->radius == radius &&
+			fov->revision == fov->map->revision)
+			return false;
+
+		// Only the words the last field of view touched need clearing
+		if (fov->right >= fov->left)
+			for (row = fov->top; row <= fov->bottom; row++)
+				memset(&fov->visible[row * fov->words + fov->left / 64], 0,
+					   sizeof(uint64) * (fov->right / 64 - fov->left / 64 + 1));
+
+		fov->viewerX = x;
+		fov->viewerY = y;
+		fov->radius = radius;
+		fov->revision = fov->map->revision;
+		fov->valid = true;
+		fov->left = (int)fov->width;
+		fov->top = (int)fov->height;
+		fov->right = -1;
+		fov->bottom = -1;
+
+		if (x >= 0 && y >= 0 && x < (int)fov->width && y < (int)fov->height) {
+			_reveal(fov, x, y);
+			for (quadrant = 0; quadrant < 4; quadrant++) {
+				if (!_scanQuadrant(fov, quadrant)) {
+					fov->valid = false;
+					break;
+				}
+			}
+		}
+
+		return true;
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Field of view does not exist (jamFieldOfViewUpdate)");
+	}
+
+	return false;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+bool jamFieldOfViewVisible(JamFieldOfView *fov, int x, int y) {
+	if (fov != NULL) {
+		return x >= fov->left && x <= fov->right && y >= fov->top && y <= fov->bottom &&
+			   (fov->visible[y * fov->words + x / 64] >> (x % 64)) & 1;
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Field of view does not exist (jamFieldOfViewVisible)");
+	}
+
+	return false;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+void jamFieldOfViewFree(JamFieldOfView *fov) {
+	if (fov != NULL) {
+		free(fov->visible);
+		free(fov->rows);
+		free(fov);
+	}
+}
+//////////////////////////////////////////////////////////
@@ -159,11 +159,13 @@ JamStringList* jamStringExplode(const char *string, char delim, bool ignoreQuote
 				currentBuffer = (char*)malloc(i - lastLocation - 1);
 
 			if (currentBuffer != NULL) {
-				if (!cameFromQuotes)
+				if (!cameFromQuotes) {
 					memcpy((void*)currentBuffer, (const void*)(string + lastLocation), i - lastLocation);
-				else
+					currentBuffer[i - lastLocation] = 0;
+				} else {
 					memcpy((void*)currentBuffer, (const void*)(string + lastLocation + 1), i - lastLocation - 2);
-				currentBuffer[lastLocation - i] = 0;
+					currentBuffer[i - lastLocation - 2] = 0;
+				}
 				jamStringListAppend(list, currentBuffer, true);
 				cameFromQuotes = false;
 			} else {
@@ -0,0 +1,517 @@
+#include "FlowField.h"
+#include "JamError.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+
+// Cost of a diagonal step
+#define FLOW_DIAGONAL 1.41421356f
+
+// Direction of a cell with no next step (the goal and cells that can't get to it)
+#define FLOW_NONE 8
+
+// heapPos of a cell that isn't in the heap
+#define HEAP_NONE UINT32_MAX
+
+// The 8 directions starting with up going clockwise, odd ones are diagonal
+static const int gDirX[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+static const int gDirY[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+
+// Weather or not a cell is in the map and not solid in the solid bits the pass is working with
+static inline bool _open(JamFlowField* field, int x, int y) {
+	return x >= 0 && y >= 0 && x < (int)field->width && y < (int)field->height &&
+		   (field->solid[y * field->solidWords + x / 64] & ((uint64)1 << (x % 64))) == 0;
+}
+
+// Weather or not a step in direction dir from (x, y) is allowed (assuming (x, y) is open)
+static inline bool _canStep(JamFlowField* field, int x, int y, int dir) {
+	if (!_open(field, x + gDirX[dir], y + gDirY[dir]))
+		return false;
+	return dir % 2 == 0 || (_open(field, x + gDirX[dir], y) && _open(field, x, y + gDirY[dir]));
+}
+
+static void _heapUp(JamFlowField* field, uint32 pos) {
+	uint32 cell = field->heap[pos];
+	uint32 parent;
+
+	while (pos > 0) {
+		parent = (pos - 1) / 2;
+		if (field->distance[field->heap[parent]] <= field->distance[cell])
+			break;
+		field->heap[pos] = field->heap[parent];
+		field->heapPos[field->heap[pos]] = pos;
+		pos = parent;
+	}
+	field->heap[pos] = cell;
+	field->heapPos[cell] = pos;
+}
+
+static uint32 _heapPop(JamFlowField* field) {
+	uint32 top = field->heap[0];
+	uint32 cell = field->heap[--field->heapSize];
+	uint32 pos = 0;
+	uint32 child;
+
+	while ((child = pos * 2 + 1) < field->heapSize) {
+		if (child + 1 < field->heapSize && field->distance[field->heap[child + 1]] < field->distance[field->heap[child]])
+			child++;
+		if (field->distance[cell] <= field->distance[field->heap[child]])
+			break;
+		field->heap[pos] = field->heap[child];
+		field->heapPos[field->heap[pos]] = pos;
+		pos = child;
+	}
+	if (field->heapSize > 0) {
+		field->heap[pos] = cell;
+		field->heapPos[cell] = pos;
+	}
+	field->heapPos[top] = HEAP_NONE;
+
+	return top;
+}
+
+// Puts a cell in the heap, or moves it up if its distance went down and it's already there
+static void _heapPush(JamFlowField* field, uint32 cell) {
+	if (field->heapPos[cell] == HEAP_NONE) {
+		field->heap[field->heapSize] = cell;
+		_heapUp(field, field->heapSize++);
+	} else {
+		_heapUp(field, field->heapPos[cell]);
+	}
+}
+
+// Passes distances on from every cell in the heap until nothing else gets closer
+static void _propagate(JamFlowField* field) {
+	uint32 cell, next;
+	int x, y, dir;
+	float dist;
+
+	while (field->heapSize > 0) {
+		cell = _heapPop(field);
+		x = cell % field->width;
+		y = cell / field->width;
+
+		for (dir = 0; dir < 8; dir++) {
+			if (_canStep(field, x, y, dir)) {
+				next = (y + gDirY[dir]) * field->width + x + gDirX[dir];
+				dist = field->distance[cell] + (dir % 2 == 0 ? 1 : FLOW_DIAGONAL);
+				if (dist < field->distance[next]) {
+					field->distance[next] = dist;
+					field->directions[next] = (uint8)((dir + 4) % 8);
+					_heapPush(field, next);
+				}
+			}
+		}
+	}
+}
+
+// Forgets a cell's way to the goal, adding it to the changed list if it had one
+static inline void _invalidate(JamFlowField* field, uint32 cell, uint32* count) {
+	if (field->distance[cell] != FLT_MAX) {
+		field->distance[cell] = FLT_MAX;
+		field->directions[cell] = FLOW_NONE;
+		field->changed[(*count)++] = cell;
+	}
+}
+
+// Puts every reachable cell in the 3x3 area around (x, y) in the heap
+static void _seedAround(JamFlowField* field, int x, int y) {
+	int i, j;
+
+	for (i = y - 1; i <= y + 1; i++)
+		for (j = x - 1; j <= x + 1; j++)
+			if (j >= 0 && i >= 0 && j < (int)field->width && i < (int)field->height &&
+				field->distance[i * field->width + j] != FLT_MAX)
+				_heapPush(field, i * field->width + j);
+}
+
+// Fixes distances and directions after the cells that differ between old and solid changed
+static void _integrateChanges(JamFlowField* field, const uint64* old) {
+	uint32 count = 0;
+	uint32 words = field->solidWords * field->height;
+	uint32 w, i, cell, neighbour;
+	uint64 bits;
+	int x, y, nx, ny, dir, step;
+
+	// Tiles that became solid cut off themselves, every cell whose way to the goal
+	// went through them, and any cell whose diagonal step went past their corner
+	for (w = 0; w < words; w++) {
+		bits = ~old[w] & field->solid[w];
+		while (bits != 0) {
+			x = (int)((w % field->solidWords) * 64 + __builtin_ctzll(bits));
+			y = (int)(w / field->solidWords);
+			bits &= bits - 1;
+			if (x >= (int)field->width)
+				continue;
+
+			_invalidate(field, y * field->width + x, &count);
+			for (dir = 0; dir < 8; dir++) {
+				nx = x + gDirX[dir];
+				ny = y + gDirY[dir];
+				if (nx >= 0 && ny >= 0 && nx < (int)field->width && ny < (int)field->height) {
+					neighbour = ny * field->width + nx;
+					step = field->directions[neighbour];
+					if (step != FLOW_NONE && step % 2 == 1 &&
+						((nx + gDirX[step] == x && ny == y) || (nx == x && ny + gDirY[step] == y)))
+						_invalidate(field, neighbour, &count);
+				}
+			}
+		}
+	}
+
+	// Cells whose next step is a cell that was cut off are cut off too
+	for (i = 0; i < count; i++) {
+		cell = field->changed[i];
+		x = cell % field->width;
+		y = cell / field->width;
+		for (dir = 0; dir < 8; dir++) {
+			nx = x + gDirX[dir];
+			ny = y + gDirY[dir];
+			if (nx >= 0 && ny >= 0 && nx < (int)field->width && ny < (int)field->height) {
+				neighbour = ny * field->width + nx;
+				if (field->directions[neighbour] == (dir + 4) % 8)
+					_invalidate(field, neighbour, &count);
+			}
+		}
+	}
+
+	// Cut off cells get their distance back from whatever reachable cells border them
+	for (i = 0; i < count; i++)
+		_seedAround(field, field->changed[i] % field->width, field->changed[i] / field->width);
+
+	// Tiles that opened up can be stepped into (and past diagonally) by the cells around them
+	for (w = 0; w < words; w++) {
+		bits = old[w] & ~field->solid[w];
+		while (bits != 0) {
+			x = (int)((w % field->solidWords) * 64 + __builtin_ctzll(bits));
+			y = (int)(w / field->solidWords);
+			bits &= bits - 1;
+			if (x < (int)field->width)
+				_seedAround(field, x, y);
+		}
+	}
+
+	// The goal may have just opened back up
+	if (field->passGoal < field->width * field->height &&
+		_open(field, field->passGoal % field->width, field->passGoal / field->width) &&
+		field->distance[field->passGoal] == FLT_MAX) {
+		field->distance[field->passGoal] = 0;
+		_heapPush(field, field->passGoal);
+	}
+
+	_propagate(field);
+}
+
+// Works out distance and directions for the solid bits in incoming, only redoing everything if it has to
+static void _integrate(JamFlowField* field, uint32 goal, bool rebuild) {
+	uint64* old = field->solid;
+	uint32 cells = field->width * field->height;
+	uint32 i;
+
+	field->solid = field->incoming;
+	field->incoming = old;
+
+	if (rebuild || !field->built || goal != field->passGoal) {
+		for (i = 0; i < cells; i++) {
+			field->distance[i] = FLT_MAX;
+			field->directions[i] = FLOW_NONE;
+		}
+		field->passGoal = goal;
+		if (goal < cells && _open(field, goal % field->width, goal / field->width)) {
+			field->distance[goal] = 0;
+			_heapPush(field, goal);
+			_propagate(field);
+		}
+	} else {
+		_integrateChanges(field, old);
+	}
+
+	field->built = true;
+}
+
+static void* _flowWorker(void* data) {
+	JamFlowField* field = data;
+	uint64* swap;
+	uint32 goal;
+	bool rebuild;
+	uint32 cells = field->width * field->height;
+
+	pthread_mutex_lock(&field->lock);
+	while (!field->quit) {
+		if (!field->pending) {
+			pthread_cond_wait(&field->signal, &field->lock);
+			continue;
+		}
+
+		// Take what jamFlowFieldUpdate handed over so it can hand over more while this pass runs
+		swap = field->pendingSolid;
+		field->pendingSolid = field->incoming;
+		field->incoming = swap;
+		goal = field->pendingGoal;
+		rebuild = field->pendingRebuild;
+		field->pending = false;
+		field->pendingRebuild = false;
+		pthread_mutex_unlock(&field->lock);
+
+		_integrate(field, goal, rebuild);
+
+		// The back buffer is only free once the last pass has been swapped in
+		pthread_mutex_lock(&field->lock);
+		while (field->ready && !field->quit)
+			pthread_cond_wait(&field->signal, &field->lock);
+		if (field->quit)
+			break;
+		pthread_mutex_unlock(&field->lock);
+
+		memcpy(field->backDistance, field->distance, sizeof(float) * cells);
+		memcpy(field->backDirections, field->directions, cells);
+
+		pthread_mutex_lock(&field->lock);
+		field->ready = true;
+	}
+	pthread_mutex_unlock(&field->lock);
+
+	return NULL;
+}
+
+static void _freeFlowField(JamFlowField* field) {
+	if (field->threaded) {
+		free(field->frontDistance);
+		free(field->frontDirections);
+	}
+	free(field->backDistance);
+	free(field->backDirections);
+	free(field->solid);
+	free(field->incoming);
+	free(field->pendingSolid);
+	free(field->distance);
+	free(field->directions);
+	free(field->heap);
+	free(field->heapPos);
+	free(field->changed);
+	free(field);
+}
+
+//////////////////////////////////////////////////////////
+JamFlowField* jamFlowFieldCreate(JamTileMap *map, bool threaded) {
+	JamFlowField* field = NULL;
+	uint32 cells, solidSize, i;
+	bool allocated;
+
+	if (map != NULL) {
+		field = (JamFlowField*)calloc(1, sizeof(JamFlowField));
+		if (field != NULL) {
+			field->map = map;
+			field->width = map->width;
+			field->height = map->height;
+			field->solidWords = map->solidWords;
+			field->revision = map->revision;
+			field->goalChanged = true;
+			field->threaded = threaded;
+			cells = map->width * map->height;
+			solidSize = sizeof(uint64) * (field->solidWords * field->height + 1);
+
+			// Everything gets an extra spot so empty maps still allocate
+			field->solid = (uint64*)malloc(solidSize);
+			field->incoming = (uint64*)malloc(solidSize);
+			field->distance = (float*)malloc(sizeof(float) * (cells + 1));
+			field->directions = (uint8*)malloc(cells + 1);
+			field->heap = (uint32*)malloc(sizeof(uint32) * (cells + 1));
+			field->heapPos = (uint32*)malloc(sizeof(uint32) * (cells + 1));
+			field->changed = (uint32*)malloc(sizeof(uint32) * (cells + 1));
+			allocated = field->solid != NULL && field->incoming != NULL && field->distance != NULL &&
+						field->directions != NULL && field->heap != NULL && field->heapPos != NULL && field->changed != NULL;
+
+			if (threaded) {
+				field->pendingSolid = (uint64*)malloc(solidSize);
+				field->frontDistance = (float*)malloc(sizeof(float) * (cells + 1));
+				field->frontDirections = (uint8*)malloc(cells + 1);
+				field->backDistance = (float*)malloc(sizeof(float) * (cells + 1));
+				field->backDirections = (uint8*)malloc(cells + 1);
+				allocated = allocated && field->pendingSolid != NULL && field->frontDistance != NULL &&
+							field->frontDirections != NULL && field->backDistance != NULL && field->backDirections != NULL;
+			} else {
+				field->frontDistance = field->distance;
+				field->frontDirections = field->directions;
+			}
+
+			if (allocated) {
+				memset(field->solid, 0, solidSize);
+				for (i = 0; i < cells; i++) {
+					field->distance[i] = FLT_MAX;
+					field->directions[i] = FLOW_NONE;
+					field->heapPos[i] = HEAP_NONE;
+				}
+				if (threaded) {
+					memcpy(field->frontDistance, field->distance, sizeof(float) * cells);
+					memcpy(field->frontDirections, field->directions, cells);
+					pthread_mutex_init(&field->lock, NULL);
+					pthread_cond_init(&field->signal, NULL);
+					field->workerStarted = pthread_create(&field->worker, NULL, _flowWorker, field) == 0;
+					if (!field->workerStarted) {
+						pthread_mutex_destroy(&field->lock);
+						pthread_cond_destroy(&field->signal);
+						_freeFlowField(field);
+						field = NULL;
+						jSetError(ERROR_ALLOC_FAILED, "Failed to start flow field thread (jamFlowFieldCreate)");
+					}
+				}
+			} else {
+				_freeFlowField(field);
+				field = NULL;
+				jSetError(ERROR_ALLOC_FAILED, "Failed to allocate flow field's buffers (jamFlowFieldCreate)");
+			}
+		} else {
+			jSetError(ERROR_ALLOC_FAILED, "Failed to allocate flow field (jamFlowFieldCreate)");
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Map does not exist (jamFlowFieldCreate)");
+	}
+
+	return field;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+void jamFlowFieldSetGoal(JamFlowField *field, uint32 x, uint32 y) {
+	if (field != NULL && x < field->width && y < field->height) {
+		if (x != field->goalX || y != field->goalY) {
+			field->goalX = x;
+			field->goalY = y;
+			field->goalChanged = true;
+		}
+	} else {
+		if (field == NULL)
+			jSetError(ERROR_NULL_POINTER, "Flow field does not exist (jamFlowFieldSetGoal)");
+		else
+			jSetError(ERROR_OUT_OF_BOUNDS, "Goal (%u, %u) is outside the map (jamFlowFieldSetGoal)", x, y);
+	}
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+void jamFlowFieldUpdate(JamFlowField *field) {
+	float* swapDistance;
+	uint8* swapDirections;
+	bool changed;
+
+	if (field != NULL) {
+		changed = field->goalChanged || field->revision != field->map->revision;
+
+		if (field->threaded) {
+			pthread_mutex_lock(&field->lock);
+			if (field->ready) {
+				swapDistance = field->frontDistance;
+				swapDirections = field->frontDirections;
+				field->frontDistance = field->backDistance;
+				field->frontDirections = field->backDirections;
+				field->backDistance = swapDistance;
+				field->backDirections = swapDirections;
+				field->ready = false;
+				pthread_cond_signal(&field->signal);
+			}
+			if (changed) {
+				memcpy(field->pendingSolid, field->map->solid, sizeof(uint64) * field->solidWords * field->height);
+				field->pendingGoal = field->goalY * field->width + field->goalX;
+				field->pendingRebuild = field->pendingRebuild || field->goalChanged;
+				field->pending = true;
+				pthread_cond_signal(&field->signal);
+			}
+			pthread_mutex_unlock(&field->lock);
+		} else if (changed) {
+			memcpy(field->incoming, field->map->solid, sizeof(uint64) * field->solidWords * field->height);
+			_integrate(field, field->goalY * field->width + field->goalX, field->goalChanged);
+		}
+
+		field->goalChanged = false;
+		field->revision = field->map->revision;
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Flow field does not exist (jamFlowFieldUpdate)");
+	}
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+bool jamFlowFieldGet(JamFlowField *field, int x, int y, int *dx, int *dy) {
+	uint32 cell;
+	uint8 dir;
+
+	if (field != NULL) {
+		if (x >= 0 && y >= 0 && x < (int)field->width && y < (int)field->height) {
+			cell = y * field->width + x;
+			if (field->frontDistance[cell] != FLT_MAX) {
+				dir = field->frontDirections[cell];
+				if (dx != NULL) *dx = dir == FLOW_NONE ? 0 : gDirX[dir];
+				if (dy != NULL) *dy = dir == FLOW_NONE ? 0 : gDirY[dir];
+				return true;
+			}
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Flow field does not exist (jamFlowFieldGet)");
+	}
+
+	return false;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+double jamFlowFieldDistance(JamFlowField *field, int x, int y) {
+	float dist;
+
+	if (field != NULL) {
+		if (x >= 0 && y >= 0 && x < (int)field->width && y < (int)field->height) {
+			dist = field->frontDistance[y * field->width + x];
+			return dist == FLT_MAX ? -1 : dist;
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Flow field does not exist (jamFlowFieldDistance)");
+	}
+
+	return -1;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+bool jamFlowFieldSample(JamFlowField *field, double x, double y, double *dx, double *dy) {
+	int stepX, stepY;
+	double length;
+	bool found = false;
+
+	if (field != NULL) {
+		found = jamFlowFieldGet(
+				field,
+				(int)floor(x / field->map->cellWidth) - field->map->xInWorld,
+				(int)floor(y / field->map->cellHeight) - field->map->yInWorld,
+				&stepX,
+				&stepY);
+		if (found) {
+			length = stepX != 0 && stepY != 0 ? FLOW_DIAGONAL : 1;
+			if (dx != NULL) *dx = stepX / length;
+			if (dy != NULL) *dy = stepY / length;
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Flow field does not exist (jamFlowFieldSample)");
+	}
+
+	return found;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+void jamFlowFieldFree(JamFlowField *field) {
+	if (field != NULL) {
+		if (field->workerStarted) {
+			pthread_mutex_lock(&field->lock);
+			field->quit = true;
+			pthread_cond_signal(&field->signal);
+			pthread_mutex_unlock(&field->lock);
+			pthread_join(field->worker, NULL);
+			pthread_mutex_destroy(&field->lock);
+			pthread_cond_destroy(&field->signal);
+		}
+		_freeFlowField(field);
+	}
+}
+//////////////////////////////////////////////////////////
@@ -11,6 +11,12 @@
 #include "Hitbox.h"
 #include "Vector.h"
 #include "JamError.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
 
 /* The following functions mostly break the "don't use a return
  * statement anywhere but the last line rule" for the sake of
@@ -20,79 +26,60 @@
  * a collision is or isn't taking place.
  */
 
-// This is made automatically when you try to check a poly-to-rectangle
-// collision. It stores a 4-sides polygon whos values are updated instead
-// of making a new polygon every time a poly-rect collision is checked.
-// It is freed whenever a hitbox is freed.
-// tl;dr micro-optimizations
-static JamPolygon* gRectPolyCache;
-
 //////////////////////////////////////////////////
 static bool _circRectColl(double cX, double cY, double cR, double rX, double rY, double rW, double rH) {
-	// Is the circle's centre in the rectangle
-	if (pointInRectangle(cX, cY, rX, rY, rW, rH))
-		return true;
-
-	// Check if the circle is touching a vertex of the rectangle
-	if (pointDistance(cX, cY, rX, rY) < cR) return true;
-	if (pointDistance(cX, cY, rX + rW, rY) < cR) return true;
-	if (pointDistance(cX, cY, rX, rY + rH) < cR) return true;
-	if (pointDistance(cX, cY, rX + rW, rY + rH) < cR) return true;
-
-	// Now if the circle is along the edge
-	if (pointInRectangle(cX, cY, rX - cR + 1, rY + 1, rH + cR * 2 - 2, rH - 2)) return true;
-	if (pointInRectangle(cX, cY, rX + 1, rY - cR + 1, rH - 2, rH + cR * 2 - 2)) return true;
-	return false;
+	// Whatever point of the rectangle is closest to the circle's centre has to be inside the circle
+	double closestX = clamp(cX, rX, rX + rW);
+	double closestY = clamp(cY, rY, rY + rH);
+	return (cX - closestX) * (cX - closestX) + (cY - closestY) * (cY - closestY) < cR * cR;
 }
 //////////////////////////////////////////////////
 
 //////////////////////////////////////////////////
-static inline double _cast1DShadow(double x, double y, double m) {
-	return y - m * x;
+// Smallest projection of a polygon's vertices onto the axis (nx, ny)
+static inline double _satMinProjection(JamPolygon* p, double nx, double ny) {
+	unsigned int j = 0;
+	double currentVal;
+	double min;
+#ifdef __SSE2__
+	__m128d axisX = _mm_set1_pd(nx);
+	__m128d axisY = _mm_set1_pd(ny);
+	__m128d mins = _mm_set1_pd(INFINITY);
+
+	// Two vertices at a time, then whatever is left over
+	for (; j + 1 < p->vertices; j += 2)
+		mins = _mm_min_pd(mins, _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(p->xVerts + j), axisX), _mm_mul_pd(_mm_loadu_pd(p->yVerts + j), axisY)));
+	min = fmin(_mm_cvtsd_f64(mins), _mm_cvtsd_f64(_mm_unpackhi_pd(mins, mins)));
+#else
+	min = INFINITY;
+#endif
+
+	for (; j < p->vertices; j++) {
+		currentVal = p->xVerts[j] * nx + p->yVerts[j] * ny;
+		if (currentVal < min)
+			min = currentVal;
+	}
+
+	return min;
 }
 //////////////////////////////////////////////////
 
 //////////////////////////////////////////////////
+// Checks p1's edge normals for an axis that separates the two polygons
+//
+// The normals point out of p1, so the furthest p1 reaches along any one of
+// them is the edge's own vertex. That means only p2 has to be projected, and
+// if even its closest vertex is past p1's edge there is a gap.
 static bool _satCheckGap(JamPolygon* p1, JamPolygon* p2, double x1, double y1, double x2, double y2) {
-	unsigned int i, j;
-	double slope;
-	double min1, min2, max1, max2;
-	register bool done1;
-	register bool done2;
-	register double currentVal;
-
-	// For each edge on polygon 1
-	for (i = 0; i < p1->vertices; i++) {
-		done1 = false;
-		done2 = false;
-
-		if (i == 0)
-			slope = (p1->yVerts[0] - p1->yVerts[p1->vertices - 1]) / (p1->xVerts[0] - p1->xVerts[p1->vertices - 1]);
-		else
-			slope = (p1->yVerts[i] - p1->yVerts[i - 1]) / (p1->xVerts[i] - p1->xVerts[i - 1]);
-
-		// Record min/max of polygon 1
-		for (j = 0; j < p1->vertices; j++) {
-			currentVal = _cast1DShadow(p1->xVerts[j] + x1, p1->yVerts[j] + y1, slope);
-			if (currentVal > max1 || !done1)
-				max1 = currentVal;
-			if (currentVal < min1 || !done1)
-				min1 = currentVal;
-			done1 = true;
-		}
-
-		// Record min/max of polygon 2
-		for (j = 0; j < p2->vertices; j++) {
-			currentVal = _cast1DShadow(p2->xVerts[j] + x2, p2->yVerts[j] + y2, slope);
-			if (currentVal > max2 || !done2)
-				max2 = currentVal;
-			if (currentVal < min2 || !done2)
-				min2 = currentVal;
-			done2 = true;
-		}
+	unsigned int i;
+	double offsetX = x2 - x1;
+	double offsetY = y2 - y1;
+	register double nx, ny;
 
-		// Check if the two ranges don't intersect
-		if (max1 < min2 || max2 < min1)
+	for (i = 0; i < p1->vertices; i++) {
+		nx = p1->xNormals[i];
+		ny = p1->yNormals[i];
+		if (_satMinProjection(p2, nx, ny) + offsetX * nx + offsetY * ny > p1->xVerts[i] * nx + p1->yVerts[i] * ny)
 			return true;
 	}
 
@@ -102,9 +89,22 @@ static bool _satCheckGap(JamPolygon* p1, JamPolygon* p2, double x1, double y1, d
 
 //////////////////////////////////////////////////
 bool jamHitboxPolygonCollision(JamPolygon *poly1, JamPolygon *poly2, double x1, double y1, double x2, double y2) {
+	JamPolygon scratch1, scratch2;
+
 	// Make sure the polygons exist and they are at least a triangle
 	if (poly1 != NULL && poly2 != NULL) {
 		if (poly1->vertices >= 3 && poly2->vertices >= 3) {
+			// Polygons that were never cached get their values worked out just for this check
+			poly1 = _jamPolygonPrepare(poly1, &scratch1, 0);
+			poly2 = _jamPolygonPrepare(poly2, &scratch2, 1);
+			if (poly1 == NULL || poly2 == NULL)
+				return false;
+
+			// Most polygons that get checked aren't anywhere near each other, so check the boxes first
+			if (poly1->boundsX2 + x1 < poly2->boundsX1 + x2 || poly2->boundsX2 + x2 < poly1->boundsX1 + x1 ||
+				poly1->boundsY2 + y1 < poly2->boundsY1 + y2 || poly2->boundsY2 + y2 < poly1->boundsY1 + y1)
+				return false;
+
 			if (_satCheckGap(poly1, poly2, x1, y1, x2, y2) || _satCheckGap(poly2, poly1, x2, y2, x1, y1))
 				return false;
 			else
@@ -114,7 +114,6 @@ bool jamHitboxPolygonCollision(JamPolygon *poly1, JamPolygon *poly2, double x1,
 				jSetError(ERROR_INCORRECT_FORMAT, "JamPolygon 1 needs at least 3 vertices.");
 			if (poly2->vertices < 3)
 				jSetError(ERROR_INCORRECT_FORMAT, "JamPolygon 2 needs at least 3 vertices.");
-
 		}
 	} else {
 		if (poly1 == NULL)
@@ -128,31 +127,317 @@ bool jamHitboxPolygonCollision(JamPolygon *poly1, JamPolygon *poly2, double x1,
 //////////////////////////////////////////////////
 
 //////////////////////////////////////////////////
-static bool _satToCircleCollisions(JamPolygon* p1, double r, double x1, double y1, double x2, double y2) {
-	return false;
+// Gets a hitbox GJK can use, which is the hitbox itself unless it's a polygon that was
+// never cached, then it's scratchBox with the polygon's values worked out into scratchPoly
+// (without touching the hitbox). Returns NULL if the polygon can't be used.
+static JamHitbox* _readyHitbox(JamHitbox* hitbox, JamHitbox* scratchBox, JamPolygon* scratchPoly, int slot) {
+	JamPolygon* poly;
+
+	if (hitbox->type != ht_ConvexPolygon) {
+		return hitbox;
+	} else if (hitbox->polygon == NULL) {
+		jSetError(ERROR_NULL_POINTER, "JamPolygon does not exist.");
+		return NULL;
+	} else if (hitbox->polygon->vertices < 3) {
+		jSetError(ERROR_INCORRECT_FORMAT, "JamPolygon needs at least 3 vertices.");
+		return NULL;
+	}
+
+	poly = _jamPolygonPrepare(hitbox->polygon, scratchPoly, slot);
+	if (poly == NULL || poly == hitbox->polygon)
+		return poly == NULL ? NULL : hitbox;
+
+	*scratchBox = *hitbox;
+	scratchBox->polygon = poly;
+	return scratchBox;
 }
 //////////////////////////////////////////////////
 
+/* GJK and EPA work on the Minkowski difference of the two hitboxes, which
+ * is every point in hitbox 1 minus every point in hitbox 2. The hitboxes
+ * overlap if and only if that shape contains the origin, and how far the
+ * origin is from its nearest edge is how far they overlap. The shape is
+ * never built, all we need is the point furthest along any direction,
+ * which is just the difference of the two hitboxes' furthest points.
+ */
+
+// Two hitboxes placed in the world
+typedef struct {
+	JamHitbox* hitbox1;
+	double x1;
+	double y1;
+	JamHitbox* hitbox2;
+	double x2;
+	double y2;
+} _JamHitboxPair;
+
 //////////////////////////////////////////////////
-static bool _satToRectangleCollisions(JamPolygon* p, double w, double h, double x1, double y1, double x2, double y2) {
-	if (gRectPolyCache == NULL) {
-		gRectPolyCache = jamPolygonCreate(4);
-		if (gRectPolyCache == NULL) {
-			jSetError(ERROR_ALLOC_FAILED, "Failed to create polygon cache.");
+// Furthest point of a hitbox at (x, y) in the direction (dx, dy)
+static void _hitboxSupport(JamHitbox* hitbox, double x, double y, double dx, double dy, double* outX, double* outY) {
+	unsigned int i, best = 0;
+	double length, currentVal, bestVal = -INFINITY;
+
+	if (hitbox->type == ht_Circle) {
+		length = sqrt(dx * dx + dy * dy);
+		*outX = x + (length > 0 ? (dx / length) * hitbox->radius : hitbox->radius);
+		*outY = y + (length > 0 ? (dy / length) * hitbox->radius : 0);
+	} else if (hitbox->type == ht_Rectangle || hitbox->type == ht_PixelMask) {
+		*outX = x + (dx > 0 ? hitbox->width : 0);
+		*outY = y + (dy > 0 ? hitbox->height : 0);
+	} else {
+		for (i = 0; i < hitbox->polygon->vertices; i++) {
+			currentVal = hitbox->polygon->xVerts[i] * dx + hitbox->polygon->yVerts[i] * dy;
+			if (currentVal > bestVal) {
+				bestVal = currentVal;
+				best = i;
+			}
+		}
+		*outX = x + hitbox->polygon->xVerts[best];
+		*outY = y + hitbox->polygon->yVerts[best];
+	}
+}
+//////////////////////////////////////////////////
+
+//////////////////////////////////////////////////
+// Roughly the middle of a hitbox at (x, y), used to pick GJK's first direction
+static void _hitboxCentre(JamHitbox* hitbox, double x, double y, double* outX, double* outY) {
+	if (hitbox->type == ht_Circle) {
+		*outX = x;
+		*outY = y;
+	} else if (hitbox->type == ht_Rectangle || hitbox->type == ht_PixelMask) {
+		*outX = x + hitbox->width / 2;
+		*outY = y + hitbox->height / 2;
+	} else {
+		*outX = x + hitbox->polygon->centreX;
+		*outY = y + hitbox->polygon->centreY;
+	}
+}
+//////////////////////////////////////////////////
+
+//////////////////////////////////////////////////
+// Furthest point of the Minkowski difference in the direction (dx, dy)
+static inline void _minkowskiSupport(_JamHitboxPair* pair, double dx, double dy, double* outX, double* outY) {
+	double ax, ay, bx, by;
+	_hitboxSupport(pair->hitbox1, pair->x1, pair->y1, dx, dy, &ax, &ay);
+	_hitboxSupport(pair->hitbox2, pair->x2, pair->y2, -dx, -dy, &bx, &by);
+	*outX = ax - bx;
+	*outY = ay - by;
+}
+//////////////////////////////////////////////////
+
+//////////////////////////////////////////////////
+// Looks for a triangle in the Minkowski difference that holds the origin,
+// which is left in simplexX/Y (newest point last) if the hitboxes collide
+static bool _gjk(_JamHitboxPair* pair, double* simplexX, double* simplexY) {
+	int i, count;
+	double dx, dy, cx1, cy1, cx2, cy2;
+	double abX, abY, acX, acY, perpX, perpY;
+
+	_hitboxCentre(pair->hitbox1, pair->x1, pair->y1, &cx1, &cy1);
+	_hitboxCentre(pair->hitbox2, pair->x2, pair->y2, &cx2, &cy2);
+	dx = cx1 - cx2;
+	dy = cy1 - cy2;
+	if (dx == 0 && dy == 0)
+		dx = 1;
+
+	_minkowskiSupport(pair, dx, dy, &simplexX[0], &simplexY[0]);
+	count = 1;
+	dx = -simplexX[0];
+	dy = -simplexY[0];
+
+	for (i = 0; i < GJK_MAX_ITERATIONS; i++) {
+		// The origin sits right on the simplex, so they're only touching
+		if (dx == 0 && dy == 0)
+			return false;
+
+		// If the furthest we can get towards the origin doesn't pass it, the origin is outside
+		_minkowskiSupport(pair, dx, dy, &simplexX[count], &simplexY[count]);
+		if (simplexX[count] * dx + simplexY[count] * dy <= 0)
 			return false;
+		count++;
+
+		if (count == 2) {
+			// Line - look perpendicular to it towards the origin
+			abX = simplexX[0] - simplexX[1];
+			abY = simplexY[0] - simplexY[1];
+			dx = -abY;
+			dy = abX;
+			if (dx * -simplexX[1] + dy * -simplexY[1] < 0) {
+				dx = -dx;
+				dy = -dy;
+			}
+		} else {
+			// Triangle - either the origin is past one of the two new edges or its inside
+			abX = simplexX[1] - simplexX[2];
+			abY = simplexY[1] - simplexY[2];
+			acX = simplexX[0] - simplexX[2];
+			acY = simplexY[0] - simplexY[2];
+
+			perpX = -abY;
+			perpY = abX;
+			if (perpX * acX + perpY * acY > 0) {
+				perpX = -perpX;
+				perpY = -perpY;
+			}
+			if (perpX * -simplexX[2] + perpY * -simplexY[2] > 0) {
+				simplexX[0] = simplexX[1];
+				simplexY[0] = simplexY[1];
+				simplexX[1] = simplexX[2];
+				simplexY[1] = simplexY[2];
+				count = 2;
+				dx = perpX;
+				dy = perpY;
+				continue;
+			}
+
+			perpX = -acY;
+			perpY = acX;
+			if (perpX * abX + perpY * abY > 0) {
+				perpX = -perpX;
+				perpY = -perpY;
+			}
+			if (perpX * -simplexX[2] + perpY * -simplexY[2] > 0) {
+				simplexX[1] = simplexX[2];
+				simplexY[1] = simplexY[2];
+				count = 2;
+				dx = perpX;
+				dy = perpY;
+				continue;
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
+//////////////////////////////////////////////////
+
+//////////////////////////////////////////////////
+// Grows GJK's triangle out towards the edge of the Minkowski difference
+// closest to the origin, which gives the penetration normal and depth
+static void _epa(_JamHitboxPair* pair, double* simplexX, double* simplexY, JamCollisionInfo* info) {
+	double polyX[EPA_MAX_ITERATIONS + 3];
+	double polyY[EPA_MAX_ITERATIONS + 3];
+	int count = 3;
+	int i, j, iteration, closest = 0;
+	double winding, nx, ny, length, dist, supportX, supportY;
+	double closestDist = 0, closestX = 0, closestY = 0;
+
+	for (i = 0; i < 3; i++) {
+		polyX[i] = simplexX[i];
+		polyY[i] = simplexY[i];
+	}
+	winding = (polyX[1] - polyX[0]) * (polyY[2] - polyY[0]) - (polyY[1] - polyY[0]) * (polyX[2] - polyX[0]);
+
+	for (iteration = 0; iteration <= EPA_MAX_ITERATIONS; iteration++) {
+		// Find the edge closest to the origin
+		closestDist = INFINITY;
+		for (i = 0; i < count; i++) {
+			j = (i + 1) % count;
+			nx = winding >= 0 ? polyY[j] - polyY[i] : polyY[i] - polyY[j];
+			ny = winding >= 0 ? polyX[i] - polyX[j] : polyX[j] - polyX[i];
+			length = sqrt(nx * nx + ny * ny);
+			if (length > 0) {
+				nx /= length;
+				ny /= length;
+				dist = nx * polyX[i] + ny * polyY[i];
+				if (dist < closestDist) {
+					closestDist = dist;
+					closestX = nx;
+					closestY = ny;
+					closest = i;
+				}
+			}
 		}
+
+		// If that edge really is the edge of the shape we're done, otherwise push it outwards
+		_minkowskiSupport(pair, closestX, closestY, &supportX, &supportY);
+		if (supportX * closestX + supportY * closestY - closestDist < EPA_TOLERANCE || iteration == EPA_MAX_ITERATIONS)
+			break;
+		for (i = count; i > closest + 1; i--) {
+			polyX[i] = polyX[i - 1];
+			polyY[i] = polyY[i - 1];
+		}
+		polyX[closest + 1] = supportX;
+		polyY[closest + 1] = supportY;
+		count++;
+	}
+
+	// The edge's normal points out of hitbox 2 into hitbox 1's way, hitbox 1 goes the other way. The
+	// depth is how far the real shape reaches along it, which for curved hitboxes is a hair past the
+	// polygon EPA built but guarantees moving that far actually separates them.
+	info->normalX = -closestX;
+	info->normalY = -closestY;
+	dist = supportX * closestX + supportY * closestY;
+	info->depth = dist > 0 ? dist : 0;
+}
+//////////////////////////////////////////////////
+
+//////////////////////////////////////////////////
+static bool _gjkCollision(JamHitbox* hitbox1, double x1, double y1, JamHitbox* hitbox2, double x2, double y2) {
+	_JamHitboxPair pair = {hitbox1, x1, y1, hitbox2, x2, y2};
+	double simplexX[3];
+	double simplexY[3];
+	return _gjk(&pair, simplexX, simplexY);
+}
+//////////////////////////////////////////////////
+
+//////////////////////////////////////////////////
+// Checks a polygon against a rectangle by treating the rectangle as a polygon
+//
+// The rectangle's polygon lives on the stack and its normals, bounds, and
+// circle are filled in by hand since they are always the same, so nothing
+// is allocated and any number of threads can do this at once.
+static bool _satToRectangleCollisions(JamPolygon* p, double w, double h, double x1, double y1, double x2, double y2) {
+	double xVerts[4] = {0, w, w, 0};
+	double yVerts[4] = {0, 0, h, h};
+	double xNormals[4] = {0, 1, 0, -1};
+	double yNormals[4] = {-1, 0, 1, 0};
+	JamPolygon rect;
+
+	rect.xVerts = xVerts;
+	rect.yVerts = yVerts;
+	rect.vertices = 4;
+	rect.xNormals = xNormals;
+	rect.yNormals = yNormals;
+	rect.boundsX1 = 0;
+	rect.boundsY1 = 0;
+	rect.boundsX2 = w;
+	rect.boundsY2 = h;
+	rect.centreX = w / 2;
+	rect.centreY = h / 2;
+	rect.radius = sqrt(w * w + h * h) / 2;
+	rect.cached = true;
+	return jamHitboxPolygonCollision(&rect, p, x2, y2, x1, y1);
+}
+//////////////////////////////////////////////////
+
+//////////////////////////////////////////////////
+// Checks a pixel mask hitbox against any other, the mask is always checked in whole pixels
+static bool _pixelMaskCollision(JamHitbox* maskBox, double x1, double y1, JamHitbox* other, double x2, double y2) {
+	JamHitbox box;
+	int maskX = (int)round(x1);
+	int maskY = (int)round(y1);
+
+	// Without a mask its just its bounding box
+	if (maskBox->mask == NULL) {
+		box.type = ht_Rectangle;
+		box.width = maskBox->width;
+		box.height = maskBox->height;
+		return jamHitboxCollision(&box, x1, y1, other, x2, y2);
 	}
 
-	// We now know for certain the polygon cache exists
-	gRectPolyCache->xVerts[0] = 0;
-	gRectPolyCache->yVerts[0] = 0;
-	gRectPolyCache->xVerts[1] = w;
-	gRectPolyCache->yVerts[1] = 0;
-	gRectPolyCache->xVerts[2] = w;
-	gRectPolyCache->yVerts[2] = h;
-	gRectPolyCache->xVerts[3] = 0;
-	gRectPolyCache->yVerts[3] = h;
-	return jamHitboxPolygonCollision(gRectPolyCache, p, x2, y2, x1, y1);
+	if (other->type == ht_PixelMask && other->mask != NULL)
+		return jamPixelMaskCollision(maskBox->mask, maskX, maskY, other->mask, (int)round(x2), (int)round(y2));
+	else if (other->type == ht_PixelMask || other->type == ht_Rectangle)
+		return jamPixelMaskRectCollision(maskBox->mask, maskX, maskY, x2, y2, other->width, other->height);
+	else if (other->type == ht_Circle)
+		return jamPixelMaskCircleCollision(maskBox->mask, maskX, maskY, x2, y2, other->radius);
+	else if (other->type == ht_ConvexPolygon)
+		return jamPixelMaskPolygonCollision(maskBox->mask, maskX, maskY, other->polygon, x2, y2);
+
+	return false;
 }
 //////////////////////////////////////////////////
 
@@ -171,6 +456,10 @@ JamHitbox* jamHitboxCreate(JamHitboxType type, double radius, double width, doub
 			hitbox->height = height;
 		} else if (type == ht_ConvexPolygon) {
 			hitbox->polygon = polygon;
+		} else if (type == ht_PixelMask) {
+			hitbox->width = width;
+			hitbox->height = height;
+			hitbox->mask = NULL;
 		}
 	} else {
 		jSetError(ERROR_ALLOC_FAILED, "Failed to allocate hitbox. (jamHitboxCreate)");
@@ -182,11 +471,19 @@ JamHitbox* jamHitboxCreate(JamHitboxType type, double radius, double width, doub
 
 //////////////////////////////////////////////////
 bool jamHitboxCollision(JamHitbox *hitbox1, double x1, double y1, JamHitbox *hitbox2, double x2, double y2) {
+	JamHitbox scratchBox;
+	JamPolygon scratchPoly;
 	bool hit = false;
 
 	// Double check it's there
 	if (hitbox1 != NULL && hitbox2 != NULL) {
-		if (hitbox1->type == ht_Circle && hitbox2->type == ht_Circle) {
+		if (hitbox1->type == ht_PixelMask) {
+			// Mask-to-anything
+			hit = _pixelMaskCollision(hitbox1, x1, y1, hitbox2, x2, y2);
+		} else if (hitbox2->type == ht_PixelMask) {
+			// Anything-to-mask
+			hit = _pixelMaskCollision(hitbox2, x2, y2, hitbox1, x1, y1);
+		} else if (hitbox1->type == ht_Circle && hitbox2->type == ht_Circle) {
 			// Circle-to-circle
 			hit = (pointDistance(x1, y1, x2, y2) < hitbox1->radius + hitbox2->radius);
 		} else if (hitbox1->type == ht_Rectangle && hitbox2->type == ht_Rectangle) {
@@ -206,14 +503,16 @@ bool jamHitboxCollision(JamHitbox *hitbox1, double x1, double y1, JamHitbox *hit
 			hit = _satToRectangleCollisions(hitbox1->polygon, hitbox2->width, hitbox2->height, x1, y1, x2, y2);
 		} else if (hitbox1->type == ht_Rectangle && hitbox2->type == ht_ConvexPolygon) {
 			// Rectangle-to-poly
-			hit = _satToRectangleCollisions(hitbox2->polygon, hitbox1->width, hitbox2->height, x2, y2, x1, y1);
+			hit = _satToRectangleCollisions(hitbox2->polygon, hitbox1->width, hitbox1->height, x2, y2, x1, y1);
 		} else if (hitbox1->type == ht_ConvexPolygon && hitbox2->type == ht_Circle) {
 			// Poly-to-circle
-			hit = _satToCircleCollisions(hitbox1->polygon, hitbox2->radius, x1, y1, x2, y2);
+			hitbox1 = _readyHitbox(hitbox1, &scratchBox, &scratchPoly, 0);
+			hit = hitbox1 != NULL && _gjkCollision(hitbox1, x1, y1, hitbox2, x2, y2);
 		} else if (hitbox1->type == ht_Circle && hitbox2->type == ht_ConvexPolygon) {
 			// Circle-to-poly
-			hit = _satToCircleCollisions(hitbox2->polygon, hitbox2->radius, x2, y2, x1, y1);
-		} // TODO: Implement cirlce-to-poly collisions
+			hitbox2 = _readyHitbox(hitbox2, &scratchBox, &scratchPoly, 0);
+			hit = hitbox2 != NULL && _gjkCollision(hitbox1, x1, y1, hitbox2, x2, y2);
+		}
 	} else {
 		if (hitbox1 == NULL)
 			jSetError(ERROR_NULL_POINTER, "JamHitbox 1 does not exist. (jamHitboxCollision)");
@@ -225,17 +524,108 @@ bool jamHitboxCollision(JamHitbox *hitbox1, double x1, double y1, JamHitbox *hit
 }
 //////////////////////////////////////////////////
 
+//////////////////////////////////////////////////
+bool jamHitboxCollisionInfo(JamHitbox *hitbox1, double x1, double y1, JamHitbox *hitbox2, double x2, double y2, JamCollisionInfo *info) {
+	_JamHitboxPair pair = {NULL, x1, y1, NULL, x2, y2};
+	JamHitbox scratchBox1, scratchBox2;
+	JamPolygon scratchPoly1, scratchPoly2;
+	double simplexX[3];
+	double simplexY[3];
+	bool hit = false;
+
+	if (hitbox1 != NULL && hitbox2 != NULL && info != NULL) {
+		pair.hitbox1 = _readyHitbox(hitbox1, &scratchBox1, &scratchPoly1, 0);
+		pair.hitbox2 = _readyHitbox(hitbox2, &scratchBox2, &scratchPoly2, 1);
+		if (pair.hitbox1 != NULL && pair.hitbox2 != NULL && _gjk(&pair, simplexX, simplexY)) {
+			_epa(&pair, simplexX, simplexY, info);
+			hit = true;
+		}
+	} else {
+		if (hitbox1 == NULL)
+			jSetError(ERROR_NULL_POINTER, "JamHitbox 1 does not exist. (jamHitboxCollisionInfo)");
+		if (hitbox2 == NULL)
+			jSetError(ERROR_NULL_POINTER, "JamHitbox 2 does not exist. (jamHitboxCollisionInfo)");
+		if (info == NULL)
+			jSetError(ERROR_NULL_POINTER, "Collision info does not exist. (jamHitboxCollisionInfo)");
+	}
+
+	return hit;
+}
+//////////////////////////////////////////////////
+
+//////////////////////////////////////////////////
+uint32 jamHitboxBatchAABB(float x1, float y1, float x2, float y2, const float *boxes, uint32 count, uint32 *hits) {
+	const float* lefts;
+	const float* tops;
+	const float* rights;
+	const float* bottoms;
+	uint32 found = 0;
+	uint32 mask;
+	uint32 i = 0;
+
+	if (boxes != NULL && hits != NULL) {
+		lefts = boxes;
+		tops = boxes + count;
+		rights = boxes + count * 2;
+		bottoms = boxes + count * 3;
+		for (i = 0; i < (count + 31) / 32; i++)
+			hits[i] = 0;
+		i = 0;
+
+		// Groups of 8 or 4 never straddle two words of hits since 32 is a multiple of both
+#ifdef __AVX__
+		__m256 qx1 = _mm256_set1_ps(x1);
+		__m256 qy1 = _mm256_set1_ps(y1);
+		__m256 qx2 = _mm256_set1_ps(x2);
+		__m256 qy2 = _mm256_set1_ps(y2);
+		for (; i + 8 <= count; i += 8) {
+			mask = (uint32)_mm256_movemask_ps(_mm256_and_ps(
+					_mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(lefts + i), qx2, _CMP_LT_OQ), _mm256_cmp_ps(_mm256_loadu_ps(rights + i), qx1, _CMP_GT_OQ)),
+					_mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(tops + i), qy2, _CMP_LT_OQ), _mm256_cmp_ps(_mm256_loadu_ps(bottoms + i), qy1, _CMP_GT_OQ))));
+			hits[i / 32] |= mask << (i % 32);
+			found += __builtin_popcount(mask);
+		}
+#endif
+#ifdef __SSE2__
+		__m128 sx1 = _mm_set1_ps(x1);
+		__m128 sy1 = _mm_set1_ps(y1);
+		__m128 sx2 = _mm_set1_ps(x2);
+		__m128 sy2 = _mm_set1_ps(y2);
+		for (; i + 4 <= count; i += 4) {
+			mask = (uint32)_mm_movemask_ps(_mm_and_ps(
+					_mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(lefts + i), sx2), _mm_cmpgt_ps(_mm_loadu_ps(rights + i), sx1)),
+					_mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(tops + i), sy2), _mm_cmpgt_ps(_mm_loadu_ps(bottoms + i), sy1))));
+			hits[i / 32] |= mask << (i % 32);
+			found += __builtin_popcount(mask);
+		}
+#endif
+
+		// Whatever doesn't fit in a vector (or everything without SSE2)
+		for (; i < count; i++) {
+			if (lefts[i] < x2 && rights[i] > x1 && tops[i] < y2 && bottoms[i] > y1) {
+				hits[i / 32] |= (uint32)1 << (i % 32);
+				found++;
+			}
+		}
+	} else {
+		if (boxes == NULL)
+			jSetError(ERROR_NULL_POINTER, "Boxes do not exist. (jamHitboxBatchAABB)");
+		if (hits == NULL)
+			jSetError(ERROR_NULL_POINTER, "Hits do not exist. (jamHitboxBatchAABB)");
+	}
+
+	return found;
+}
+//////////////////////////////////////////////////
+
 //////////////////////////////////////////////////
 void jamHitboxFree(JamHitbox *hitbox) {
 	if (hitbox != NULL) {
 		if (hitbox->type == ht_ConvexPolygon)
 			jamPolygonFree(hitbox->polygon);
+		else if (hitbox->type == ht_PixelMask)
+			jamPixelMaskFree(hitbox->mask);
 		free(hitbox);
 	}
-
-	if (gRectPolyCache != NULL) {
-		jamPolygonFree(gRectPolyCache);
-		gRectPolyCache = NULL;
-	}
 }
 //////////////////////////////////////////////////
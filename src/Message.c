@@ -0,0 +1,271 @@
+#include "Message.h"
+#include "World.h"
+#include "Entity.h"
+#include "JamError.h"
+#include <malloc.h>
+#include <string.h>
+#include <pthread.h>
+
+/// \brief A block of messages in a thread's queue
+typedef struct _JamMessageBlock {
+	struct _JamMessageBlock* next;          ///< Block the owner moved on to once this one filled up (only touch atomically)
+	uint32 count;                           ///< Messages written to this block so far (only touch atomically)
+	JamMessage messages[MESSAGE_BLOCK_SIZE]; ///< The messages themselves
+} _JamMessageBlock;
+
+/// \brief The messages one thread has posted to a world, only that thread writes to it
+typedef struct _JamMessageQueue {
+	pthread_t owner;               ///< Thread that posts into this queue
+	_JamMessageBlock* tail;        ///< Block the owner posts into (only the owner touches this)
+	_JamMessageBlock* head;        ///< Block delivery takes messages from next (only delivery touches this)
+	uint32 read;                   ///< Messages in head that delivery has already taken
+	struct _JamMessageQueue* next; ///< Next queue in the bus
+} _JamMessageQueue;
+
+struct _JamMessageBus {
+	_JamMessageQueue* queues;  ///< Every thread's queue, newest first (only touch atomically)
+	pthread_mutex_t queueLock; ///< Held while a new thread's queue is added
+	uint32 serial;             ///< Tells buses apart for the thread local queue below
+	JamMessage* batch;         ///< Messages being delivered, sorted by receiver
+	uint32 batchCapacity;      ///< Messages allocated in batch
+	JamMessage* gathered;      ///< Messages taken out of the queues before sorting
+	uint32 gatheredCapacity;   ///< Messages allocated in gathered
+	uint32* counts;            ///< Per-receiver counts for sorting
+	uint32 countsCapacity;     ///< Receivers allocated in counts
+};
+
+// Every thread remembers the queue it last posted into, so posting to the same world again is free
+static uint32 gNextSerial;
+static _Thread_local _JamMessageQueue* tQueue;
+static _Thread_local uint32 tQueueSerial;
+
+/// \brief Grows an array of messages to hold at least count messages, returns false if it can't
+static bool _reserveMessages(JamMessage** messages, uint32* capacity, uint32 count) {
+	uint32 newCapacity;
+	JamMessage* newMessages;
+
+	if (count <= *capacity)
+		return true;
+
+	newCapacity = *capacity == 0 ? 64 : *capacity;
+	while (newCapacity < count)
+		newCapacity *= 2;
+	newMessages = (JamMessage*)realloc(*messages, newCapacity * sizeof(JamMessage));
+	if (newMessages == NULL)
+		return false;
+
+	*messages = newMessages;
+	*capacity = newCapacity;
+	return true;
+}
+
+/// \brief Finds the calling thread's queue in a bus, adding one if it doesn't have one yet
+static _JamMessageQueue* _threadQueue(JamMessageBus* bus) {
+	_JamMessageQueue* queue;
+	pthread_t self = pthread_self();
+
+	if (tQueue != NULL && tQueueSerial == bus->serial)
+		return tQueue;
+
+	// Queues are only ever added to the front, so the list can be looked through without the lock
+	for (queue = __atomic_load_n(&bus->queues, __ATOMIC_ACQUIRE); queue != NULL && !pthread_equal(queue->owner, self); queue = queue->next);
+
+	if (queue == NULL) {
+		queue = (_JamMessageQueue*)calloc(1, sizeof(_JamMessageQueue));
+		if (queue != NULL)
+			queue->head = queue->tail = (_JamMessageBlock*)calloc(1, sizeof(_JamMessageBlock));
+		if (queue == NULL || queue->head == NULL) {
+			free(queue);
+			return NULL;
+		}
+
+		queue->owner = self;
+		pthread_mutex_lock(&bus->queueLock);
+		queue->next = bus->queues;
+		__atomic_store_n(&bus->queues, queue, __ATOMIC_RELEASE);
+		pthread_mutex_unlock(&bus->queueLock);
+	}
+
+	tQueue = queue;
+	tQueueSerial = bus->serial;
+	return queue;
+}
+
+///////////////////////////////////////////////////////////////
+JamMessageBus* _jamMessageBusCreate() {
+	JamMessageBus* bus = (JamMessageBus*)calloc(1, sizeof(JamMessageBus));
+
+	if (bus != NULL) {
+		pthread_mutex_init(&bus->queueLock, NULL);
+		bus->serial = __atomic_add_fetch(&gNextSerial, 1, __ATOMIC_RELAXED);
+	} else {
+		jSetError(ERROR_ALLOC_FAILED, "Failed to allocate message bus (_jamMessageBusCreate)");
+	}
+
+	return bus;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+bool jamWorldPostMessage(JamWorld* world, JamEntity* sender, JamEntityHandle receiver, uint32 type, const void* payload, uint32 size) {
+	_JamMessageQueue* queue;
+	_JamMessageBlock* block;
+	_JamMessageBlock* newBlock;
+	JamMessage* message;
+	uint32 count;
+
+	if (world != NULL && world->messageBus != NULL && size <= MESSAGE_PAYLOAD_SIZE && (payload != NULL || size == 0) && receiver.id >= 0) {
+		queue = _threadQueue(world->messageBus);
+		if (queue == NULL) {
+			jSetError(ERROR_ALLOC_FAILED, "Failed to allocate message queue (jamWorldPostMessage)");
+			return false;
+		}
+
+		// Once the owner links a new block it never touches the old one again, so delivery may free it
+		block = queue->tail;
+		count = __atomic_load_n(&block->count, __ATOMIC_RELAXED);
+		if (count == MESSAGE_BLOCK_SIZE) {
+			newBlock = (_JamMessageBlock*)calloc(1, sizeof(_JamMessageBlock));
+			if (newBlock == NULL) {
+				jSetError(ERROR_ALLOC_FAILED, "Failed to allocate message block (jamWorldPostMessage)");
+				return false;
+			}
+			__atomic_store_n(&block->next, newBlock, __ATOMIC_RELEASE);
+			queue->tail = block = newBlock;
+			count = 0;
+		}
+
+		message = &block->messages[count];
+		message->type = type;
+		message->size = size;
+		message->sender.id = sender != NULL ? sender->id : ID_NOT_ASSIGNED;
+		message->sender.generation = sender != NULL ? sender->generation : 0;
+		message->receiver = receiver;
+		if (size > 0)
+			memcpy(message->payload, payload, size);
+		__atomic_store_n(&block->count, count + 1, __ATOMIC_RELEASE);
+		return true;
+	} else {
+		if (world == NULL || world->messageBus == NULL)
+			jSetError(ERROR_NULL_POINTER, "World does not exist (jamWorldPostMessage)");
+		if (payload == NULL && size > 0)
+			jSetError(ERROR_NULL_POINTER, "Payload does not exist (jamWorldPostMessage)");
+		if (size > MESSAGE_PAYLOAD_SIZE)
+			jSetError(ERROR_OUT_OF_BOUNDS, "Payload of %i bytes is larger than MESSAGE_PAYLOAD_SIZE (jamWorldPostMessage)", size);
+		if (receiver.id < 0)
+			jSetError(ERROR_OUT_OF_BOUNDS, "Receiver %i is not a valid entity id (jamWorldPostMessage)", receiver.id);
+	}
+
+	return false;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void jamWorldDeliverMessages(JamWorld* world) {
+	JamMessageBus* bus;
+	_JamMessageQueue* queue;
+	_JamMessageBlock* next;
+	JamMessage* message;
+	JamEntity* ent;
+	uint32 total, receivers, sum, count;
+	uint32 i;
+	bool error = false;
+
+	if (world != NULL && world->messageBus != NULL) {
+		bus = world->messageBus;
+
+		// Take everything out of the queues so anything posted during delivery waits for next time
+		total = 0;
+		for (queue = __atomic_load_n(&bus->queues, __ATOMIC_ACQUIRE); queue != NULL && !error; queue = queue->next) {
+			while (true) {
+				count = __atomic_load_n(&queue->head->count, __ATOMIC_ACQUIRE);
+				if (count > queue->read) {
+					if (!_reserveMessages(&bus->gathered, &bus->gatheredCapacity, total + count - queue->read)) {
+						error = true;
+						break;
+					}
+					memcpy(bus->gathered + total, queue->head->messages + queue->read, (count - queue->read) * sizeof(JamMessage));
+					total += count - queue->read;
+					queue->read = count;
+				}
+
+				// A full block can only be let go of once the owner has moved on to the next one
+				next = count == MESSAGE_BLOCK_SIZE ? __atomic_load_n(&queue->head->next, __ATOMIC_ACQUIRE) : NULL;
+				if (next == NULL)
+					break;
+				free(queue->head);
+				queue->head = next;
+				queue->read = 0;
+			}
+		}
+
+		// Counting sort by receiver, which keeps each receiver's messages in the order they were posted
+		receivers = (uint32)world->worldEntities->size;
+		if (!error && total > 0 && receivers > 0 && _reserveMessages(&bus->batch, &bus->batchCapacity, total)) {
+			if (receivers + 1 > bus->countsCapacity) {
+				free(bus->counts);
+				bus->counts = (uint32*)malloc((receivers + 1) * sizeof(uint32));
+				bus->countsCapacity = bus->counts != NULL ? receivers + 1 : 0;
+			}
+
+			if (bus->counts != NULL) {
+				memset(bus->counts, 0, (receivers + 1) * sizeof(uint32));
+				for (i = 0; i < total; i++)
+					if ((uint32)bus->gathered[i].receiver.id < receivers)
+						bus->counts[bus->gathered[i].receiver.id]++;
+				for (i = 0, sum = 0; i <= receivers; i++) {
+					count = bus->counts[i];
+					bus->counts[i] = sum;
+					sum += count;
+				}
+				for (i = 0; i < total; i++)
+					if ((uint32)bus->gathered[i].receiver.id < receivers)
+						bus->batch[bus->counts[bus->gathered[i].receiver.id]++] = bus->gathered[i];
+
+				// Messages to ids no longer in the world never made it into the batch, and the generation
+				// catches ids that were given to another entity since the message was posted
+				for (i = 0; i < sum; i++) {
+					message = &bus->batch[i];
+					ent = world->worldEntities->entities[message->receiver.id];
+					if (ent != NULL && !ent->destroy && ent->generation == message->receiver.generation &&
+						ent->behaviour != NULL && ent->behaviour->onMessage != NULL)
+						(*ent->behaviour->onMessage)(world, ent, message);
+				}
+			} else {
+				error = true;
+			}
+		} else if (!error && total > 0 && receivers > 0) {
+			error = true;
+		}
+
+		if (error)
+			jSetError(ERROR_REALLOC_FAILED, "Failed to allocate space to deliver messages (jamWorldDeliverMessages)");
+	} else {
+		jSetError(ERROR_NULL_POINTER, "World does not exist (jamWorldDeliverMessages)");
+	}
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void _jamMessageBusFree(JamMessageBus* bus) {
+	_JamMessageQueue* queue;
+	_JamMessageQueue* nextQueue;
+	_JamMessageBlock* block;
+	_JamMessageBlock* nextBlock;
+
+	if (bus != NULL) {
+		for (queue = bus->queues; queue != NULL; queue = nextQueue) {
+			nextQueue = queue->next;
+			for (block = queue->head; block != NULL; block = nextBlock) {
+				nextBlock = block->next;
+				free(block);
+			}
+			free(queue);
+		}
+		free(bus->batch);
+		free(bus->gathered);
+		free(bus->counts);
+		free(bus);
+	}
+}
+///////////////////////////////////////////////////////////////
@@ -0,0 +1,439 @@
+#include "PagedTileMap.h"
+#include "JamError.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// What every paged tile map file starts with
+static const char gPagedTileMapMagic[4] = {'J', 'P', 'T', 'M'};
+
+// Version written to new files, files with any other version aren't loaded
+#define PAGED_TILEMAP_VERSION 1
+
+// Bytes before the first page (the magic then version, width, height, cellWidth, cellHeight, and page size)
+#define PAGED_TILEMAP_HEADER_SIZE (sizeof(gPagedTileMapMagic) + sizeof(uint32) * 6)
+
+// Divides rounding towards negative infinity so pixels left of/above 0 land in negative cells
+static inline int _floorDiv(int a, uint32 b) {
+	int q = a / (int)b;
+	return (a % (int)b != 0 && a < 0) ? q - 1 : q;
+}
+
+// Finds the tile number of a frame, *tile going in is checked first since tiles tend to come in runs
+static bool _tileOf(JamPagedTileMap* map, JamFrame* frame, uint16* tile) {
+	int i, count = map->tileSet->animationLength < UINT16_MAX ? map->tileSet->animationLength : UINT16_MAX;
+
+	if (frame == NULL) {
+		*tile = 0;
+		return true;
+	}
+	if (*tile != 0 && *tile <= count && map->tileSet->frames[*tile - 1] == frame)
+		return true;
+	for (i = 0; i < count; i++) {
+		if (map->tileSet->frames[i] == frame) {
+			*tile = (uint16)(i + 1);
+			return true;
+		}
+	}
+
+	*tile = 0;
+	return false;
+}
+
+// Where a page starts in the file
+static inline long _pageOffset(JamPagedTileMap* map, uint32 index) {
+	return (long)(PAGED_TILEMAP_HEADER_SIZE + (size_t)index * map->pageSize * map->pageSize * sizeof(uint16));
+}
+
+// The pages a rectangle in the world covers, false if it misses the map entirely
+static bool _pageRange(JamPagedTileMap* map, int x, int y, int w, int h, int* pageX1, int* pageY1, int* pageX2, int* pageY2) {
+	w = w < 1 ? 1 : w;
+	h = h < 1 ? 1 : h;
+	*pageX1 = _floorDiv(_floorDiv(x, map->cellWidth) - map->xInWorld, map->pageSize);
+	*pageY1 = _floorDiv(_floorDiv(y, map->cellHeight) - map->yInWorld, map->pageSize);
+	*pageX2 = _floorDiv(_floorDiv(x + w - 1, map->cellWidth) - map->xInWorld, map->pageSize);
+	*pageY2 = _floorDiv(_floorDiv(y + h - 1, map->cellHeight) - map->yInWorld, map->pageSize);
+	*pageX1 = *pageX1 < 0 ? 0 : *pageX1;
+	*pageY1 = *pageY1 < 0 ? 0 : *pageY1;
+	*pageX2 = *pageX2 >= (int)map->pagesAcross ? (int)map->pagesAcross - 1 : *pageX2;
+	*pageY2 = *pageY2 >= (int)map->pagesDown ? (int)map->pagesDown - 1 : *pageY2;
+	return *pageX1 <= *pageX2 && *pageY1 <= *pageY2;
+}
+
+// Writes a page in memory to its spot in the file
+static bool _writePage(JamPagedTileMap* map, uint32 index) {
+	JamTileMap* page = map->pages[index];
+	uint32 row, col, count = map->pageSize * map->pageSize;
+	uint16 tile;
+	bool worked;
+
+	// Pages keep the same numbers as the file, except frames that aren't in the tile set
+	// (only possible by changing the page directly) which are saved as empty
+	memset(map->pageBuffer, 0, sizeof(uint16) * count);
+	for (row = 0; row < page->height; row++) {
+		for (col = 0; col < page->width; col++) {
+			tile = page->tiles[row * page->width + col];
+			map->pageBuffer[row * map->pageSize + col] = tile <= map->tileSet->animationLength ? tile : 0;
+		}
+	}
+
+	worked = fseek(map->file, _pageOffset(map, index), SEEK_SET) == 0 &&
+			 fwrite(map->pageBuffer, sizeof(uint16), count, map->file) == count;
+	// A failed write would otherwise make the next page read look like it failed too
+	if (worked) {
+		map->pagesModified[index] = false;
+	} else {
+		clearerr(map->file);
+		jSetError(ERROR_FILE_FAILED, "Failed to write page %i to file (jamPagedTileMapFlush)", index);
+	}
+
+	return worked;
+}
+
+// Reads a page from the file into a new tile map, anything past the end of the file is empty
+static JamTileMap* _readPage(JamPagedTileMap* map, uint32 index) {
+	uint32 pageX = index % map->pagesAcross;
+	uint32 pageY = index / map->pagesAcross;
+	uint32 w = (pageX + 1) * map->pageSize > map->width ? map->width - pageX * map->pageSize : map->pageSize;
+	uint32 h = (pageY + 1) * map->pageSize > map->height ? map->height - pageY * map->pageSize : map->pageSize;
+	uint32 row, col, count = map->pageSize * map->pageSize;
+	JamTileMap* page = jamTileMapCreateIndexed(w, h, map->cellWidth, map->cellHeight, map->tileSet);
+	uint16 tile;
+
+	if (page != NULL) {
+		memset(map->pageBuffer, 0, sizeof(uint16) * count);
+		if (fseek(map->file, _pageOffset(map, index), SEEK_SET) == 0)
+			fread(map->pageBuffer, sizeof(uint16), count, map->file);
+
+		if (!ferror(map->file)) {
+			// The palette is the tile set so tiles are copied straight in, and the solid bits are built once after
+			for (row = 0; row < h; row++) {
+				for (col = 0; col < w; col++) {
+					tile = map->pageBuffer[row * map->pageSize + col];
+					page->tiles[row * w + col] = tile < page->paletteSize ? tile : 0;
+				}
+			}
+			jamTileMapRefresh(page);
+		} else {
+			jamTileMapFree(page);
+			page = NULL;
+			jSetError(ERROR_FILE_FAILED, "Failed to read page %i from file (jamPagedTileMapGetPage)", index);
+		}
+		clearerr(map->file);
+	}
+
+	return page;
+}
+
+// Throws out the page that was used longest ago, saving it first if it was changed. A changed page
+// that can't be saved is kept and the oldest page with nothing to save goes instead, returns false
+// if every page in memory has changes that can't be saved.
+static bool _evictPage(JamPagedTileMap* map) {
+	uint32 i, oldest = 0, index;
+	bool found = true;
+
+	for (i = 1; i < map->residentCount; i++)
+		if (map->pagesLastUsed[map->resident[i]] < map->pagesLastUsed[map->resident[oldest]])
+			oldest = i;
+
+	if (map->pagesModified[map->resident[oldest]] && !_writePage(map, map->resident[oldest])) {
+		found = false;
+		for (i = 0; i < map->residentCount; i++) {
+			if (!map->pagesModified[map->resident[i]] &&
+				(!found || map->pagesLastUsed[map->resident[i]] < map->pagesLastUsed[map->resident[oldest]])) {
+				oldest = i;
+				found = true;
+			}
+		}
+	}
+
+	if (found) {
+		index = map->resident[oldest];
+		jamTileMapFree(map->pages[index]);
+		map->pages[index] = NULL;
+		map->resident[oldest] = map->resident[--map->residentCount];
+	}
+
+	return found;
+}
+
+// Gets a page by index, loading it (and throwing out another if needed) if it isn't in memory
+static JamTileMap* _usePage(JamPagedTileMap* map, uint32 index) {
+	JamTileMap* page = map->pages[index];
+
+	if (page == NULL && (map->residentCount < map->pageBudget || _evictPage(map))) {
+		page = map->pages[index] = _readPage(map, index);
+		if (page != NULL)
+			map->resident[map->residentCount++] = index;
+	}
+
+	// The map may have moved since the page was loaded
+	if (page != NULL) {
+		map->pagesLastUsed[index] = ++map->clock;
+		page->xInWorld = map->xInWorld + (int)((index % map->pagesAcross) * map->pageSize);
+		page->yInWorld = map->yInWorld + (int)((index / map->pagesAcross) * map->pageSize);
+	}
+
+	return page;
+}
+
+// Makes a map around an open file whose header has already been read or written, closes the file if it fails
+static JamPagedTileMap* _createPagedMap(FILE* file, const uint32* header, JamSprite* tileSet, uint32 pageBudget) {
+	JamPagedTileMap* map = (JamPagedTileMap*)calloc(1, sizeof(JamPagedTileMap));
+	uint32 pageCount;
+
+	if (map != NULL) {
+		map->file = file;
+		map->tileSet = tileSet;
+		map->width = header[1];
+		map->height = header[2];
+		map->cellWidth = header[3];
+		map->cellHeight = header[4];
+		map->pageSize = header[5];
+		map->pagesAcross = (map->width + map->pageSize - 1) / map->pageSize;
+		map->pagesDown = (map->height + map->pageSize - 1) / map->pageSize;
+		pageCount = map->pagesAcross * map->pagesDown;
+		map->pageBudget = pageBudget > pageCount ? pageCount : pageBudget;
+		map->pageBudget = map->pageBudget < 1 ? 1 : map->pageBudget;
+
+		// Everything gets an extra spot so empty maps still allocate
+		map->pageBuffer = (uint16*)malloc(sizeof(uint16) * map->pageSize * map->pageSize);
+		map->pages = (JamTileMap**)calloc(pageCount + 1, sizeof(JamTileMap*));
+		map->pagesModified = (bool*)calloc(pageCount + 1, sizeof(bool));
+		map->pagesLastUsed = (uint64*)calloc(pageCount + 1, sizeof(uint64));
+		map->resident = (uint32*)malloc(sizeof(uint32) * map->pageBudget);
+
+		if (map->pageBuffer == NULL || map->pages == NULL || map->pagesModified == NULL ||
+			map->pagesLastUsed == NULL || map->resident == NULL) {
+			free(map->pageBuffer);
+			free(map->pages);
+			free(map->pagesModified);
+			free(map->pagesLastUsed);
+			free(map->resident);
+			free(map);
+			map = NULL;
+			jSetError(ERROR_ALLOC_FAILED, "Failed to allocate paged tile map's pages");
+		}
+	} else {
+		jSetError(ERROR_ALLOC_FAILED, "Failed to allocate paged tile map");
+	}
+
+	if (map == NULL)
+		fclose(file);
+
+	return map;
+}
+
+//////////////////////////////////////////////////////////
+JamPagedTileMap* jamPagedTileMapCreate(const char *filename, uint32 width, uint32 height, uint32 cellWidth,
+									   uint32 cellHeight, JamSprite *tileSet, uint32 pageBudget) {
+	uint32 header[6] = {PAGED_TILEMAP_VERSION, width, height, cellWidth, cellHeight, PAGED_TILEMAP_PAGE_SIZE};
+	JamPagedTileMap* map = NULL;
+	FILE* file = NULL;
+
+	if (filename != NULL && tileSet != NULL && cellWidth > 0 && cellHeight > 0)
+		file = fopen(filename, "w+b");
+
+	if (file != NULL) {
+		if (fwrite(gPagedTileMapMagic, sizeof(gPagedTileMapMagic), 1, file) == 1 && fwrite(header, sizeof(header), 1, file) == 1) {
+			map = _createPagedMap(file, header, tileSet, pageBudget);
+		} else {
+			fclose(file);
+			jSetError(ERROR_OPEN_FAILED, "Failed to write header to \"%s\" (jamPagedTileMapCreate)", filename);
+		}
+	} else {
+		if (filename == NULL)
+			jSetError(ERROR_NULL_POINTER, "Filename does not exist (jamPagedTileMapCreate)");
+		else if (tileSet == NULL)
+			jSetError(ERROR_NULL_POINTER, "Tile set does not exist (jamPagedTileMapCreate)");
+		else if (cellWidth == 0 || cellHeight == 0)
+			jSetError(ERROR_OUT_OF_BOUNDS, "Invalid cell size %ix%i (jamPagedTileMapCreate)", cellWidth, cellHeight);
+		else
+			jSetError(ERROR_OPEN_FAILED, "Failed to create \"%s\" (jamPagedTileMapCreate)", filename);
+	}
+
+	return map;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+JamPagedTileMap* jamPagedTileMapLoad(const char *filename, JamSprite *tileSet, uint32 pageBudget) {
+	char magic[sizeof(gPagedTileMapMagic)];
+	JamPagedTileMap* map = NULL;
+	FILE* file = NULL;
+	uint32 header[6];
+	bool readOnly = false;
+
+	// Read-only files can still be looked at
+	if (filename != NULL && tileSet != NULL) {
+		file = fopen(filename, "r+b");
+		if (file == NULL) {
+			file = fopen(filename, "rb");
+			readOnly = true;
+		}
+	}
+
+	if (file != NULL) {
+		if (fread(magic, sizeof(magic), 1, file) == 1 && fread(header, sizeof(header), 1, file) == 1 &&
+			memcmp(magic, gPagedTileMapMagic, sizeof(magic)) == 0 && header[0] == PAGED_TILEMAP_VERSION &&
+			header[3] != 0 && header[4] != 0 && header[5] != 0) {
+			map = _createPagedMap(file, header, tileSet, pageBudget);
+			if (map != NULL)
+				map->readOnly = readOnly;
+		} else {
+			fclose(file);
+			jSetError(ERROR_INCORRECT_FORMAT, "\"%s\" is not a paged tile map (jamPagedTileMapLoad)", filename);
+		}
+	} else {
+		if (filename == NULL)
+			jSetError(ERROR_NULL_POINTER, "Filename does not exist (jamPagedTileMapLoad)");
+		else if (tileSet == NULL)
+			jSetError(ERROR_NULL_POINTER, "Tile set does not exist (jamPagedTileMapLoad)");
+		else
+			jSetError(ERROR_OPEN_FAILED, "Failed to open \"%s\" (jamPagedTileMapLoad)", filename);
+	}
+
+	return map;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+void jamPagedTileMapFocus(JamPagedTileMap *map, int x, int y, int w, int h) {
+	int pageX1, pageY1, pageX2, pageY2, i, j;
+	uint32 loaded = 0;
+
+	if (map != NULL) {
+		if (_pageRange(map, x, y, w, h, &pageX1, &pageY1, &pageX2, &pageY2))
+			for (i = pageY1; i <= pageY2; i++)
+				for (j = pageX1; j <= pageX2 && loaded < map->pageBudget; j++, loaded++)
+					_usePage(map, i * map->pagesAcross + j);
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Map does not exist (jamPagedTileMapFocus)");
+	}
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+JamTileMap* jamPagedTileMapGetPage(JamPagedTileMap *map, uint32 pageX, uint32 pageY) {
+	JamTileMap* page = NULL;
+
+	if (map != NULL) {
+		if (pageX < map->pagesAcross && pageY < map->pagesDown)
+			page = _usePage(map, pageY * map->pagesAcross + pageX);
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Map does not exist (jamPagedTileMapGetPage)");
+	}
+
+	return page;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+JamFrame* jamPagedTileMapGet(JamPagedTileMap *map, uint32 x, uint32 y) {
+	JamFrame* val = NULL;
+	JamTileMap* page;
+
+	if (map != NULL) {
+		if (x < map->width && y < map->height) {
+			page = _usePage(map, (y / map->pageSize) * map->pagesAcross + x / map->pageSize);
+			if (page != NULL)
+				val = page->palette[page->tiles[(y % map->pageSize) * page->width + x % map->pageSize]];
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Map does not exist (jamPagedTileMapGet)");
+	}
+
+	return val;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+bool jamPagedTileMapSet(JamPagedTileMap *map, uint32 x, uint32 y, JamFrame *val) {
+	JamTileMap* page;
+	uint32 index;
+	uint16 tile = 0;
+	bool worked = false;
+
+	if (map != NULL && !map->readOnly && _tileOf(map, val, &tile)) {
+		if (x < map->width && y < map->height) {
+			index = (y / map->pageSize) * map->pagesAcross + x / map->pageSize;
+			page = _usePage(map, index);
+			if (page != NULL) {
+				worked = jamTileMapSet(page, x % map->pageSize, y % map->pageSize, val);
+				map->pagesModified[index] = true;
+			}
+		}
+	} else {
+		if (map == NULL)
+			jSetError(ERROR_NULL_POINTER, "Map does not exist (jamPagedTileMapSet)");
+		else if (map->readOnly)
+			jSetError(ERROR_FILE_FAILED, "Map's file can only be read (jamPagedTileMapSet)");
+		else
+			jSetError(ERROR_INCORRECT_FORMAT, "Frame is not in the map's tile set (jamPagedTileMapSet)");
+	}
+
+	return worked;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+bool jamPagedTileMapCollision(JamPagedTileMap *map, int x, int y, int w, int h) {
+	int pageX1, pageY1, pageX2, pageY2, i, j;
+	JamTileMap* page;
+	bool coll = false;
+
+	if (map != NULL) {
+		// Pages are placed in the world so the tile map check does the rest
+		if (_pageRange(map, x, y, w, h, &pageX1, &pageY1, &pageX2, &pageY2)) {
+			for (i = pageY1; i <= pageY2 && !coll; i++) {
+				for (j = pageX1; j <= pageX2 && !coll; j++) {
+					page = _usePage(map, i * map->pagesAcross + j);
+					coll = page != NULL && jamTileMapCollision(page, x, y, w, h);
+				}
+			}
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Map does not exist (jamPagedTileMapCollision)");
+	}
+
+	return coll;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+bool jamPagedTileMapFlush(JamPagedTileMap *map) {
+	bool worked = true;
+	uint32 i;
+
+	if (map != NULL) {
+		for (i = 0; i < map->residentCount; i++)
+			if (map->pagesModified[map->resident[i]])
+				worked = _writePage(map, map->resident[i]) && worked;
+		fflush(map->file);
+	} else {
+		worked = false;
+		jSetError(ERROR_NULL_POINTER, "Map does not exist (jamPagedTileMapFlush)");
+	}
+
+	return worked;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+void jamPagedTileMapFree(JamPagedTileMap *map) {
+	uint32 i;
+
+	if (map != NULL) {
+		jamPagedTileMapFlush(map);
+		for (i = 0; i < map->residentCount; i++)
+			jamTileMapFree(map->pages[map->resident[i]]);
+		fclose(map->file);
+		free(map->pageBuffer);
+		free(map->pages);
+		free(map->pagesModified);
+		free(map->pagesLastUsed);
+		free(map->resident);
+		free(map);
+	}
+}
+//////////////////////////////////////////////////////////
@@ -0,0 +1,580 @@
+#include "Pathfinding.h"
+#include "JamError.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+
+#if (PATHFINDING_QUEUE_SIZE & (PATHFINDING_QUEUE_SIZE - 1)) != 0
+#error "PATHFINDING_QUEUE_SIZE has to be a power of two so the queue positions can wrap around"
+#endif
+
+// Cost of a diagonal step on a map where every cell costs 1
+#define PATH_DIAGONAL 1.41421356f
+
+// heapPos of a cell that isn't in the heap yet, and of one that has already been expanded
+#define HEAP_NONE (UINT32_MAX - 1)
+#define HEAP_CLOSED UINT32_MAX
+
+// The eight directions paths can step in
+static const int gDirX[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+static const int gDirY[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+
+// Weather or not a cell can be walked through, cells outside the map can't
+static inline bool _open(JamPathfinder* pf, int x, int y) {
+	return x >= 0 && y >= 0 && x < (int)pf->width && y < (int)pf->height &&
+		   !((pf->solid[y * pf->solidWords + x / 64] >> (x % 64)) & 1) &&
+		   (pf->costs == NULL || pf->costs[y * pf->width + x] != 0);
+}
+
+// Cost of the best path between two cells if nothing is in the way (octile distance)
+static inline float _distance(JamPathfinder* pf, uint32 a, uint32 b) {
+	uint32 dx = (uint32)abs((int)(a % pf->width) - (int)(b % pf->width));
+	uint32 dy = (uint32)abs((int)(a / pf->width) - (int)(b / pf->width));
+	return dx < dy ? (PATH_DIAGONAL - 1) * dx + dy : (PATH_DIAGONAL - 1) * dy + dx;
+}
+
+// -1, 0, or 1 depending on which side of 0 x is
+static inline int _sign(int x) {
+	return (x > 0) - (x < 0);
+}
+
+// Moves a cell up the heap until its parent's f isn't bigger
+static void _heapUp(JamPathfinder* pf, uint32 pos) {
+	uint32 cell = pf->heap[pos];
+
+	while (pos > 0 && pf->f[pf->heap[(pos - 1) / 2]] > pf->f[cell]) {
+		pf->heap[pos] = pf->heap[(pos - 1) / 2];
+		pf->heapPos[pf->heap[pos]] = pos;
+		pos = (pos - 1) / 2;
+	}
+
+	pf->heap[pos] = cell;
+	pf->heapPos[cell] = pos;
+}
+
+// Takes the cell with the lowest f out of the heap and marks it closed
+static uint32 _heapPop(JamPathfinder* pf) {
+	uint32 top = pf->heap[0];
+	uint32 last = pf->heap[--pf->heapSize];
+	uint32 pos = 0, child;
+
+	if (pf->heapSize > 0) {
+		while ((child = pos * 2 + 1) < pf->heapSize) {
+			if (child + 1 < pf->heapSize && pf->f[pf->heap[child + 1]] < pf->f[pf->heap[child]])
+				child++;
+			if (pf->f[pf->heap[child]] >= pf->f[last])
+				break;
+			pf->heap[pos] = pf->heap[child];
+			pf->heapPos[pf->heap[pos]] = pos;
+			pos = child;
+		}
+		pf->heap[pos] = last;
+		pf->heapPos[last] = pos;
+	}
+
+	pf->heapPos[top] = HEAP_CLOSED;
+	return top;
+}
+
+// Offers a way to reach a cell, which is kept if its cheaper than what was found before
+static void _relax(JamPathfinder* pf, uint32 cell, uint32 from, float g, uint32 goal) {
+	if (pf->visited[cell] != pf->search) {
+		pf->visited[cell] = pf->search;
+		pf->heapPos[cell] = HEAP_NONE;
+		pf->g[cell] = FLT_MAX;
+	}
+
+	if (pf->heapPos[cell] != HEAP_CLOSED && g < pf->g[cell]) {
+		pf->g[cell] = g;
+		pf->f[cell] = g + _distance(pf, cell, goal);
+		pf->parent[cell] = from;
+		if (pf->heapPos[cell] == HEAP_NONE) {
+			pf->heap[pf->heapSize] = cell;
+			pf->heapPos[cell] = pf->heapSize++;
+		}
+		_heapUp(pf, pf->heapPos[cell]);
+	}
+}
+
+// Offers every cell around a cell, diagonals only if they don't cut a corner
+static void _expandAStar(JamPathfinder* pf, uint32 cell, uint32 goal) {
+	int x = (int)(cell % pf->width), y = (int)(cell / pf->width), nx, ny, i;
+	uint32 next;
+
+	for (i = 0; i < 8; i++) {
+		nx = x + gDirX[i];
+		ny = y + gDirY[i];
+		if (_open(pf, nx, ny) && (i % 2 == 0 || (_open(pf, nx, y) && _open(pf, x, ny)))) {
+			next = ny * pf->width + nx;
+			_relax(pf, next, cell, pf->g[cell] + pf->costs[next] * (i % 2 == 0 ? 1 : PATH_DIAGONAL), goal);
+		}
+	}
+}
+
+// Steps from a cell in a direction until it reaches a cell the path might turn at (a jump point),
+// returning false if it runs into something first. Diagonal steps look straight out both ways
+// at every cell, and a diagonal step is never taken past a corner.
+static bool _jump(JamPathfinder* pf, int x, int y, int dx, int dy, int goalX, int goalY, int* jumpX, int* jumpY) {
+	int straightX, straightY;
+
+	while (true) {
+		x += dx;
+		y += dy;
+		if (!_open(pf, x, y))
+			return false;
+		if (x == goalX && y == goalY)
+			break;
+
+		if (dx != 0 && dy != 0) {
+			if (_jump(pf, x, y, dx, 0, goalX, goalY, &straightX, &straightY) ||
+				_jump(pf, x, y, 0, dy, goalX, goalY, &straightX, &straightY))
+				break;
+			if (!_open(pf, x + dx, y) || !_open(pf, x, y + dy))
+				return false;
+		} else if (dx != 0) {
+			// A cell beside this one that was blocked beside the last one can only be reached from here
+			if ((_open(pf, x, y - 1) && !_open(pf, x - dx, y - 1)) || (_open(pf, x, y + 1) && !_open(pf, x - dx, y + 1)))
+				break;
+		} else {
+			if ((_open(pf, x - 1, y) && !_open(pf, x - 1, y - dy)) || (_open(pf, x + 1, y) && !_open(pf, x + 1, y - dy)))
+				break;
+		}
+	}
+
+	*jumpX = x;
+	*jumpY = y;
+	return true;
+}
+
+// Jumps in every direction a path through a cell could sensibly go given where it came from
+static void _expandJumpPoints(JamPathfinder* pf, uint32 cell, uint32 goal) {
+	int x = (int)(cell % pf->width), y = (int)(cell / pf->width);
+	int dirX[8], dirY[8], dx, dy, count = 0, i, jumpX, jumpY;
+	uint32 jumpCell;
+
+	if (pf->parent[cell] == cell) {
+		// The start goes everywhere it can
+		for (i = 0; i < 8; i++) {
+			if (i % 2 == 0 || (_open(pf, x + gDirX[i], y) && _open(pf, x, y + gDirY[i]))) {
+				dirX[count] = gDirX[i];
+				dirY[count++] = gDirY[i];
+			}
+		}
+	} else {
+		dx = _sign(x - (int)(pf->parent[cell] % pf->width));
+		dy = _sign(y - (int)(pf->parent[cell] / pf->width));
+		if (dx != 0 && dy != 0) {
+			dirX[count] = dx;
+			dirY[count++] = 0;
+			dirX[count] = 0;
+			dirY[count++] = dy;
+			if (_open(pf, x + dx, y) && _open(pf, x, y + dy)) {
+				dirX[count] = dx;
+				dirY[count++] = dy;
+			}
+		} else {
+			// Straight ahead, either side, and the diagonals between them that don't cut a corner
+			for (i = -1; i <= 1; i += 2) {
+				if (_open(pf, x + dy * i, y + dx * i)) {
+					dirX[count] = dy * i;
+					dirY[count++] = dx * i;
+					if (_open(pf, x + dx, y + dy)) {
+						dirX[count] = dx + dy * i;
+						dirY[count++] = dy + dx * i;
+					}
+				}
+			}
+			dirX[count] = dx;
+			dirY[count++] = dy;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		if (_jump(pf, x, y, dirX[i], dirY[i], (int)(goal % pf->width), (int)(goal / pf->width), &jumpX, &jumpY)) {
+			jumpCell = jumpY * pf->width + jumpX;
+			_relax(pf, jumpCell, cell, pf->g[cell] + _distance(pf, cell, jumpCell), goal);
+		}
+	}
+}
+
+// Makes sure a path has room for some number of cells
+static bool _pathReserve(JamPath* path, uint32 count) {
+	uint32* newX;
+	uint32* newY;
+
+	if (count > path->capacity) {
+		newX = (uint32*)realloc(path->x, sizeof(uint32) * count);
+		if (newX != NULL)
+			path->x = newX;
+		newY = (uint32*)realloc(path->y, sizeof(uint32) * count);
+		if (newY != NULL)
+			path->y = newY;
+
+		if (newX == NULL || newY == NULL) {
+			jSetError(ERROR_REALLOC_FAILED, "Failed to grow path (jamPathfinderFind)");
+			return false;
+		}
+		path->capacity = count;
+	}
+
+	return true;
+}
+
+// Copies one path over another, growing it if needed
+static bool _pathCopy(JamPath* dest, const JamPath* src) {
+	dest->length = 0;
+	if (src->length == 0)
+		return true;
+
+	if (_pathReserve(dest, src->length)) {
+		memcpy(dest->x, src->x, sizeof(uint32) * src->length);
+		memcpy(dest->y, src->y, sizeof(uint32) * src->length);
+		dest->length = src->length;
+		return true;
+	}
+
+	return false;
+}
+
+// Walks back from the goal filling in every cell, since jump points can be any distance apart
+// (always in a straight or diagonal line though)
+static bool _buildPath(JamPathfinder* pf, uint32 start, uint32 goal, JamPath* path) {
+	uint32 cell, count = 1, i;
+	int x, y, parentX, parentY, dx, dy;
+
+	for (cell = goal; cell != start; cell = pf->parent[cell]) {
+		dx = abs((int)(cell % pf->width) - (int)(pf->parent[cell] % pf->width));
+		dy = abs((int)(cell / pf->width) - (int)(pf->parent[cell] / pf->width));
+		count += dx > dy ? dx : dy;
+	}
+
+	if (!_pathReserve(path, count))
+		return false;
+
+	i = count - 1;
+	path->x[i] = goal % pf->width;
+	path->y[i] = goal / pf->width;
+	for (cell = goal; cell != start; cell = pf->parent[cell]) {
+		x = (int)(cell % pf->width);
+		y = (int)(cell / pf->width);
+		parentX = (int)(pf->parent[cell] % pf->width);
+		parentY = (int)(pf->parent[cell] / pf->width);
+		dx = _sign(parentX - x);
+		dy = _sign(parentY - y);
+		while (x != parentX || y != parentY) {
+			x += dx;
+			y += dy;
+			path->x[--i] = (uint32)x;
+			path->y[i] = (uint32)y;
+		}
+	}
+	path->length = count;
+
+	return true;
+}
+
+// Finds the cheapest path between two open cells, leaving path empty if there is none
+static bool _search(JamPathfinder* pf, uint32 start, uint32 goal, JamPath* path) {
+	bool found = false;
+	uint32 cell;
+
+	// Cells from an old search just look unvisited, so nothing is cleared unless the counter wraps
+	if (++pf->search == 0) {
+		memset(pf->visited, 0, sizeof(uint32) * pf->width * pf->height);
+		pf->search = 1;
+	}
+	pf->heapSize = 0;
+	_relax(pf, start, start, 0, goal);
+
+	while (pf->heapSize > 0 && !found) {
+		cell = _heapPop(pf);
+		if (cell == goal)
+			found = true;
+		else if (pf->costs != NULL)
+			_expandAStar(pf, cell, goal);
+		else
+			_expandJumpPoints(pf, cell, goal);
+	}
+
+	return found && _buildPath(pf, start, goal, path);
+}
+
+// Finds a path using the cache if it can (searchLock must be held)
+static bool _findCached(JamPathfinder* pf, uint32 startX, uint32 startY, uint32 goalX, uint32 goalY, JamPath* path) {
+	JamPathCacheEntry* entry;
+	uint32 start, goal;
+	bool found = false;
+
+	path->length = 0;
+	if (_open(pf, (int)startX, (int)startY) && _open(pf, (int)goalX, (int)goalY)) {
+		start = startY * pf->width + startX;
+		goal = goalY * pf->width + goalX;
+		entry = &pf->cache[(start * 2654435761u ^ goal) % PATHFINDING_CACHE_SIZE];
+
+		if (entry->used && entry->start == start && entry->goal == goal && entry->revision == pf->revision) {
+			found = _pathCopy(path, &entry->path) && path->length > 0;
+		} else {
+			found = _search(pf, start, goal, path);
+			entry->used = _pathCopy(&entry->path, path);
+			entry->start = start;
+			entry->goal = goal;
+			entry->revision = pf->revision;
+		}
+	}
+
+	return found;
+}
+
+// Catches the pathfinder's copy of the solid bits up with the map (searchLock must be held)
+static void _syncMap(JamPathfinder* pf) {
+	if (pf->map->revision != pf->revision) {
+		memcpy(pf->solid, pf->map->solid, sizeof(uint64) * pf->solidWords * pf->height);
+		pf->revision = pf->map->revision;
+	}
+}
+
+// Finds requested paths one at a time until told to quit
+static void* _pathWorker(void* data) {
+	JamPathfinder* pf = (JamPathfinder*)data;
+	JamPathRequest* request;
+
+	pthread_mutex_lock(&pf->queueLock);
+	while (!pf->quit) {
+		if (pf->queueNext == pf->queueTail) {
+			pthread_cond_wait(&pf->queueSignal, &pf->queueLock);
+		} else {
+			// Only this thread touches the request until queueNext moves past it
+			request = &pf->queue[pf->queueNext % PATHFINDING_QUEUE_SIZE];
+			pthread_mutex_unlock(&pf->queueLock);
+
+			pthread_mutex_lock(&pf->searchLock);
+			_findCached(pf, request->startX, request->startY, request->goalX, request->goalY, &request->path);
+			pthread_mutex_unlock(&pf->searchLock);
+
+			pthread_mutex_lock(&pf->queueLock);
+			pf->queueNext++;
+		}
+	}
+	pthread_mutex_unlock(&pf->queueLock);
+
+	return NULL;
+}
+
+//////////////////////////////////////////////////////////
+JamPath* jamPathCreate() {
+	JamPath* path = (JamPath*)calloc(1, sizeof(JamPath));
+
+	if (path == NULL)
+		jSetError(ERROR_ALLOC_FAILED, "Failed to allocate path (jamPathCreate)");
+
+	return path;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+void jamPathFree(JamPath *path) {
+	if (path != NULL) {
+		free(path->x);
+		free(path->y);
+		free(path);
+	}
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+JamPathfinder* jamPathfinderCreate(JamTileMap *map) {
+	JamPathfinder* pf = NULL;
+	uint32 cells;
+
+	if (map != NULL) {
+		pf = (JamPathfinder*)calloc(1, sizeof(JamPathfinder));
+		if (pf != NULL) {
+			pf->map = map;
+			pf->width = map->width;
+			pf->height = map->height;
+			pf->solidWords = map->solidWords;
+			pf->revision = map->revision;
+			cells = map->width * map->height;
+
+			// Everything gets an extra spot so empty maps still allocate
+			pf->solid = (uint64*)malloc(sizeof(uint64) * (pf->solidWords * pf->height + 1));
+			pf->g = (float*)malloc(sizeof(float) * (cells + 1));
+			pf->f = (float*)malloc(sizeof(float) * (cells + 1));
+			pf->parent = (uint32*)malloc(sizeof(uint32) * (cells + 1));
+			pf->heapPos = (uint32*)malloc(sizeof(uint32) * (cells + 1));
+			pf->visited = (uint32*)calloc(cells + 1, sizeof(uint32));
+			pf->heap = (uint32*)malloc(sizeof(uint32) * (cells + 1));
+
+			if (pf->solid != NULL && pf->g != NULL && pf->f != NULL && pf->parent != NULL && pf->heapPos != NULL &&
+				pf->visited != NULL && pf->heap != NULL) {
+				memcpy(pf->solid, map->solid, sizeof(uint64) * pf->solidWords * pf->height);
+				pthread_mutex_init(&pf->queueLock, NULL);
+				pthread_mutex_init(&pf->searchLock, NULL);
+				pthread_cond_init(&pf->queueSignal, NULL);
+			} else {
+				free(pf->solid);
+				free(pf->g);
+				free(pf->f);
+				free(pf->parent);
+				free(pf->heapPos);
+				free(pf->visited);
+				free(pf->heap);
+				free(pf);
+				pf = NULL;
+				jSetError(ERROR_ALLOC_FAILED, "Failed to allocate pathfinder's search space (jamPathfinderCreate)");
+			}
+		} else {
+			jSetError(ERROR_ALLOC_FAILED, "Failed to allocate pathfinder (jamPathfinderCreate)");
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Map does not exist (jamPathfinderCreate)");
+	}
+
+	return pf;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+void jamPathfinderSetCosts(JamPathfinder *pathfinder, const uint8 *costs) {
+	int i;
+
+	if (pathfinder != NULL) {
+		pthread_mutex_lock(&pathfinder->searchLock);
+		pathfinder->costs = costs;
+		for (i = 0; i < PATHFINDING_CACHE_SIZE; i++)
+			pathfinder->cache[i].used = false;
+		pthread_mutex_unlock(&pathfinder->searchLock);
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Pathfinder does not exist (jamPathfinderSetCosts)");
+	}
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+bool jamPathfinderFind(JamPathfinder *pathfinder, uint32 startX, uint32 startY, uint32 goalX, uint32 goalY, JamPath *path) {
+	bool found = false;
+
+	if (pathfinder != NULL && path != NULL) {
+		pthread_mutex_lock(&pathfinder->searchLock);
+		_syncMap(pathfinder);
+		found = _findCached(pathfinder, startX, startY, goalX, goalY, path);
+		pthread_mutex_unlock(&pathfinder->searchLock);
+	} else {
+		if (pathfinder == NULL)
+			jSetError(ERROR_NULL_POINTER, "Pathfinder does not exist (jamPathfinderFind)");
+		if (path == NULL)
+			jSetError(ERROR_NULL_POINTER, "Path does not exist (jamPathfinderFind)");
+	}
+
+	return found;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+bool jamPathfinderRequest(JamPathfinder *pathfinder, uint32 startX, uint32 startY, uint32 goalX, uint32 goalY,
+						  JamPathCallback callback, void *userData) {
+	JamPathRequest* request;
+	bool worked = false;
+
+	if (pathfinder != NULL) {
+		// Only this thread moves queueTail and queueHead so they can be read without the lock
+		if (pathfinder->queueTail - pathfinder->queueHead < PATHFINDING_QUEUE_SIZE) {
+			pthread_mutex_lock(&pathfinder->searchLock);
+			_syncMap(pathfinder);
+			pthread_mutex_unlock(&pathfinder->searchLock);
+
+			if (!pathfinder->workerStarted)
+				pathfinder->workerStarted = pthread_create(&pathfinder->worker, NULL, _pathWorker, pathfinder) == 0;
+
+			if (pathfinder->workerStarted) {
+				request = &pathfinder->queue[pathfinder->queueTail % PATHFINDING_QUEUE_SIZE];
+				request->startX = startX;
+				request->startY = startY;
+				request->goalX = goalX;
+				request->goalY = goalY;
+				request->callback = callback;
+				request->userData = userData;
+
+				pthread_mutex_lock(&pathfinder->queueLock);
+				pathfinder->queueTail++;
+				pthread_cond_signal(&pathfinder->queueSignal);
+				pthread_mutex_unlock(&pathfinder->queueLock);
+				worked = true;
+			} else {
+				jSetError(ERROR_ALLOC_FAILED, "Failed to start pathfinding thread (jamPathfinderRequest)");
+			}
+		} else {
+			jSetError(ERROR_OUT_OF_BOUNDS, "Pathfinding queue is full (jamPathfinderRequest)");
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Pathfinder does not exist (jamPathfinderRequest)");
+	}
+
+	return worked;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+void jamPathfinderUpdate(JamPathfinder *pathfinder) {
+	JamPathRequest* request;
+	uint32 done;
+
+	if (pathfinder != NULL) {
+		pthread_mutex_lock(&pathfinder->searchLock);
+		_syncMap(pathfinder);
+		pthread_mutex_unlock(&pathfinder->searchLock);
+
+		pthread_mutex_lock(&pathfinder->queueLock);
+		done = pathfinder->queueNext;
+		pthread_mutex_unlock(&pathfinder->queueLock);
+
+		// Callbacks may make new requests, which is fine since those go after done
+		while (pathfinder->queueHead != done) {
+			request = &pathfinder->queue[pathfinder->queueHead % PATHFINDING_QUEUE_SIZE];
+			if (request->callback != NULL)
+				request->callback(&request->path, request->userData);
+			pathfinder->queueHead++;
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Pathfinder does not exist (jamPathfinderUpdate)");
+	}
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+void jamPathfinderFree(JamPathfinder *pathfinder) {
+	int i;
+
+	if (pathfinder != NULL) {
+		if (pathfinder->workerStarted) {
+			pthread_mutex_lock(&pathfinder->queueLock);
+			pathfinder->quit = true;
+			pthread_cond_signal(&pathfinder->queueSignal);
+			pthread_mutex_unlock(&pathfinder->queueLock);
+			pthread_join(pathfinder->worker, NULL);
+		}
+
+		for (i = 0; i < PATHFINDING_CACHE_SIZE; i++) {
+			free(pathfinder->cache[i].path.x);
+			free(pathfinder->cache[i].path.y);
+		}
+		for (i = 0; i < PATHFINDING_QUEUE_SIZE; i++) {
+			free(pathfinder->queue[i].path.x);
+			free(pathfinder->queue[i].path.y);
+		}
+
+		pthread_mutex_destroy(&pathfinder->queueLock);
+		pthread_mutex_destroy(&pathfinder->searchLock);
+		pthread_cond_destroy(&pathfinder->queueSignal);
+		free(pathfinder->solid);
+		free(pathfinder->g);
+		free(pathfinder->f);
+		free(pathfinder->parent);
+		free(pathfinder->heapPos);
+		free(pathfinder->visited);
+		free(pathfinder->heap);
+		free(pathfinder);
+	}
+}
+//////////////////////////////////////////////////////////
@@ -0,0 +1,306 @@
+#include "PixelMask.h"
+#include "Texture.h"
+#include "Sprite.h"
+#include "JamError.h"
+#include <malloc.h>
+#include <string.h>
+#include <math.h>
+
+/// \brief Grabs 64 bits of a row starting at any pixel, anything past the end of the row is 0
+static inline uint64 _rowBits(const uint64* row, uint32 words, uint32 start) {
+	uint32 word = start / 64;
+	uint32 shift = start % 64;
+	uint64 bits;
+
+	if (word >= words)
+		return 0;
+	bits = row[word] >> shift;
+	if (shift != 0 && word + 1 < words)
+		bits |= row[word + 1] << (64 - shift);
+	return bits;
+}
+
+/// \brief A word with the lowest count bits set
+static inline uint64 _lowBits(uint32 count) {
+	return count >= 64 ? ~(uint64)0 : ((uint64)1 << count) - 1;
+}
+
+/// \brief Checks if any pixel in [start, end) of a row is solid
+static bool _spanHit(JamPixelMask* mask, int row, int start, int end) {
+	const uint64* bits;
+	int i;
+
+	if (row < 0 || row >= (int)mask->height)
+		return false;
+	start = start < 0 ? 0 : start;
+	end = end > (int)mask->width ? (int)mask->width : end;
+	bits = mask->bits + row * mask->words;
+
+	for (i = start; i < end; i += 64)
+		if (_rowBits(bits, mask->words, (uint32)i) & _lowBits((uint32)(end - i)))
+			return true;
+	return false;
+}
+
+/// \brief Checks the pixels of a row whose centres are strictly between x1 and x2, relative to the mask
+static inline bool _spanHitReal(JamPixelMask* mask, int row, double x1, double x2) {
+	// Pixel i's centre is i + 0.5
+	return x2 > x1 && _spanHit(mask, row, (int)floor(x1 - 0.5) + 1, (int)ceil(x2 - 0.5));
+}
+
+///////////////////////////////////////////////////////////////
+JamPixelMask* jamPixelMaskCreate(uint32 width, uint32 height) {
+	JamPixelMask* mask = (JamPixelMask*)malloc(sizeof(JamPixelMask));
+	uint32 words = (width + 63) / 64;
+	uint64* bits = (uint64*)calloc((size_t)words * height + 1, sizeof(uint64));
+
+	if (mask != NULL && bits != NULL) {
+		mask->width = width;
+		mask->height = height;
+		mask->words = words;
+		mask->bits = bits;
+	} else {
+		free(mask);
+		free(bits);
+		mask = NULL;
+		jSetError(ERROR_ALLOC_FAILED, "Failed to allocate pixel mask (jamPixelMaskCreate)");
+	}
+
+	return mask;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+JamPixelMask* jamPixelMaskFromTexture(JamTexture* texture, sint32 x, sint32 y, sint32 w, sint32 h) {
+	JamPixelMask* mask = NULL;
+	uint32 texWords, i, j;
+	sint32 row;
+
+	if (texture != NULL && texture->alphaMask != NULL && w >= 0 && h >= 0) {
+		mask = jamPixelMaskCreate((uint32)w, (uint32)h);
+		texWords = ((uint32)texture->w + 63) / 64;
+
+		// Copy the frame's part of the texture a word at a time, leaving anything off the texture clear
+		if (mask != NULL && x >= 0 && mask->words > 0) {
+			for (i = 0; i < mask->height; i++) {
+				row = y + (sint32)i;
+				if (row < 0 || row >= texture->h)
+					continue;
+				for (j = 0; j < mask->words; j++)
+					mask->bits[i * mask->words + j] = _rowBits(texture->alphaMask + row * texWords, texWords, (uint32)x + j * 64);
+				mask->bits[i * mask->words + mask->words - 1] &= _lowBits(mask->width - (mask->words - 1) * 64);
+			}
+		}
+	} else if (texture == NULL) {
+		jSetError(ERROR_NULL_POINTER, "Texture does not exist (jamPixelMaskFromTexture)");
+	}
+
+	return mask;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+JamPixelMask* jamPixelMaskFromSprite(JamSprite* sprite, uint32 frame) {
+	JamPixelMask** newMasks;
+	JamFrame* source;
+
+	if (sprite != NULL && frame < sprite->animationLength) {
+		// Frames may have been appended since the masks were made room for
+		if (sprite->pixelMaskCount < sprite->animationLength) {
+			newMasks = (JamPixelMask**)realloc(sprite->pixelMasks, sizeof(JamPixelMask*) * sprite->animationLength);
+			if (newMasks == NULL) {
+				jSetError(ERROR_ALLOC_FAILED, "Failed to grow pixel mask list (jamPixelMaskFromSprite)");
+				return NULL;
+			}
+			memset(newMasks + sprite->pixelMaskCount, 0, sizeof(JamPixelMask*) * (sprite->animationLength - sprite->pixelMaskCount));
+			sprite->pixelMasks = newMasks;
+			sprite->pixelMaskCount = sprite->animationLength;
+		}
+
+		source = sprite->frames[frame];
+		if (sprite->pixelMasks[frame] == NULL && source != NULL && source->tex != NULL && source->tex->alphaMask != NULL)
+			sprite->pixelMasks[frame] = jamPixelMaskFromTexture(source->tex, source->x, source->y, source->w, source->h);
+
+		return sprite->pixelMasks[frame];
+	} else {
+		if (sprite == NULL)
+			jSetError(ERROR_NULL_POINTER, "Sprite does not exist (jamPixelMaskFromSprite)");
+		else
+			jSetError(ERROR_OUT_OF_BOUNDS, "Sprite does not have frame %i (jamPixelMaskFromSprite)", frame);
+	}
+
+	return NULL;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void jamPixelMaskSet(JamPixelMask* mask, uint32 x, uint32 y, bool solid) {
+	if (mask != NULL) {
+		if (x < mask->width && y < mask->height) {
+			if (solid)
+				mask->bits[y * mask->words + x / 64] |= (uint64)1 << (x % 64);
+			else
+				mask->bits[y * mask->words + x / 64] &= ~((uint64)1 << (x % 64));
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Mask does not exist (jamPixelMaskSet)");
+	}
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+bool jamPixelMaskGet(JamPixelMask* mask, uint32 x, uint32 y) {
+	if (mask != NULL) {
+		if (x < mask->width && y < mask->height)
+			return (mask->bits[y * mask->words + x / 64] >> (x % 64)) & 1;
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Mask does not exist (jamPixelMaskGet)");
+	}
+
+	return false;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+bool jamPixelMaskCollision(JamPixelMask* mask1, int x1, int y1, JamPixelMask* mask2, int x2, int y2) {
+	int offsetX, offsetY, startX, endX, startY, endY, row, i;
+	const uint64* row1;
+	const uint64* row2;
+
+	if (mask1 != NULL && mask2 != NULL) {
+		// Everything is done relative to mask 1, only the overlapping rectangle is looked at
+		offsetX = x2 - x1;
+		offsetY = y2 - y1;
+		startX = offsetX > 0 ? offsetX : 0;
+		endX = offsetX + (int)mask2->width < (int)mask1->width ? offsetX + (int)mask2->width : (int)mask1->width;
+		startY = offsetY > 0 ? offsetY : 0;
+		endY = offsetY + (int)mask2->height < (int)mask1->height ? offsetY + (int)mask2->height : (int)mask1->height;
+
+		for (row = startY; row < endY; row++) {
+			row1 = mask1->bits + row * mask1->words;
+			row2 = mask2->bits + (row - offsetY) * mask2->words;
+
+			// Line both rows up on the same 64 pixels and see if any are solid in both
+			for (i = startX; i < endX; i += 64)
+				if (_rowBits(row1, mask1->words, (uint32)i) & _rowBits(row2, mask2->words, (uint32)(i - offsetX)) & _lowBits((uint32)(endX - i)))
+					return true;
+		}
+	} else {
+		if (mask1 == NULL)
+			jSetError(ERROR_NULL_POINTER, "Mask 1 does not exist (jamPixelMaskCollision)");
+		if (mask2 == NULL)
+			jSetError(ERROR_NULL_POINTER, "Mask 2 does not exist (jamPixelMaskCollision)");
+	}
+
+	return false;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+bool jamPixelMaskRectCollision(JamPixelMask* mask, int x, int y, double rx, double ry, double rw, double rh) {
+	int row, startY, endY;
+
+	if (mask != NULL) {
+		startY = (int)floor(ry - y - 0.5) + 1;
+		endY = (int)ceil(ry + rh - y - 0.5);
+		startY = startY < 0 ? 0 : startY;
+		endY = endY > (int)mask->height ? (int)mask->height : endY;
+
+		for (row = startY; row < endY; row++)
+			if (_spanHitReal(mask, row, rx - x, rx + rw - x))
+				return true;
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Mask does not exist (jamPixelMaskRectCollision)");
+	}
+
+	return false;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+bool jamPixelMaskCircleCollision(JamPixelMask* mask, int x, int y, double cx, double cy, double radius) {
+	int row, startY, endY;
+	double dy, halfWidth;
+
+	if (mask != NULL) {
+		startY = (int)floor(cy - radius - y - 0.5) + 1;
+		endY = (int)ceil(cy + radius - y - 0.5);
+		startY = startY < 0 ? 0 : startY;
+		endY = endY > (int)mask->height ? (int)mask->height : endY;
+
+		// Each row only has to check the slice of the circle at the row's centre
+		for (row = startY; row < endY; row++) {
+			dy = (y + row + 0.5) - cy;
+			halfWidth = sqrt(fmax(radius * radius - dy * dy, 0));
+			if (_spanHitReal(mask, row, cx - halfWidth - x, cx + halfWidth - x))
+				return true;
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Mask does not exist (jamPixelMaskCircleCollision)");
+	}
+
+	return false;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+bool jamPixelMaskPolygonCollision(JamPixelMask* mask, int x, int y, JamPolygon* polygon, double px, double py) {
+	int row, startY, endY;
+	unsigned int i, next;
+	double rowY, ax, ay, bx, by, crossX, left, right;
+	JamPolygon scratch;
+
+	if (mask != NULL && polygon != NULL) {
+		if (polygon->vertices < 3)
+			return false;
+
+		// Polygons that were never cached get their bounds worked out just for this check
+		polygon = _jamPolygonPrepare(polygon, &scratch, 0);
+		if (polygon == NULL)
+			return false;
+
+		startY = (int)floor(py + polygon->boundsY1 - y - 0.5) + 1;
+		endY = (int)ceil(py + polygon->boundsY2 - y - 0.5);
+		startY = startY < 0 ? 0 : startY;
+		endY = endY > (int)mask->height ? (int)mask->height : endY;
+
+		// A convex polygon crosses each row's centre line at most twice, so it's just one span per row
+		for (row = startY; row < endY; row++) {
+			rowY = (y + row + 0.5) - py;
+			left = INFINITY;
+			right = -INFINITY;
+			for (i = 0; i < polygon->vertices; i++) {
+				next = (i + 1) % polygon->vertices;
+				ax = polygon->xVerts[i];
+				ay = polygon->yVerts[i];
+				bx = polygon->xVerts[next];
+				by = polygon->yVerts[next];
+				if ((ay <= rowY && by > rowY) || (by <= rowY && ay > rowY)) {
+					crossX = ax + (rowY - ay) * (bx - ax) / (by - ay);
+					left = crossX < left ? crossX : left;
+					right = crossX > right ? crossX : right;
+				}
+			}
+
+			if (_spanHitReal(mask, row, px + left - x, px + right - x))
+				return true;
+		}
+	} else {
+		if (mask == NULL)
+			jSetError(ERROR_NULL_POINTER, "Mask does not exist (jamPixelMaskPolygonCollision)");
+		if (polygon == NULL)
+			jSetError(ERROR_NULL_POINTER, "Polygon does not exist (jamPixelMaskPolygonCollision)");
+	}
+
+	return false;
+}
+///////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////
+void jamPixelMaskFree(JamPixelMask* mask) {
+	if (mask != NULL) {
+		free(mask->bits);
+		free(mask);
+	}
+}
+///////////////////////////////////////////////////////////////
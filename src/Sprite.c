@@ -29,6 +29,8 @@ JamSprite* jamSpriteCreate(uint32 animationLength, uint16 frameDelay, bool loopi
 		sprite->originY = 0;
 		sprite->width = 0;
 		sprite->height = 0;
+		sprite->pixelMasks = NULL;
+		sprite->pixelMaskCount = 0;
 
 		// Check if list is a dud and shouldn't be
 		if (list == NULL && animationLength > 0) {
@@ -187,6 +189,11 @@ void jamSpriteFree(JamSprite *sprite, bool freeFrames, bool freeTextures) {
 		// Either way the frames list has to go
 		free(sprite->frames);
 
+		// Masks belong to the sprite regardless of who owns the frames
+		for (i = 0; i < sprite->pixelMaskCount; i++)
+			jamPixelMaskFree(sprite->pixelMasks[i]);
+		free(sprite->pixelMasks);
+
 		free(sprite);
 	}
 }
@@ -114,6 +114,7 @@ static bool loadObjectLayerIntoWorld(JamAssetHandler* handler, JamWorld* world,
 	tmx_object* currentObject = layer->content.objgr->head;
 	bool failedToLoad = false;
 	JamAsset* asset;
+	JamTMXProperty* property;
 
 	// Loop the linked list
 	while (currentObject != NULL) {
@@ -129,12 +130,27 @@ static bool loadObjectLayerIntoWorld(JamAssetHandler* handler, JamWorld* world,
 		}
 
 		if (tempEntity != NULL) {
-			jamWorldAddEntity(world, tempEntity);
-
-			// Load properties
+			// Load properties (before the entity is in the world so onCreation can see them)
 			if (currentObject->properties != NULL) {
 				tempEntity->properties = jamTMXDataCreate();
 				tmx_property_foreach(currentObject->properties, jamTMXDataSetProperty, tempEntity->properties);
+
+				// Objects may ask for components on top of whatever their entity asset has
+				property = jamTMXDataGetProperty(tempEntity->properties, "components");
+				if (property != NULL && property->type == tt_String)
+					tempEntity->components |= jamComponentMaskFromString(property->stringVal);
+
+				// Collision layers may be given as ints or as strings (so hex like 0x8 works)
+				property = jamTMXDataGetProperty(tempEntity->properties, "collision_layer");
+				if (property != NULL && property->type == tt_Int)
+					tempEntity->collisionLayer = (uint32)property->intVal;
+				else if (property != NULL && property->type == tt_String)
+					tempEntity->collisionLayer = (uint32)strtoul(property->stringVal, NULL, 0);
+				property = jamTMXDataGetProperty(tempEntity->properties, "collision_mask");
+				if (property != NULL && property->type == tt_Int)
+					tempEntity->collisionMask = (uint32)property->intVal;
+				else if (property != NULL && property->type == tt_String)
+					tempEntity->collisionMask = (uint32)strtoul(property->stringVal, NULL, 0);
 			}
 
 			// Adjust scale
@@ -157,6 +173,9 @@ static bool loadObjectLayerIntoWorld(JamAssetHandler* handler, JamWorld* world,
 			else
 				tempEntity->alpha = 0;
 			tempEntity->rot = currentObject->rotation;
+
+			// Only added once it's where it should be, so the world sorts it by its scaled/rotated box
+			jamWorldAddEntity(world, tempEntity);
 		} else {
 			failedToLoad = true;
 			jSetError(ERROR_ALLOC_FAILED, "Failed to create entity ID %i (loadObjectLayerIntoWorld)", currentObject->id);
@@ -187,7 +206,7 @@ static JamTileMap* createTileMapFromTMXLayer(JamAssetHandler* handler, tmx_layer
 				// Find the frame in the handler and load it into the map
 				currentSprite = jamAssetHandlerGetSprite(handler, tile->tileset->name);
 				if (currentSprite != NULL && tile->id < currentSprite->animationLength) {
-					map->grid[i] = currentSprite->frames[tile->id];
+					jamTileMapSet(map, i % mapW, i / mapW, currentSprite->frames[tile->id]);
 				} else {
 					jSetError(ERROR_TMX_TILEMAP_ERROR,
 							  "Tile layer %s contains tiles not present in the handler or the tile is out of range of the sprite");
@@ -260,6 +279,9 @@ JamWorld* jamTMXLoadWorld(JamAssetHandler *handler, const char *tmxFilename) {
 					currentLayer = currentLayer->next;
 				}
 			}
+
+			// The starting cell size is a guess, now that the entities are here we can do better
+			jamWorldAutoTuneGrid(world);
 		}
 	} else {
 		if (handler == NULL) {
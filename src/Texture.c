@@ -24,9 +24,27 @@ int shift = (req_format == STBI_rgb) ? 8 : 0;
 	const Uint32 amask = 0xff000000;
 #endif
 
-// This is essentially a hidden function, you can use it in your games (all the
-// error checking and such is there) but its meant for in-engine use.
-SDL_Texture* jamSDLTextureLoad(const char* filename) {
+// Packs the alpha channel of RGBA pixels into one bit per pixel, rows are padded to 64 bits
+static uint64* _createAlphaMask(const unsigned char* pixels, int w, int h) {
+	int words = (w + 63) / 64;
+	uint64* mask = (uint64*)calloc((size_t)words * h + 1, sizeof(uint64));
+	int i, j;
+
+	if (mask != NULL) {
+		for (i = 0; i < h; i++)
+			for (j = 0; j < w; j++)
+				if (pixels[(i * w + j) * 4 + 3] >= PIXEL_MASK_ALPHA)
+					mask[i * words + j / 64] |= (uint64)1 << (j % 64);
+	} else {
+		jSetError(ERROR_ALLOC_FAILED, "Failed to allocate alpha mask");
+	}
+
+	return mask;
+}
+
+// Loads a texture, and if alphaMask isn't NULL also packs its alpha into it while
+// the pixels are still around (so pixel masks never have to read from the GPU)
+static SDL_Texture* _loadTexture(const char* filename, uint64** alphaMask) {
 	int x, y, n;
 	SDL_Texture* tex = NULL;
 
@@ -37,6 +55,8 @@ SDL_Texture* jamSDLTextureLoad(const char* filename) {
 		tex = SDL_CreateTextureFromSurface(jamRendererGetInternalRenderer(), img);
 		if (tex == NULL)
 			jSetError(ERROR_SDL_ERROR, "SDL Error while converting to texture [%s]: %s", filename, SDL_GetError());
+		else if (alphaMask != NULL)
+			*alphaMask = _createAlphaMask(pixels, x, y);
 	} else {
 		if (pixels == NULL)
 			jSetError(ERROR_ALLOC_FAILED, "Failed to load image %s", filename);
@@ -49,6 +69,12 @@ SDL_Texture* jamSDLTextureLoad(const char* filename) {
 	return tex;
 }
 
+// This is essentially a hidden function, you can use it in your games (all the
+// error checking and such is there) but its meant for in-engine use.
+SDL_Texture* jamSDLTextureLoad(const char* filename) {
+	return _loadTexture(filename, NULL);
+}
+
 // Loads a surface using a filename, call with NULL filename to free the surface.
 // (Don't use this for long-term surface usage)
 SDL_Surface* jamSDLSurfaceLoad(const char* filename) {
@@ -94,6 +120,7 @@ JamTexture* jamTextureCreate(int w, int h) {
 			tex->w = w;
 			tex->h = h;
 			tex->renderTarget = true;
+			tex->alphaMask = NULL;
 			SDL_SetTextureBlendMode(tex->tex, SDL_BLENDMODE_BLEND);
 		} else {
 			free(tex);
@@ -118,6 +145,7 @@ JamTexture* jamTextureCreateFromTex(void* texture) {
 
 	if (tex != NULL && texture != NULL) {
 		tex->tex = texture;
+		tex->alphaMask = NULL;
 		SDL_QueryTexture(texture, NULL, NULL, &tex->w, &tex->h);
 
 	} else {
@@ -141,7 +169,8 @@ JamTexture* jamTextureLoad(const char *filename) {
 		tex = (JamTexture*) malloc(sizeof(JamTexture));
 
 		if (tex != NULL) {
-			sdltex = jamSDLTextureLoad(filename);
+			tex->alphaMask = NULL;
+			sdltex = _loadTexture(filename, &tex->alphaMask);
 
 			// And once again, check if we got a dud back
 			if (sdltex != NULL) {
@@ -177,6 +206,7 @@ JamTexture* jamTextureLoad(const char *filename) {
 void jamTextureFree(JamTexture *tex) {
 	if (tex != NULL) {
 		SDL_DestroyTexture(tex->tex);
+		free(tex->alphaMask);
 		free(tex);
 	}
 }
@@ -8,19 +8,198 @@
 #include <TileMap.h>
 #include "JamError.h"
 #include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
 #include <Sprite.h>
 
-//////////////////////////////////////////////////////////
-JamTileMap* jamTileMapCreate(uint32 width, uint32 height, uint32 cellWidth, uint32 cellHeight) {
+// Divides rounding towards negative infinity so pixels left of/above 0 land in negative cells
+static inline int _floorDiv(int a, uint32 b) {
+	int q = a / (int)b;
+	return (a % (int)b != 0 && a < 0) ? q - 1 : q;
+}
+
+// Weather or not a map has its cells, either as frames or as palette indices
+static inline bool _hasCells(JamTileMap* tileMap) {
+	return tileMap->grid != NULL || tileMap->tiles != NULL;
+}
+
+// Gets the frame in a cell by its index (y * width + x) for either kind of map (does not check bounds)
+JamFrame* _jamTileMapCellAt(JamTileMap* tileMap, uint32 index) {
+	return tileMap->grid != NULL ? tileMap->grid[index] : tileMap->palette[tileMap->tiles[index]];
+}
+
+// Finds a frame in an indexed map's palette, adding it to the end if it isn't there yet
+static bool _paletteIndex(JamTileMap* tileMap, JamFrame* frame, uint16* index) {
+	JamFrame** newPalette;
+	uint32 i, newCapacity;
+	bool found = frame == NULL;
+
+	*index = 0;
+	for (i = 1; i < tileMap->paletteSize && !found; i++) {
+		if (tileMap->palette[i] == frame) {
+			*index = (uint16)i;
+			found = true;
+		}
+	}
+
+	// Index 0 is NULL so the palette can hold at most UINT16_MAX frames
+	if (!found && tileMap->paletteSize <= UINT16_MAX) {
+		if (tileMap->paletteSize == tileMap->paletteCapacity) {
+			newCapacity = tileMap->paletteCapacity * 2 > UINT16_MAX + 1 ? UINT16_MAX + 1 : tileMap->paletteCapacity * 2;
+			newPalette = (JamFrame**)realloc(tileMap->palette, sizeof(JamFrame*) * newCapacity);
+			if (newPalette != NULL) {
+				tileMap->palette = newPalette;
+				tileMap->paletteCapacity = newCapacity;
+			} else {
+				jSetError(ERROR_REALLOC_FAILED, "Failed to grow tile map palette (jamTileMapSet)");
+			}
+		}
+
+		if (tileMap->paletteSize < tileMap->paletteCapacity) {
+			tileMap->palette[tileMap->paletteSize] = frame;
+			*index = (uint16)tileMap->paletteSize++;
+			found = true;
+		}
+	} else if (!found) {
+		jSetError(ERROR_OUT_OF_BOUNDS, "Tile map palette is full (jamTileMapSet)");
+	}
+
+	return found;
+}
+
+// Sets or clears a cell's solid bit (does not check bounds)
+static inline void _setSolid(JamTileMap* tileMap, uint32 x, uint32 y, bool solid) {
+	uint64* word = &tileMap->solid[y * tileMap->solidWords + x / 64];
+	if (solid)
+		*word |= (uint64)1 << (x % 64);
+	else
+		*word &= ~((uint64)1 << (x % 64));
+}
+
+// Checks a single cell's solid bit, cells outside the map are never solid
+static inline bool _solidAt(JamTileMap* tileMap, int x, int y) {
+	return x >= 0 && x < tileMap->width && y >= 0 && y < tileMap->height &&
+		   (tileMap->solid[y * tileMap->solidWords + x / 64] >> (x % 64)) & 1;
+}
+
+// Checks if any cell from colLo to colHi (inclusive) in a row is solid, a word at a time
+static bool _solidSpan(JamTileMap* tileMap, int row, int colLo, int colHi) {
+	uint64* bits;
+	uint64 mask;
+	int word, lastWord;
+
+	colLo = colLo < 0 ? 0 : colLo;
+	colHi = colHi >= (int)tileMap->width ? (int)tileMap->width - 1 : colHi;
+	if (row < 0 || row >= tileMap->height || colLo > colHi)
+		return false;
+
+	bits = tileMap->solid + row * tileMap->solidWords;
+	lastWord = colHi / 64;
+	for (word = colLo / 64; word <= lastWord; word++) {
+		mask = ~(uint64)0;
+		if (word == colLo / 64)
+			mask &= ~(uint64)0 << (colLo % 64);
+		if (word == lastWord)
+			mask &= ~(uint64)0 >> (63 - colHi % 64);
+		if (bits[word] & mask)
+			return true;
+	}
+
+	return false;
+}
+
+#if 64 % TILEMAP_CHUNK_SIZE != 0
+#error "TILEMAP_CHUNK_SIZE has to divide 64 so a row of a chunk is always inside one word"
+#endif
+
+// Gets the solid bits of one row of a chunk, bit 0 being the chunk's left-most column
+static inline uint64 _chunkRow(JamTileMap* tileMap, uint32 chunkX, uint32 row) {
+	uint32 col = chunkX * TILEMAP_CHUNK_SIZE;
+	return (tileMap->solid[row * tileMap->solidWords + col / 64] >> (col % 64)) & (~(uint64)0 >> (64 - TILEMAP_CHUNK_SIZE));
+}
+
+// Greedily merges the solid tiles in one chunk of a baked map into blocks
+static bool _bakeChunk(JamTileMap* tileMap, uint32 chunkX, uint32 chunkY) {
+	JamTileChunkRects* chunk = &tileMap->chunkRects[chunkY * tileMap->chunksAcross + chunkX];
+	uint64 rows[TILEMAP_CHUNK_SIZE];
+	uint64 run, rest;
+	JamTileRect* newRects;
+	uint32 i, rowCount, start, length, height;
+	bool worked = true;
+
+	rowCount = tileMap->height - chunkY * TILEMAP_CHUNK_SIZE < TILEMAP_CHUNK_SIZE ? tileMap->height - chunkY * TILEMAP_CHUNK_SIZE : TILEMAP_CHUNK_SIZE;
+	for (i = 0; i < rowCount; i++)
+		rows[i] = _chunkRow(tileMap, chunkX, chunkY * TILEMAP_CHUNK_SIZE + i);
+
+	// Take the first run of solid tiles in a row and grow it down while the rows below have all of it
+	chunk->count = 0;
+	for (i = 0; i < rowCount && worked; i++) {
+		while (rows[i] != 0 && worked) {
+			start = (uint32)__builtin_ctzll(rows[i]);
+			rest = ~(rows[i] >> start);
+			length = rest == 0 ? 64 - start : (uint32)__builtin_ctzll(rest);
+			run = (~(uint64)0 >> (64 - length)) << start;
+			rows[i] &= ~run;
+			for (height = 1; i + height < rowCount && (rows[i + height] & run) == run; height++)
+				rows[i + height] &= ~run;
+
+			if (chunk->count == chunk->capacity) {
+				newRects = (JamTileRect*)realloc(chunk->rects, sizeof(JamTileRect) * (chunk->capacity == 0 ? 4 : chunk->capacity * 2));
+				if (newRects != NULL) {
+					chunk->rects = newRects;
+					chunk->capacity = chunk->capacity == 0 ? 4 : chunk->capacity * 2;
+				} else {
+					worked = false;
+					jSetError(ERROR_REALLOC_FAILED, "Failed to reallocate chunk blocks (jamTileMapBake)");
+				}
+			}
+
+			if (worked) {
+				chunk->rects[chunk->count].x = chunkX * TILEMAP_CHUNK_SIZE + start;
+				chunk->rects[chunk->count].y = chunkY * TILEMAP_CHUNK_SIZE + i;
+				chunk->rects[chunk->count].w = length;
+				chunk->rects[chunk->count].h = height;
+				chunk->count++;
+			}
+		}
+	}
+
+	return worked;
+}
+
+// Makes either kind of tile map, indexed maps get a palette starting with the tile set's frames
+static JamTileMap* _createMap(uint32 width, uint32 height, uint32 cellWidth, uint32 cellHeight, bool indexed, JamSprite* tileSet) {
 	JamTileMap* map = (JamTileMap*)malloc(sizeof(JamTileMap));
+	uint32 i, frames = tileSet == NULL ? 0 : (tileSet->animationLength < UINT16_MAX ? tileSet->animationLength : UINT16_MAX);
 
 	// Check it worked
 	if (map != NULL) {
-		// Make the internal map
-		map->grid = (JamFrame**)calloc(sizeof(JamFrame*), width * height);
+		// Make the internal map and its solid bits (plus a word so empty maps still get something)
+		map->grid = indexed ? NULL : (JamFrame**)calloc(sizeof(JamFrame*), width * height);
+		map->tiles = indexed ? (uint16*)calloc(sizeof(uint16), (size_t)width * height + 1) : NULL;
+		map->paletteSize = indexed ? frames + 1 : 0;
+		map->paletteCapacity = indexed ? (frames + 1 < 16 ? 16 : frames + 1) : 0;
+		map->palette = indexed ? (JamFrame**)malloc(sizeof(JamFrame*) * map->paletteCapacity) : NULL;
+		if (map->palette != NULL) {
+			map->palette[0] = NULL;
+			for (i = 0; i < frames; i++)
+				map->palette[i + 1] = tileSet->frames[i];
+		}
+		map->solidWords = (width + 63) / 64;
+		map->solid = (uint64*)calloc((size_t)map->solidWords * height + 1, sizeof(uint64));
+
+		// Chunks start out with no texture and dirty so they get drawn the first time they're seen
+		map->chunksAcross = (width + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+		map->chunksDown = (height + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+		map->chunks = (JamTexture**)calloc((size_t)map->chunksAcross * map->chunksDown + 1, sizeof(JamTexture*));
+		map->chunksDirty = (bool*)malloc(sizeof(bool) * (map->chunksAcross * map->chunksDown + 1));
+		if (map->chunksDirty != NULL)
+			memset(map->chunksDirty, true, sizeof(bool) * (map->chunksAcross * map->chunksDown + 1));
 
 		// Check this one as well
-		if (map->grid != NULL) {
+		if ((indexed ? map->tiles != NULL && map->palette != NULL : map->grid != NULL) && map->solid != NULL &&
+			map->chunks != NULL && map->chunksDirty != NULL) {
 			// Load up the values
 			map->width = width;
 			map->height = height;
@@ -28,8 +207,17 @@ JamTileMap* jamTileMapCreate(uint32 width, uint32 height, uint32 cellWidth, uint
 			map->cellHeight = cellHeight;
 			map->xInWorld = 0;
 			map->yInWorld = 0;
+			map->chunkRects = NULL;
+			map->revision = 0;
 		} else {
+			free(map->grid);
+			free(map->tiles);
+			free(map->palette);
+			free(map->solid);
+			free(map->chunks);
+			free(map->chunksDirty);
 			free(map);
+			map = NULL;
 			jSetError(ERROR_ALLOC_FAILED, "Failed to allocate tile map's grid.");
 		}
 	} else {
@@ -38,21 +226,48 @@ JamTileMap* jamTileMapCreate(uint32 width, uint32 height, uint32 cellWidth, uint
 
 	return map;
 }
+
+//////////////////////////////////////////////////////////
+JamTileMap* jamTileMapCreate(uint32 width, uint32 height, uint32 cellWidth, uint32 cellHeight) {
+	return _createMap(width, height, cellWidth, cellHeight, false, NULL);
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+JamTileMap* jamTileMapCreateIndexed(uint32 width, uint32 height, uint32 cellWidth, uint32 cellHeight, JamSprite *tileSet) {
+	return _createMap(width, height, cellWidth, cellHeight, true, tileSet);
+}
 //////////////////////////////////////////////////////////
 
 //////////////////////////////////////////////////////////
 bool jamTileMapSet(JamTileMap *tileMap, uint32 x, uint32 y, JamFrame *val) {
 	bool worked = false;
+	uint16 index = 0;
+	bool solid;
 
 	// Make sure the map is here
-	if (tileMap != NULL && tileMap->grid != NULL) {
-		// Are we inside the grid
-		if (x >= 0 && x < tileMap->width && y >= 0 && y < tileMap->height) {
+	if (tileMap != NULL && _hasCells(tileMap)) {
+		// Are we inside the grid (and does an indexed map have room for the frame)
+		if (x >= 0 && x < tileMap->width && y >= 0 && y < tileMap->height &&
+			(tileMap->tiles == NULL || _paletteIndex(tileMap, val, &index))) {
 			// It did work
 			worked = true;
 
 			// Now set the value
-			tileMap->grid[y * tileMap->width + x] = val;
+			if (_jamTileMapCellAt(tileMap, y * tileMap->width + x) != val)
+				tileMap->chunksDirty[(y / TILEMAP_CHUNK_SIZE) * tileMap->chunksAcross + x / TILEMAP_CHUNK_SIZE] = true;
+			solid = _solidAt(tileMap, x, y);
+			if (tileMap->grid != NULL)
+				tileMap->grid[y * tileMap->width + x] = val;
+			else
+				tileMap->tiles[y * tileMap->width + x] = index;
+			_setSolid(tileMap, x, y, val != NULL);
+			if (solid != (val != NULL))
+				tileMap->revision++;
+
+			// Baked maps only need the one chunk's blocks redone
+			if (tileMap->chunkRects != NULL && solid != (val != NULL))
+				_bakeChunk(tileMap, x / TILEMAP_CHUNK_SIZE, y / TILEMAP_CHUNK_SIZE);
 		}
 	} else {
 		if (tileMap != NULL)
@@ -70,10 +285,10 @@ JamFrame* jamTileMapGet(JamTileMap *tileMap, uint32 x, uint32 y) {
 	JamFrame* val = 0;
 
 	// Make sure the map is here
-	if (tileMap != NULL && tileMap->grid != NULL) {
+	if (tileMap != NULL && _hasCells(tileMap)) {
 		// Now get the value if it is a real part of the grid
 		if (x >= 0 && x < tileMap->width && y >= 0 && y < tileMap->height)
-			val = tileMap->grid[y * tileMap->width + x];
+			val = _jamTileMapCellAt(tileMap, y * tileMap->width + x);
 	} else {
 		if (tileMap != NULL)
 			jSetError(ERROR_NULL_POINTER, "Map does not exist");
@@ -85,13 +300,36 @@ JamFrame* jamTileMapGet(JamTileMap *tileMap, uint32 x, uint32 y) {
 }
 //////////////////////////////////////////////////////////
 
+//////////////////////////////////////////////////////////
+void jamTileMapRefresh(JamTileMap *tileMap) {
+	uint32 i, j;
+
+	if (tileMap != NULL && _hasCells(tileMap)) {
+		memset(tileMap->solid, 0, sizeof(uint64) * tileMap->solidWords * tileMap->height);
+		for (i = 0; i < tileMap->height; i++)
+			for (j = 0; j < tileMap->width; j++)
+				if (_jamTileMapCellAt(tileMap, i * tileMap->width + j) != NULL)
+					_setSolid(tileMap, j, i, true);
+		memset(tileMap->chunksDirty, true, sizeof(bool) * tileMap->chunksAcross * tileMap->chunksDown);
+		tileMap->revision++;
+		if (tileMap->chunkRects != NULL)
+			jamTileMapBake(tileMap);
+	} else {
+		if (tileMap == NULL)
+			jSetError(ERROR_NULL_POINTER, "Map does not exist (jamTileMapRefresh)");
+		else
+			jSetError(ERROR_NULL_POINTER, "Map grid does not exist (jamTileMapRefresh)");
+	}
+}
+//////////////////////////////////////////////////////////
+
 //////////////////////////////////////////////////////////
 bool jamTileMapFastCollision(JamTileMap *tileMap, int x, int y, int w, int h) {
 	bool coll = false;
 	int x1, y1, x2, y2;
 
 	// Make sure the map is here
-	if (tileMap != NULL && tileMap->grid != NULL) {
+	if (tileMap != NULL && _hasCells(tileMap)) {
 		// First get all the values
 		x1 = (x / tileMap->cellWidth) - tileMap->xInWorld;
 		y1 = (y / tileMap->cellHeight) - tileMap->yInWorld;
@@ -101,10 +339,8 @@ bool jamTileMapFastCollision(JamTileMap *tileMap, int x, int y, int w, int h) {
 		// Now check for a collision by just checking each corner
 		if (x1 >= 0 && x1 < tileMap->width && y1 >= 0 && y1 < tileMap->height
 			&& x2 >= 0 && x2 < tileMap->width && y2 >= 0 && y2 < tileMap->height)
-			coll = ((tileMap->grid[y1 * tileMap->width + x1] != NULL) ||
-					(tileMap->grid[y1 * tileMap->width + x2] != NULL) ||
-					(tileMap->grid[y2 * tileMap->width + x1] != NULL) ||
-					(tileMap->grid[y2 * tileMap->width + x2] != NULL));
+			coll = _solidAt(tileMap, x1, y1) || _solidAt(tileMap, x2, y1) ||
+				   _solidAt(tileMap, x1, y2) || _solidAt(tileMap, x2, y2);
 	} else {
 		if (tileMap != NULL)
 			jSetError(ERROR_NULL_POINTER, "Map does not exist (jamTileMapFastCollision)");
@@ -118,55 +354,24 @@ bool jamTileMapFastCollision(JamTileMap *tileMap, int x, int y, int w, int h) {
 
 //////////////////////////////////////////////////////////
 bool jamTileMapCollision(JamTileMap *tileMap, int x, int y, int w, int h) {
-	// I have no idea why this is needed but it is so whatever
-	w--;
-	h--;
-
 	bool coll = false;
-	int i, j, xInRect, yInRect, xFactor, yFactor;
-	xInRect = x;
-	yInRect = y;
-	int verticesX[MAX_GRID_VERTICES];
-	int verticesY[MAX_GRID_VERTICES];
-	int currentVertex = 0;
-
-	if (tileMap != NULL && tileMap->grid != NULL) {
-		xFactor = (int)ceil((double)w / (double)tileMap->cellWidth) + 1;
-		yFactor = (int)ceil((double)h / (double)tileMap->cellHeight) + 1;
-
-		// We won't try collisions if this rectangle requires too many vertices
-		if (xFactor * yFactor < MAX_GRID_VERTICES) {
-			for (i = 0; i < yFactor; i++) {
-				for (j = 0; j < xFactor; j++) {
-					// Set the current vertex
-					verticesX[currentVertex] = (xInRect / tileMap->cellWidth) - tileMap->xInWorld;
-					verticesY[currentVertex] = (yInRect / tileMap->cellHeight) - tileMap->yInWorld;
-					currentVertex++;
-
-					// Calculate where to go from here
-					if (xInRect + tileMap->cellWidth > x + w)
-						xInRect = x + w;
-					else
-						xInRect += tileMap->cellWidth;
-				}
-				// Calculate where to go from here
-				xInRect = x;
-				if (yInRect + tileMap->cellHeight > y + h)
-					yInRect = y + h;
-				else
-					yInRect += tileMap->cellHeight;
-			}
+	int colLo, colHi, rowLo, rowHi, row;
 
-			// Actually check those vertices for a collision
-			for (i = 0; i < currentVertex && !coll; i++) {
-				// Make sure it's in bounds
-				if (verticesX[i] >= 0 && verticesX[i] < tileMap->width && verticesY[i] >= 0 && verticesY[i] < tileMap->height)
-					coll = tileMap->grid[verticesY[i] * tileMap->width + verticesX[i]] != NULL;
-			}
-		} else {
-			jSetError(ERROR_OUT_OF_BOUNDS, "Rectangle  [%i, %i, %i, %i] requires too many vertices (jamTileMapCollision)", x, y, w, h);
-		}
+	if (tileMap != NULL && _hasCells(tileMap)) {
+		// A rectangle with no size still checks the pixel at x/y
+		w = w < 1 ? 1 : w;
+		h = h < 1 ? 1 : h;
+
+		// The cells under the rectangle's first and last pixels
+		colLo = _floorDiv(x, tileMap->cellWidth) - tileMap->xInWorld;
+		colHi = _floorDiv(x + w - 1, tileMap->cellWidth) - tileMap->xInWorld;
+		rowLo = _floorDiv(y, tileMap->cellHeight) - tileMap->yInWorld;
+		rowHi = _floorDiv(y + h - 1, tileMap->cellHeight) - tileMap->yInWorld;
+		rowLo = rowLo < 0 ? 0 : rowLo;
+		rowHi = rowHi >= (int)tileMap->height ? (int)tileMap->height - 1 : rowHi;
 
+		for (row = rowLo; row <= rowHi && !coll; row++)
+			coll = _solidSpan(tileMap, row, colLo, colHi);
 	} else {
 		if (tileMap != NULL)
 			jSetError(ERROR_NULL_POINTER, "Map does not exist (jamTileMapCollision)");
@@ -178,145 +383,555 @@ bool jamTileMapCollision(JamTileMap *tileMap, int x, int y, int w, int h) {
 }
 //////////////////////////////////////////////////////////
 
+// Frame of a 48-frame auto-tile sprite to use for each arrangement of solid neighbours, where
+// the index has n, ne, e, se, s, sw, w, and nw as bits 0 through 7
+static const uint8 gAutoTileFrames[256] = {
+	44, 0, 44, 0, 1, 4, 1, 8, 44, 0, 44, 0, 1, 4, 1, 8,
+	2, 45, 2, 45, 5, 12, 5, 16, 2, 45, 2, 45, 9, 17, 9, 18,
+	44, 0, 44, 0, 1, 4, 1, 44, 44, 0, 44, 0, 1, 4, 1, 44,
+	2, 45, 2, 45, 5, 12, 5, 16, 2, 45, 2, 45, 9, 17, 9, 18,
+	3, 7, 3, 7, 46, 15, 46, 25, 3, 7, 3, 7, 46, 15, 46, 25,
+	6, 14, 6, 14, 13, 28, 13, 29, 6, 14, 6, 14, 19, 30, 19, 33,
+	3, 7, 3, 7, 46, 15, 46, 25, 3, 7, 3, 7, 46, 15, 46, 25,
+	10, 22, 10, 22, 20, 31, 20, 37, 10, 22, 10, 22, 21, 34, 21, 39,
+	44, 0, 44, 0, 1, 4, 1, 8, 44, 0, 44, 0, 1, 4, 1, 8,
+	2, 45, 2, 45, 5, 12, 5, 16, 2, 45, 2, 45, 9, 17, 9, 18,
+	44, 0, 44, 0, 1, 4, 1, 44, 44, 0, 44, 0, 1, 4, 1, 44,
+	2, 45, 2, 45, 5, 12, 5, 16, 2, 45, 2, 45, 9, 17, 9, 18,
+	3, 11, 3, 11, 46, 26, 46, 27, 3, 11, 3, 11, 46, 26, 46, 27,
+	6, 23, 6, 23, 13, 32, 13, 36, 6, 23, 6, 23, 19, 38, 19, 40,
+	3, 11, 3, 11, 46, 26, 46, 27, 3, 11, 3, 11, 46, 26, 46, 27,
+	10, 24, 10, 24, 44, 35, 44, 41, 10, 24, 10, 24, 21, 42, 21, 43
+};
+
+// Gets which of a cell's eight neighbours are solid as an index into gAutoTileFrames
+static inline uint8 _neighbourMask(JamTileMap* map, int x, int y) {
+	return (uint8)(_solidAt(map, x, y - 1) | _solidAt(map, x + 1, y - 1) << 1 | _solidAt(map, x + 1, y) << 2 |
+				   _solidAt(map, x + 1, y + 1) << 3 | _solidAt(map, x, y + 1) << 4 | _solidAt(map, x - 1, y + 1) << 5 |
+				   _solidAt(map, x - 1, y) << 6 | _solidAt(map, x - 1, y - 1) << 7);
+}
+
+// Picks the right frame for one cell if its solid (does not check the sprite), this
+// never touches the solid bits so other threads can read them at the same time
+static void _autoTileCell(JamTileMap* map, JamSprite* spr, const uint16* indices, int x, int y) {
+	uint32 cell = y * map->width + x;
+	uint8 frame;
+
+	if (_solidAt(map, x, y)) {
+		frame = gAutoTileFrames[_neighbourMask(map, x, y)];
+		if (_jamTileMapCellAt(map, cell) != spr->frames[frame]) {
+			if (map->grid != NULL)
+				map->grid[cell] = spr->frames[frame];
+			else
+				map->tiles[cell] = indices[frame];
+			map->chunksDirty[(y / TILEMAP_CHUNK_SIZE) * map->chunksAcross + x / TILEMAP_CHUNK_SIZE] = true;
+		}
+	}
+}
+
+// Puts every frame of an auto-tile sprite in an indexed map's palette ahead of time so threads never have to
+static bool _autoTileIndices(JamTileMap* map, JamSprite* spr, uint16* indices) {
+	bool worked = true;
+	int i;
+
+	for (i = 0; i < spr->animationLength && map->tiles != NULL && worked; i++)
+		worked = _paletteIndex(map, spr->frames[i], &indices[i]);
+
+	return worked;
+}
+
+// A band of rows for one thread to auto-tile
+typedef struct {
+	JamTileMap* map;
+	JamSprite* spr;
+	const uint16* indices;
+	uint32 rowStart;
+	uint32 rowEnd;
+} _JamAutoTileBand;
+
+// Auto-tiles every row in a band, this only changes frames and never what is solid so
+// bands can run at once as long as they don't share a chunk
+static void* _autoTileRows(void* voidBand) {
+	_JamAutoTileBand* band = (_JamAutoTileBand*)voidBand;
+	uint32 i, j;
+
+	for (i = band->rowStart; i < band->rowEnd; i++)
+		for (j = 0; j < band->map->width; j++)
+			_autoTileCell(band->map, band->spr, band->indices, (int)j, (int)i);
+
+	return NULL;
+}
+
 //////////////////////////////////////////////////////////////
 void jamTileMapAuto(JamTileMap *map, JamSprite *spr) {
-	uint32 i, j;
-	bool n, e, s, w, ne, nw, se, sw;
-	int frame;
+	_JamAutoTileBand bands[TILEMAP_AUTO_THREADS];
+	pthread_t threads[TILEMAP_AUTO_THREADS];
+	bool started[TILEMAP_AUTO_THREADS];
+	uint16 indices[48];
+	uint32 rowsPerBand;
+	int i, bandCount;
 
 	// First confirm the things exist
-	if (spr != NULL && map != NULL && (spr->animationLength == 48 || spr->animationLength == 47)) {
-
-		// We gotta run through every cell
-		for (i = 0; i < map->height; i++) {
-			for (j = 0; j < map->width; j++) {
-				if (jamTileMapGet(map, j, i) != NULL) {
-					// Where there are adjacent tiles
-					w = (jamTileMapGet(map, j - 1, i) != NULL);
-					e = (jamTileMapGet(map, j + 1, i) != NULL);
-					n = (jamTileMapGet(map, j, i - 1) != NULL);
-					s = (jamTileMapGet(map, j, i + 1) != NULL);
-					ne = (jamTileMapGet(map, j + 1, i - 1) != NULL);
-					nw = (jamTileMapGet(map, j - 1, i - 1) != NULL);
-					se = (jamTileMapGet(map, j + 1, i + 1) != NULL);
-					sw = (jamTileMapGet(map, j - 1, i + 1) != NULL);
-
-					// Calculate the tile
-					if (!w && !e && !s && n/* && !nw && !ne && !se && !sw*/) {
-						frame = 0;
-					} else if (!w && e && !s && !n/* && !nw && !ne && !se && !sw*/) {
-						frame = 1;
-					} else if (!w && !e && s && !n/* && !nw && !ne && !se && !sw*/) {
-						frame = 2;
-					} else if (w && !e && !s && !n/* && !nw && !ne && !se && !sw*/) {
-						frame = 3;
-					} else if (!w && e && !s && n && !ne) {
-						frame = 4;
-					} else if (!w && e && s && !n && !se) {
-						frame = 5;
-					} else if (w && !e && s && !n && !sw) {
-						frame = 6;
-					} else if (w && !e && !s && n && !nw) {
-						frame = 7;
-					} else if (!w && e && !s && n && ne && !sw) {
-						frame = 8;
-					} else if (!w && e && s && !n && se) {//(!w && e && s && !n && !nw && !ne && se && !sw) {
-						frame = 9;
-					} else if (w && !e && s && !n && sw) {
-						frame = 10;
-					} else if (w && !e && !s && n && nw) {
-						frame = 11;
-					} else if (!w && e && s && n && !ne && !se) {
-						frame = 12;
-					} else if (w && e && s && !n && !se && !sw) {
-						frame = 13;
-					} else if (w && !e && s && n && !nw && !sw) {
-						frame = 14;
-					} else if (w && e && !s && n && !nw && !ne) {
-						frame = 15;
-					} else if (!w && e && s && n && ne && !se) {
-						frame = 16;
-					} else if (!w && e && s && n && !ne && se) {
-						frame = 17;
-					} else if (!w && e && s && n && ne && se) {
-						frame = 18;
-					} else if (w && e && s && !n && se && !sw) {
-						frame = 19;
-					} else if (w && e && s && !n && !nw && !se) {
-						frame = 20;
-					} else if (w && e && s && !n && se && sw) {
-						frame = 21;
-					} else if (w && !e && s && n && !nw && sw) {
-						frame = 22;
-					} else if (w && !e && s && n && nw && !sw) {
-						frame = 23;
-					} else if (w && !e && s && n && nw && sw) {
-						frame = 24;
-					} else if (w && e && !s && n && !nw && ne) {
-						frame = 25;
-					} else if (w && e && !s && n && nw && !ne) {
-						frame = 26;
-					} else if (w && e && !s && n && nw && ne) {
-						frame = 27;
-					} else if (w && e && s && n && !nw && !ne && !se && !sw) {
-						frame = 28;
-					} else if (w && e && s && n && !nw && ne && !se && !sw) {
-						frame = 29;
-					} else if (w && e && s && n && !nw && !ne && se && !sw) {
-						frame = 30;
-					} else if (w && e && s && n && !nw && !ne && !se && sw) {
-						frame = 31;
-					} else if (w && e && s && n && nw && !ne && !se && !sw) {
-						frame = 32;
-					} else if (w && e && s && n && !nw && ne && se && !sw) {
-						frame = 33;
-					} else if (w && e && s && n && !nw && !ne && se && sw) {
-						frame = 34;
-					} else if (w && e && s && n && nw && !ne && !se && sw) {
-						frame = 35;
-					} else if (w && e && s && n && nw && ne && !se && !sw) {
-						frame = 36;
-					} else if (w && e && s && n && !nw && ne && !se && sw) {
-						frame = 37;
-					} else if (w && e && s && n && nw && !ne && se && !sw) {
-						frame = 38;
-					} else if (w && e && s && n && !nw && ne && se && sw) {
-						frame = 39;
-					} else if (w && e && s && n && nw && ne && se && !sw) {
-						frame = 40;
-					} else if (w && e && s && n && nw && ne && !se && sw) {
-						frame = 41;
-					} else if (w && e && s && n && nw && !ne && se && sw) {
-						frame = 42;
-					} else if (w && e && s && n && nw && ne && se && sw) {
-						frame = 43;
-					} else if (!w && !e && s && n/* && !nw && !ne && !se && !sw*/) {
-						frame = 45;
-					} else if (w && e && !s && !n/* && !nw && !ne && !se && !sw*/) {
-						frame = 46;
-					} else { // No blocks around
-						frame = 44;
-					}
+	if (spr != NULL && map != NULL && (spr->animationLength == 48 || spr->animationLength == 47) && _autoTileIndices(map, spr, indices)) {
+		// Big maps are split into bands of whole chunks so no two threads ever touch the same chunk
+		bandCount = 1;
+		rowsPerBand = map->height;
+		if ((uint64)map->width * map->height >= TILEMAP_AUTO_PARALLEL_CELLS) {
+			rowsPerBand = (map->height + TILEMAP_AUTO_THREADS - 1) / TILEMAP_AUTO_THREADS;
+			rowsPerBand = (rowsPerBand + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE * TILEMAP_CHUNK_SIZE;
+			bandCount = (int)((map->height + rowsPerBand - 1) / rowsPerBand);
+		}
 
-					jamTileMapSet(map, j, i, spr->frames[frame]);
-				}
-			}
+		for (i = 0; i < bandCount; i++) {
+			bands[i].map = map;
+			bands[i].spr = spr;
+			bands[i].indices = indices;
+			bands[i].rowStart = i * rowsPerBand;
+			bands[i].rowEnd = (i + 1) * rowsPerBand < map->height ? (i + 1) * rowsPerBand : map->height;
+			started[i] = i > 0 && pthread_create(&threads[i], NULL, _autoTileRows, &bands[i]) == 0;
 		}
+
+		// This thread takes the first band and any a thread couldn't be made for
+		for (i = 0; i < bandCount; i++)
+			if (!started[i])
+				_autoTileRows(&bands[i]);
+		for (i = 1; i < bandCount; i++)
+			if (started[i])
+				pthread_join(threads[i], NULL);
 	} else {
 		if (map == NULL)
-			jSetError(ERROR_NULL_POINTER, "Map doesn't exist (jamDrawSortedMap)");
+			jSetError(ERROR_NULL_POINTER, "Map doesn't exist (jamTileMapAuto)");
 		if (spr == NULL)
-			jSetError(ERROR_NULL_POINTER, "JamSprite doesn't exist (jamDrawSortedMap)");
+			jSetError(ERROR_NULL_POINTER, "JamSprite doesn't exist (jamTileMapAuto)");
 		else if (!(spr->animationLength == 48 || spr->animationLength == 47))
-			jSetError(ERROR_INCORRECT_FORMAT, "JamSprite does not contain 48 frames(jamDrawSortedMap)");
+			jSetError(ERROR_INCORRECT_FORMAT, "JamSprite does not contain 48 frames (jamTileMapAuto)");
 	}
 }
 //////////////////////////////////////////////////////////////
 
+//////////////////////////////////////////////////////////
+bool jamTileMapAutoSet(JamTileMap *map, JamSprite *spr, uint32 x, uint32 y, bool solid) {
+	bool worked = false;
+	uint16 indices[48];
+	int i, j;
+
+	if (spr != NULL && map != NULL && _hasCells(map) && (spr->animationLength == 48 || spr->animationLength == 47) &&
+		_autoTileIndices(map, spr, indices)) {
+		// Any frame marks it solid, the right one is picked with its neighbours after
+		worked = jamTileMapSet(map, x, y, solid ? spr->frames[0] : NULL);
+		if (worked)
+			for (i = (int)y - 1; i <= (int)y + 1; i++)
+				for (j = (int)x - 1; j <= (int)x + 1; j++)
+					_autoTileCell(map, spr, indices, j, i);
+	} else {
+		if (map == NULL || !_hasCells(map))
+			jSetError(ERROR_NULL_POINTER, "Map doesn't exist (jamTileMapAutoSet)");
+		if (spr == NULL)
+			jSetError(ERROR_NULL_POINTER, "JamSprite doesn't exist (jamTileMapAutoSet)");
+		else if (!(spr->animationLength == 48 || spr->animationLength == 47))
+			jSetError(ERROR_INCORRECT_FORMAT, "JamSprite does not contain 48 frames (jamTileMapAutoSet)");
+	}
+
+	return worked;
+}
+//////////////////////////////////////////////////////////
+
+// Small nudge used so a rectangle sitting exactly on a cell boundary isn't counted in the next cell
+#define SWEEP_EPSILON 0.000001
+
+// Checks if any cell in a range of world-cell coordinates is solid
+static bool _sweepSolid(JamTileMap* tileMap, int colLo, int colHi, int rowLo, int rowHi) {
+	int i;
+	for (i = rowLo - tileMap->yInWorld; i <= rowHi - tileMap->yInWorld; i++)
+		if (_solidSpan(tileMap, i, colLo - tileMap->xInWorld, colHi - tileMap->xInWorld))
+			return true;
+	return false;
+}
+
+//////////////////////////////////////////////////////////
+bool jamTileMapSweep(JamTileMap *tileMap, double x, double y, double w, double h, double dx, double dy, JamTileSweep *result) {
+	int stepX = dx > 0 ? 1 : (dx < 0 ? -1 : 0);
+	int stepY = dy > 0 ? 1 : (dy < 0 ? -1 : 0);
+	int colLo, colHi, rowLo, rowHi, nextCol, nextRow;
+	double cw, ch, t = 1, tx, ty, px, py;
+	double normalX = 0, normalY = 0;
+	bool hit = false;
+
+	if (tileMap != NULL && _hasCells(tileMap) && result != NULL) {
+		cw = tileMap->cellWidth;
+		ch = tileMap->cellHeight;
+
+		// The cells (in world cells, like jamTileMapCollision) the rectangle covers right now
+		colLo = (int)floor(x / cw);
+		colHi = (int)ceil((x + w) / cw) - 1;
+		rowLo = (int)floor(y / ch);
+		rowHi = (int)ceil((y + h) / ch) - 1;
+		nextCol = stepX > 0 ? colHi + 1 : colLo - 1;
+		nextRow = stepY > 0 ? rowHi + 1 : rowLo - 1;
+
+		// Step to whichever cell boundary the leading edges reach first until something solid shows up
+		while (!hit) {
+			tx = stepX > 0 ? (nextCol * cw - (x + w)) / dx : (stepX < 0 ? ((nextCol + 1) * cw - x) / dx : INFINITY);
+			ty = stepY > 0 ? (nextRow * ch - (y + h)) / dy : (stepY < 0 ? ((nextRow + 1) * ch - y) / dy : INFINITY);
+			if (tx >= 1 && ty >= 1)
+				break;
+
+			if (tx <= ty) {
+				// Entering a new column, the trailing edge may have left a row or two by now
+				py = y + dy * tx;
+				if (stepY > 0)
+					rowLo = (int)floor(py / ch + SWEEP_EPSILON);
+				else if (stepY < 0)
+					rowHi = (int)ceil((py + h) / ch - SWEEP_EPSILON) - 1;
+
+				if (_sweepSolid(tileMap, nextCol, nextCol, rowLo, rowHi)) {
+					hit = true;
+					t = tx;
+					normalX = -stepX;
+				} else {
+					colLo = stepX > 0 ? (int)floor((x + dx * tx) / cw + SWEEP_EPSILON) : nextCol;
+					colHi = stepX > 0 ? nextCol : (int)ceil((x + dx * tx + w) / cw - SWEEP_EPSILON) - 1;
+					nextCol += stepX;
+				}
+			} else {
+				// Entering a new row
+				px = x + dx * ty;
+				if (stepX > 0)
+					colLo = (int)floor(px / cw + SWEEP_EPSILON);
+				else if (stepX < 0)
+					colHi = (int)ceil((px + w) / cw - SWEEP_EPSILON) - 1;
+
+				if (_sweepSolid(tileMap, colLo, colHi, nextRow, nextRow)) {
+					hit = true;
+					t = ty;
+					normalY = -stepY;
+				} else {
+					rowLo = stepY > 0 ? (int)floor((y + dy * ty) / ch + SWEEP_EPSILON) : nextRow;
+					rowHi = stepY > 0 ? nextRow : (int)ceil((y + dy * ty + h) / ch - SWEEP_EPSILON) - 1;
+					nextRow += stepY;
+				}
+			}
+		}
+
+		result->hit = hit;
+		result->time = t;
+		result->normalX = normalX;
+		result->normalY = normalY;
+		result->x = x + dx * t;
+		result->y = y + dy * t;
+
+		// Put it exactly against the tile instead of wherever rounding left it
+		if (normalX != 0)
+			result->x = stepX > 0 ? nextCol * cw - w : (nextCol + 1) * cw;
+		if (normalY != 0)
+			result->y = stepY > 0 ? nextRow * ch - h : (nextRow + 1) * ch;
+	} else {
+		if (tileMap == NULL || !_hasCells(tileMap))
+			jSetError(ERROR_NULL_POINTER, "Map does not exist (jamTileMapSweep)");
+		if (result == NULL)
+			jSetError(ERROR_NULL_POINTER, "Result does not exist (jamTileMapSweep)");
+	}
+
+	return hit;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+bool jamTileMapBake(JamTileMap *tileMap) {
+	bool worked = false;
+	uint32 i, j;
+
+	if (tileMap != NULL && _hasCells(tileMap)) {
+		if (tileMap->chunkRects == NULL)
+			tileMap->chunkRects = (JamTileChunkRects*)calloc(tileMap->chunksAcross * tileMap->chunksDown + 1, sizeof(JamTileChunkRects));
+
+		if (tileMap->chunkRects != NULL) {
+			worked = true;
+			for (i = 0; i < tileMap->chunksDown; i++)
+				for (j = 0; j < tileMap->chunksAcross; j++)
+					worked = _bakeChunk(tileMap, j, i) && worked;
+		} else {
+			jSetError(ERROR_ALLOC_FAILED, "Failed to allocate chunk blocks (jamTileMapBake)");
+		}
+	} else {
+		if (tileMap == NULL)
+			jSetError(ERROR_NULL_POINTER, "Map does not exist (jamTileMapBake)");
+		else
+			jSetError(ERROR_NULL_POINTER, "Map grid does not exist (jamTileMapBake)");
+	}
+
+	return worked;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+bool jamTileMapCollisionRect(JamTileMap *tileMap, int x, int y, int w, int h, JamTileRect *rect) {
+	bool coll = false;
+	int colLo, colHi, rowLo, rowHi, i, j;
+	uint32 k;
+	JamTileChunkRects* chunk;
+	JamTileRect* block;
+
+	if (tileMap != NULL && _hasCells(tileMap) && rect != NULL) {
+		// The same cells jamTileMapCollision looks at, clipped to the map
+		w = w < 1 ? 1 : w;
+		h = h < 1 ? 1 : h;
+		colLo = _floorDiv(x, tileMap->cellWidth) - tileMap->xInWorld;
+		colHi = _floorDiv(x + w - 1, tileMap->cellWidth) - tileMap->xInWorld;
+		rowLo = _floorDiv(y, tileMap->cellHeight) - tileMap->yInWorld;
+		rowHi = _floorDiv(y + h - 1, tileMap->cellHeight) - tileMap->yInWorld;
+		colLo = colLo < 0 ? 0 : colLo;
+		rowLo = rowLo < 0 ? 0 : rowLo;
+		colHi = colHi >= (int)tileMap->width ? (int)tileMap->width - 1 : colHi;
+		rowHi = rowHi >= (int)tileMap->height ? (int)tileMap->height - 1 : rowHi;
+
+		if (tileMap->chunkRects != NULL) {
+			// Only the blocks in chunks under the rectangle could overlap it
+			for (i = rowLo / TILEMAP_CHUNK_SIZE; i <= rowHi / TILEMAP_CHUNK_SIZE && rowLo <= rowHi && !coll; i++) {
+				for (j = colLo / TILEMAP_CHUNK_SIZE; j <= colHi / TILEMAP_CHUNK_SIZE && colLo <= colHi && !coll; j++) {
+					chunk = &tileMap->chunkRects[i * tileMap->chunksAcross + j];
+					for (k = 0; k < chunk->count && !coll; k++) {
+						block = &chunk->rects[k];
+						if ((int)block->x <= colHi && (int)(block->x + block->w) > colLo &&
+							(int)block->y <= rowHi && (int)(block->y + block->h) > rowLo) {
+							*rect = *block;
+							coll = true;
+						}
+					}
+				}
+			}
+		} else {
+			for (i = rowLo; i <= rowHi && !coll; i++) {
+				if (_solidSpan(tileMap, i, colLo, colHi)) {
+					for (j = colLo; !_solidAt(tileMap, j, i); j++);
+					rect->x = (uint32)j;
+					rect->y = (uint32)i;
+					rect->w = 1;
+					rect->h = 1;
+					coll = true;
+				}
+			}
+		}
+	} else {
+		if (tileMap == NULL || !_hasCells(tileMap))
+			jSetError(ERROR_NULL_POINTER, "Map does not exist (jamTileMapCollisionRect)");
+		if (rect == NULL)
+			jSetError(ERROR_NULL_POINTER, "Rect does not exist (jamTileMapCollisionRect)");
+	}
+
+	return coll;
+}
+//////////////////////////////////////////////////////////
+
+// A ray in pixels from the map's top-left and the closest thing it has gone into so far
+typedef struct {
+	double x, y, dx, dy;
+	bool hit;
+	double time;
+	double normalX, normalY;
+} _JamTileRay;
+
+// Tests a ray against a box that, like cells, holds its left/top edges but not its right/bottom
+// ones, keeping it if the ray goes inside it before whatever the ray hit already
+static void _rayBox(_JamTileRay* ray, double x1, double y1, double x2, double y2) {
+	double enterX = -INFINITY, enterY = -INFINITY, exitX = INFINITY, exitY = INFINITY, enter, exit, t;
+
+	if (ray->dx != 0) {
+		enterX = (x1 - ray->x) / ray->dx;
+		exitX = (x2 - ray->x) / ray->dx;
+		if (enterX > exitX) {
+			t = enterX;
+			enterX = exitX;
+			exitX = t;
+		}
+	} else if (ray->x < x1 || ray->x >= x2) {
+		return;
+	}
+	if (ray->dy != 0) {
+		enterY = (y1 - ray->y) / ray->dy;
+		exitY = (y2 - ray->y) / ray->dy;
+		if (enterY > exitY) {
+			t = enterY;
+			enterY = exitY;
+			exitY = t;
+		}
+	} else if (ray->y < y1 || ray->y >= y2) {
+		return;
+	}
+
+	// It has to spend some time inside the box, just touching an edge or corner doesn't count
+	enter = fmax(0, fmax(enterX, enterY));
+	exit = fmin(1, fmin(exitX, exitY));
+	if (enter < exit && (!ray->hit || enter < ray->time)) {
+		ray->hit = true;
+		ray->time = enter;
+		ray->normalX = enterX >= 0 && enterX >= enterY ? (ray->dx > 0 ? -1 : 1) : 0;
+		ray->normalY = enterY >= 0 && enterY > enterX ? (ray->dy > 0 ? -1 : 1) : 0;
+	}
+}
+
+// Tests a ray against a single cell of the map
+static void _rayTile(JamTileMap* tileMap, int col, int row, _JamTileRay* ray) {
+	if (_solidAt(tileMap, col, row))
+		_rayBox(ray, (double)col * tileMap->cellWidth, (double)row * tileMap->cellHeight,
+				(double)(col + 1) * tileMap->cellWidth, (double)(row + 1) * tileMap->cellHeight);
+}
+
+// Tests a ray against every block in a chunk of a baked map
+static void _rayChunk(JamTileMap* tileMap, int chunkX, int chunkY, _JamTileRay* ray) {
+	JamTileChunkRects* chunk = &tileMap->chunkRects[chunkY * tileMap->chunksAcross + chunkX];
+	JamTileRect* block;
+	uint32 i;
+
+	for (i = 0; i < chunk->count; i++) {
+		block = &chunk->rects[i];
+		_rayBox(ray, (double)block->x * tileMap->cellWidth, (double)block->y * tileMap->cellHeight,
+				(double)(block->x + block->w) * tileMap->cellWidth, (double)(block->y + block->h) * tileMap->cellHeight);
+	}
+}
+
+// Walks a ray through a grid of cols by rows cells (cells or chunks) in the order it reaches them,
+// testing each until one of them is hit
+static void _walkRay(JamTileMap* tileMap, double cellW, double cellH, int cols, int rows, _JamTileRay* ray,
+					 void (*test)(JamTileMap*, int, int, _JamTileRay*)) {
+	int stepX = ray->dx > 0 ? 1 : (ray->dx < 0 ? -1 : 0);
+	int stepY = ray->dy > 0 ? 1 : (ray->dy < 0 ? -1 : 0);
+	double start = 0, end = 1, t1, t2, nextX, nextY;
+	int col, row;
+
+	// Cut the ray down to the part that is over the grid
+	if (ray->dx != 0) {
+		t1 = (0 - ray->x) / ray->dx;
+		t2 = (cols * cellW - ray->x) / ray->dx;
+		start = fmax(start, fmin(t1, t2));
+		end = fmin(end, fmax(t1, t2));
+	} else if (ray->x < 0 || ray->x > cols * cellW) {
+		return;
+	}
+	if (ray->dy != 0) {
+		t1 = (0 - ray->y) / ray->dy;
+		t2 = (rows * cellH - ray->y) / ray->dy;
+		start = fmax(start, fmin(t1, t2));
+		end = fmin(end, fmax(t1, t2));
+	} else if (ray->y < 0 || ray->y > rows * cellH) {
+		return;
+	}
+	if (start > end || cols <= 0 || rows <= 0)
+		return;
+
+	col = (int)floor((ray->x + ray->dx * start) / cellW);
+	row = (int)floor((ray->y + ray->dy * start) / cellH);
+	col = col < 0 ? 0 : (col >= cols ? cols - 1 : col);
+	row = row < 0 ? 0 : (row >= rows ? rows - 1 : row);
+
+	while (col >= 0 && col < cols && row >= 0 && row < rows) {
+		test(tileMap, col, row, ray);
+		if (ray->hit)
+			break;
+
+		// Over to whichever cell the ray reaches next
+		nextX = stepX > 0 ? ((col + 1) * cellW - ray->x) / ray->dx : (stepX < 0 ? (col * cellW - ray->x) / ray->dx : INFINITY);
+		nextY = stepY > 0 ? ((row + 1) * cellH - ray->y) / ray->dy : (stepY < 0 ? (row * cellH - ray->y) / ray->dy : INFINITY);
+		if (fmin(nextX, nextY) >= end)
+			break;
+		if (nextX <= nextY)
+			col += stepX;
+		else
+			row += stepY;
+	}
+}
+
+//////////////////////////////////////////////////////////
+bool jamTileMapRaycast(JamTileMap *tileMap, double x, double y, double dx, double dy, JamTileSweep *result) {
+	_JamTileRay ray;
+
+	if (tileMap != NULL && _hasCells(tileMap) && result != NULL) {
+		ray.x = x - (double)tileMap->xInWorld * tileMap->cellWidth;
+		ray.y = y - (double)tileMap->yInWorld * tileMap->cellHeight;
+		ray.dx = dx;
+		ray.dy = dy;
+		ray.hit = false;
+		ray.time = 1;
+		ray.normalX = 0;
+		ray.normalY = 0;
+
+		if (tileMap->chunkRects != NULL)
+			_walkRay(tileMap, (double)tileMap->cellWidth * TILEMAP_CHUNK_SIZE, (double)tileMap->cellHeight * TILEMAP_CHUNK_SIZE,
+					 (int)tileMap->chunksAcross, (int)tileMap->chunksDown, &ray, _rayChunk);
+		else
+			_walkRay(tileMap, tileMap->cellWidth, tileMap->cellHeight, (int)tileMap->width, (int)tileMap->height, &ray, _rayTile);
+
+		result->hit = ray.hit;
+		result->time = ray.time;
+		result->normalX = ray.normalX;
+		result->normalY = ray.normalY;
+		result->x = x + dx * ray.time;
+		result->y = y + dy * ray.time;
+	} else {
+		if (tileMap == NULL || !_hasCells(tileMap))
+			jSetError(ERROR_NULL_POINTER, "Map does not exist (jamTileMapRaycast)");
+		if (result == NULL)
+			jSetError(ERROR_NULL_POINTER, "Result does not exist (jamTileMapRaycast)");
+	}
+
+	return result != NULL && result->hit;
+}
+//////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////
+bool jamTileMapLineOfSight(JamTileMap *tileMap, int x1, int y1, int x2, int y2) {
+	int dx, dy, stepY, err, twiceErr, swap;
+
+	if (tileMap != NULL && _hasCells(tileMap)) {
+		// Always walk left to right (then top to bottom) so the line is the same both ways
+		if (x1 > x2 || (x1 == x2 && y1 > y2)) {
+			swap = x1; x1 = x2; x2 = swap;
+			swap = y1; y1 = y2; y2 = swap;
+		}
+		dx = x2 - x1;
+		dy = -abs(y2 - y1);
+		stepY = y1 < y2 ? 1 : -1;
+		err = dx + dy;
+
+		while (x1 != x2 || y1 != y2) {
+			twiceErr = 2 * err;
+			if (twiceErr >= dy) {
+				err += dy;
+				x1++;
+			}
+			if (twiceErr <= dx) {
+				err += dx;
+				y1 += stepY;
+			}
+			if ((x1 != x2 || y1 != y2) && _solidAt(tileMap, x1, y1))
+				return false;
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "Map does not exist (jamTileMapLineOfSight)");
+		return false;
+	}
+
+	return true;
+}
+//////////////////////////////////////////////////////////
+
 //////////////////////////////////////////////////////////
 void jamTileMapFree(JamTileMap *tileMap) {
+	uint32 i;
+
 	if (tileMap != NULL) {
+		for (i = 0; i < tileMap->chunksAcross * tileMap->chunksDown; i++) {
+			jamTextureFree(tileMap->chunks[i]);
+			if (tileMap->chunkRects != NULL)
+				free(tileMap->chunkRects[i].rects);
+		}
+		free(tileMap->chunkRects);
 		free(tileMap->grid);
+		free(tileMap->tiles);
+		free(tileMap->palette);
+		free(tileMap->solid);
+		free(tileMap->chunks);
+		free(tileMap->chunksDirty);
 		free(tileMap);
 	}
 }
@@ -12,6 +12,55 @@
 #include "File.h"
 #include <string.h>
 
+// Polygons that were never cached have their normals worked out here for each check instead,
+// with room for two so two of them can be checked against each other
+static _Thread_local double* tScratchNormals[2];
+static _Thread_local unsigned int tScratchVertices[2];
+
+// Works out a polygon's normals, bounds, and circle, its normal arrays must already have room for every vertex
+static void _polygonCalculate(JamPolygon* poly) {
+	double area = 0;
+	double length, dx, dy, dist;
+	unsigned int i, next;
+
+	poly->boundsX1 = poly->boundsX2 = poly->xVerts[0];
+	poly->boundsY1 = poly->boundsY2 = poly->yVerts[0];
+
+	// Bounding box and the winding, so the normals can be made to point outwards either way
+	for (i = 0; i < poly->vertices; i++) {
+		next = (i + 1) % poly->vertices;
+		area += poly->xVerts[i] * poly->yVerts[next] - poly->xVerts[next] * poly->yVerts[i];
+		poly->boundsX1 = poly->xVerts[i] < poly->boundsX1 ? poly->xVerts[i] : poly->boundsX1;
+		poly->boundsY1 = poly->yVerts[i] < poly->boundsY1 ? poly->yVerts[i] : poly->boundsY1;
+		poly->boundsX2 = poly->xVerts[i] > poly->boundsX2 ? poly->xVerts[i] : poly->boundsX2;
+		poly->boundsY2 = poly->yVerts[i] > poly->boundsY2 ? poly->yVerts[i] : poly->boundsY2;
+	}
+
+	// Edge normals (a zero-length edge just gets a zero normal, which never separates anything)
+	for (i = 0; i < poly->vertices; i++) {
+		next = (i + 1) % poly->vertices;
+		dx = poly->xVerts[next] - poly->xVerts[i];
+		dy = poly->yVerts[next] - poly->yVerts[i];
+		length = sqrt(dx * dx + dy * dy);
+		if (length > 0) {
+			poly->xNormals[i] = (area >= 0 ? dy : -dy) / length;
+			poly->yNormals[i] = (area >= 0 ? -dx : dx) / length;
+		} else {
+			poly->xNormals[i] = 0;
+			poly->yNormals[i] = 0;
+		}
+	}
+
+	// Bounding circle around the middle of the box
+	poly->centreX = (poly->boundsX1 + poly->boundsX2) / 2;
+	poly->centreY = (poly->boundsY1 + poly->boundsY2) / 2;
+	poly->radius = 0;
+	for (i = 0; i < poly->vertices; i++) {
+		dist = pointDistance(poly->centreX, poly->centreY, poly->xVerts[i], poly->yVerts[i]);
+		poly->radius = dist > poly->radius ? dist : poly->radius;
+	}
+}
+
 //////////////////////////////////////////////////
 JamPolygon* jamPolygonCreate(unsigned int vertices) {
 	JamPolygon* poly = (JamPolygon*)malloc(sizeof(JamPolygon));
@@ -20,6 +69,9 @@ JamPolygon* jamPolygonCreate(unsigned int vertices) {
 		poly->xVerts = (double*)malloc(sizeof(double) * vertices);
 		poly->yVerts = (double*)malloc(sizeof(double) * vertices);
 		poly->vertices = vertices;
+		poly->xNormals = NULL;
+		poly->yNormals = NULL;
+		poly->cached = false;
 	} else {
 		jSetError(ERROR_ALLOC_FAILED, "Memory could not be allocated.");
 		free(poly);
@@ -76,6 +128,7 @@ void jamPolygonAddVertex(JamPolygon *poly, double x, double y) {
 			poly->vertices++;
 			poly->xVerts = xVerts;
 			poly->yVerts = yVerts;
+			jamPolygonRecalculate(poly);
 		} else {
 			jSetError(ERROR_REALLOC_FAILED, "Failed to reallocate vertex arrays.");
 		}
@@ -85,11 +138,67 @@ void jamPolygonAddVertex(JamPolygon *poly, double x, double y) {
 }
 //////////////////////////////////////////////////
 
+//////////////////////////////////////////////////
+void jamPolygonRecalculate(JamPolygon *poly) {
+	double* xNormals;
+	double* yNormals;
+
+	if (poly != NULL && poly->vertices > 0) {
+		xNormals = (double*)realloc(poly->xNormals, sizeof(double) * poly->vertices);
+		yNormals = (double*)realloc(poly->yNormals, sizeof(double) * poly->vertices);
+
+		if (xNormals != NULL && yNormals != NULL) {
+			poly->xNormals = xNormals;
+			poly->yNormals = yNormals;
+			_polygonCalculate(poly);
+			poly->cached = true;
+		} else {
+			if (xNormals != NULL)
+				poly->xNormals = xNormals;
+			if (yNormals != NULL)
+				poly->yNormals = yNormals;
+			jSetError(ERROR_REALLOC_FAILED, "Failed to reallocate normal arrays (jamPolygonRecalculate)");
+		}
+	} else if (poly == NULL) {
+		jSetError(ERROR_NULL_POINTER, "JamPolygon does not exist (jamPolygonRecalculate)");
+	}
+}
+//////////////////////////////////////////////////
+
+//////////////////////////////////////////////////
+JamPolygon* _jamPolygonPrepare(JamPolygon *poly, JamPolygon *scratch, int slot) {
+	double* normals;
+
+	if (poly->cached || poly->vertices == 0)
+		return poly;
+
+	if (tScratchVertices[slot] < poly->vertices) {
+		normals = (double*)realloc(tScratchNormals[slot], sizeof(double) * 2 * poly->vertices);
+		if (normals == NULL) {
+			jSetError(ERROR_REALLOC_FAILED, "Failed to reallocate scratch normals (_jamPolygonPrepare)");
+			return NULL;
+		}
+		tScratchNormals[slot] = normals;
+		tScratchVertices[slot] = poly->vertices;
+	}
+
+	// The scratch polygon shares the vertices and only gets its own normals
+	*scratch = *poly;
+	scratch->xNormals = tScratchNormals[slot];
+	scratch->yNormals = tScratchNormals[slot] + poly->vertices;
+	_polygonCalculate(scratch);
+	scratch->cached = true;
+	return scratch;
+}
+//////////////////////////////////////////////////
+
 //////////////////////////////////////////////////
 void jamPolygonFree(JamPolygon *poly) {
 	if (poly != NULL) {
 		free(poly->xVerts);
 		free(poly->yVerts);
+		free(poly->xNormals);
+		free(poly->yNormals);
 		free(poly);
 	}
 }
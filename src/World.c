@@ -3,13 +3,18 @@
 //
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <malloc.h>
+#include <string.h>
+#include <math.h>
 #include <World.h>
 #include <Entity.h>
 #include <Vector.h>
 #include <EntityList.h>
 #include <Sprite.h>
 #include <BehaviourMap.h>
+#include <Component.h>
+#include <Message.h>
 #include <JamEngine.h>
 #include "JamError.h"
 
@@ -24,6 +29,71 @@ static bool gThreadComplete;
  * is a very quick way to get segfaults/memory leaks/thread leaks)
  */
 
+/// \brief Sets the box of one slot in a cell
+///
+/// The box is rounded outwards so the floats never miss something the doubles would catch.
+static inline void _setCellBox(JamWorldCellBoxes* cell, uint32 slot, double x1, double y1, double x2, double y2) {
+	float* chunk = cell->boxes + (slot / COLLISION_BATCH_SIZE) * COLLISION_BATCH_SIZE * 4;
+	uint32 k = slot % COLLISION_BATCH_SIZE;
+
+	chunk[k] = nextafterf((float)x1, -INFINITY);
+	chunk[COLLISION_BATCH_SIZE + k] = nextafterf((float)y1, -INFINITY);
+	chunk[COLLISION_BATCH_SIZE * 2 + k] = nextafterf((float)x2, INFINITY);
+	chunk[COLLISION_BATCH_SIZE * 3 + k] = nextafterf((float)y2, INFINITY);
+}
+
+/// \brief Makes sure a cell has boxes for at least count slots, returns false if it can't
+static bool _reserveCellBoxes(JamWorldCellBoxes* cell, uint32 count) {
+	uint32 newCapacity, i;
+	float* newBoxes;
+
+	if (count <= cell->capacity)
+		return true;
+
+	newCapacity = ((count + COLLISION_BATCH_SIZE - 1) / COLLISION_BATCH_SIZE) * COLLISION_BATCH_SIZE;
+	newBoxes = (float*)realloc(cell->boxes, newCapacity * 4 * sizeof(float));
+	if (newBoxes == NULL)
+		return false;
+
+	// New chunks are tacked on the end, so the old slots stay where they were
+	cell->boxes = newBoxes;
+	for (i = cell->capacity; i < newCapacity; i++)
+		_setCellBox(cell, i, INFINITY, INFINITY, -INFINITY, -INFINITY);
+	cell->capacity = newCapacity;
+	return true;
+}
+
+/// \brief Writes an entity's current hitbox bounds into every cell it is in
+static void _storeEntBoxes(JamWorld* world, JamEntity* ent) {
+	double x1, y1, x2, y2;
+	int i;
+
+	_jamEntityHitboxBounds(ent, ent->x, ent->y, &x1, &y1, &x2, &y2);
+	for (i = 0; i < ent->cells; i++) {
+		if (_reserveCellBoxes(&world->cellBoxes[ent->cellsIn[i]], (uint32)ent->cellsLoc[i] + 1))
+			_setCellBox(&world->cellBoxes[ent->cellsIn[i]], (uint32)ent->cellsLoc[i], x1, y1, x2, y2);
+		else
+			jSetError(ERROR_REALLOC_FAILED, "Failed to grow a cell's boxes, collisions in it may be missed");
+	}
+}
+
+/// \brief Takes an entity out of one slot of a cell, leaving a box that overlaps nothing
+static inline void _clearCellSlot(JamWorld* world, int cell, int slot) {
+	world->entityGrid[cell]->entities[slot] = NULL;
+	if ((uint32)slot < world->cellBoxes[cell].capacity)
+		_setCellBox(&world->cellBoxes[cell], (uint32)slot, INFINITY, INFINITY, -INFINITY, -INFINITY);
+}
+
+/// \brief Frees every cell's boxes in a grid of cellCount cells
+static void _freeCellBoxes(JamWorldCellBoxes* cellBoxes, int cellCount) {
+	int i;
+
+	if (cellBoxes != NULL)
+		for (i = 0; i < cellCount; i++)
+			free(cellBoxes[i].boxes);
+	free(cellBoxes);
+}
+
 /// \brief Places an entity into all non-duplicate cells in the space map
 static void _refreshGridPos(JamWorld* world, JamEntity* ent, int a, int b, int c, int d) {
 	int nums[] = {a, b, c, d};
@@ -51,6 +121,8 @@ static void _refreshGridPos(JamWorld* world, JamEntity* ent, int a, int b, int c
 			ent->cellsLoc[uniqueAccumulator] = jamEntityListAdd(world->entityGrid[nums[i]], ent);
 		}
 	}
+
+	_storeEntBoxes(world, ent);
 }
 
 /// \brief Calculates an in-grid position from a real x value
@@ -82,45 +154,135 @@ static int _gridPosFromCoords(JamWorld* world, double x, double y) {
 		return (yInGrid * world->gridWidth) + xInGrid;
 }
 
+/// \brief Drops an entity into the cells its corners are in without checking where it was before
+///
+/// For worlds using the AABB tree, the entity's leaf is added or moved instead.
+static void _placeEntInMap(JamWorld* world, JamEntity* ent) {
+	double x1, y1, x2, y2;
+	int topLeft, topRight, bottomLeft, bottomRight;
+
+	// Find the entity's corners then drop them into the grid
+	x1 = jamEntityVisibleX1(ent, ent->x);
+	y1 = jamEntityVisibleY1(ent, ent->y);
+	x2 = jamEntityVisibleX2(ent, ent->x);
+	y2 = jamEntityVisibleY2(ent, ent->y);
+	ent->placed[0] = x1;
+	ent->placed[1] = y1;
+	ent->placed[2] = x2;
+	ent->placed[3] = y2;
+
+	if (world->broadphase == bp_AABBTree) {
+		// The caching thread may be walking the tree, and moving a leaf can rotate nodes under it
+		pthread_mutex_lock(&world->entityTreeLock);
+		if (ent->treeProxy == AABB_TREE_NULL)
+			ent->treeProxy = jamAABBTreeInsert(world->entityTree, ent, x1, y1, x2, y2);
+		else
+			jamAABBTreeMove(world->entityTree, ent->treeProxy, x1, y1, x2, y2);
+		pthread_mutex_unlock(&world->entityTreeLock);
+		return;
+	}
+
+	topLeft = _gridPosFromCoords(world, x1, y1);
+	topRight = _gridPosFromCoords(world, x2, y1);
+	bottomLeft = _gridPosFromCoords(world, x1, y2);
+	bottomRight = _gridPosFromCoords(world, x2, y2);
+
+	// Place the entity into the appropriate cells and update the entity's world-related values
+	_refreshGridPos(world, ent, topLeft, topRight, bottomLeft, bottomRight);
+}
+
+/// \brief Takes an entity out of the spatial map or tree entirely
+static void _removeEntFromMap(JamWorld* world, JamEntity* ent) {
+	int i;
+
+	for (i = 0; i < ent->cells; i++)
+		_clearCellSlot(world, ent->cellsIn[i], ent->cellsLoc[i]);
+	ent->cells = 0;
+
+	if (ent->treeProxy != AABB_TREE_NULL) {
+		pthread_mutex_lock(&world->entityTreeLock);
+		jamAABBTreeRemove(world->entityTree, ent->treeProxy);
+		pthread_mutex_unlock(&world->entityTreeLock);
+		ent->treeProxy = AABB_TREE_NULL;
+	}
+}
+
+/// \brief Tacks an entity onto the end of a list without looking for holes (the list must have none)
+static bool _appendToList(void* ent, void* voidList) {
+	JamEntityList* list = voidList;
+	JamEntity** newEntities;
+	uint32 newCapacity;
+
+	if (list->size == list->capacity) {
+		newCapacity = list->capacity < ENTITY_LIST_ALLOCATION_AMOUNT ? ENTITY_LIST_ALLOCATION_AMOUNT : list->capacity * 2;
+		newEntities = (JamEntity**)realloc(list->entities, newCapacity * sizeof(JamEntity*));
+		if (newEntities == NULL) {
+			jSetError(ERROR_REALLOC_FAILED, "Failed to grow in-range list");
+			return false;
+		}
+		list->entities = newEntities;
+		list->capacity = newCapacity;
+	}
+
+	list->entities[list->size++] = ent;
+	return true;
+}
+
+/// \brief Puts every entity in a world's tree that is within procDistance of the camera into a list
+static void _queryTreeInRange(JamWorld* world, JamEntityList* list) {
+	jamAABBTreeQuery(
+			world->entityTree,
+			jamRendererGetCameraX() - world->procDistance,
+			jamRendererGetCameraY() - world->procDistance,
+			jamRendererGetCameraX() + jamRendererGetBufferWidth() + world->procDistance,
+			jamRendererGetCameraY() + jamRendererGetBufferHeight() + world->procDistance,
+			_appendToList,
+			list
+	);
+}
+
+/// \brief Frees an entity that was marked to be destroyed, taking it out of everything in the world
+static void _deleteEntity(JamWorld* world, JamEntity* ent) {
+	_removeEntFromMap(world, ent);
+	world->worldEntities->entities[ent->id] = NULL;
+	_jamComponentDetach(world, ent);
+	_jamContactCacheForget(world, ent);
+	jamEntityFree(ent, false, false, false);
+}
+
 /// \brief Updates an entity's position in a world's spatial map
 ///
-/// If the entity is already in the world and its position has
+/// If the entity is already in the world and the box it takes up has
 /// changed, it will be removed from its old position and stuck
 /// into its new one. Otherwise, it is simply added to its position
 /// in the map.
 static void _updateEntInMap(JamWorld* world, JamEntity* ent) {
-	// Grab the corners of the entity then calculate its corners' positions
-	// in the spatial map
-	double x1, y1, x2, y2;
-	int topLeft, topRight, bottomLeft, bottomRight;
 	int i;
 
+	// Collision checks only read the rotated hitbox and pixel masks, so they're rebuilt here on the updating thread
+	jamEntityUpdateHitbox(ent);
+
 	// We only need to process this entity if it is either A) Not already in the world or
-	// B) its position has changed.
-	if (ent->id == ID_NOT_ASSIGNED || ent->xPrev != ent->x || ent->yPrev != ent->y) {
+	// B) its box has changed (it moved, or was rotated, scaled, or given another sprite).
+	if (ent->id == ID_NOT_ASSIGNED || ent->placed[0] != jamEntityVisibleX1(ent, ent->x) || ent->placed[1] != jamEntityVisibleY1(ent, ent->y) ||
+		ent->placed[2] != jamEntityVisibleX2(ent, ent->x) || ent->placed[3] != jamEntityVisibleY2(ent, ent->y)) {
 		// If its not in the world, add it and potentially call its initialization function
 		if (ent->id == ID_NOT_ASSIGNED) {
 			ent->id = jamEntityListAdd(world->worldEntities, ent);
+			ent->generation = ++world->generations;
+			_jamComponentAttach(world, ent);
 
 			if (ent->behaviour != NULL && ent->behaviour->onCreation != NULL)
 				(*ent->behaviour->onCreation)(world, ent);
 		}
 		else // Otherwise, remove it from its old locations
 			for (i = 0; i < ent->cells; i++)
-				world->entityGrid[ent->cellsIn[i]]->entities[ent->cellsLoc[i]] = NULL;
+				_clearCellSlot(world, ent->cellsIn[i], ent->cellsLoc[i]);
 
-		// Find the entity's corners then drop them into the grid
-		x1 = jamEntityVisibleX1(ent, ent->x);
-		y1 = jamEntityVisibleY1(ent, ent->y);
-		x2 = jamEntityVisibleX2(ent, ent->x);
-		y2 = jamEntityVisibleY2(ent, ent->y);
-		topLeft = _gridPosFromCoords(world, x1, y1);
-		topRight = _gridPosFromCoords(world, x2, y1);
-		bottomLeft = _gridPosFromCoords(world, x1, y2);
-		bottomRight = _gridPosFromCoords(world, x2, y2);
-
-		// Place the entity into the appropriate cells and update the entity's world-related values
-		_refreshGridPos(world, ent, topLeft, topRight, bottomLeft, bottomRight);
+		_placeEntInMap(world, ent);
+	} else if (ent->cells > 0) {
+		// Its hitbox may still have changed without the visible box changing
+		_storeEntBoxes(world, ent);
 	}
 }
 
@@ -158,6 +320,30 @@ static void _drawEntity(JamWorld* world, JamEntity* ent) {
 	}
 }
 
+/// \brief Takes everything out of the spawn queue and adds it to the world, entityAddingLock must be held
+static void _addSpawnedEntities(JamWorld* world) {
+	JamEntity* queue = __atomic_exchange_n(&world->spawnQueue, NULL, __ATOMIC_ACQUIRE);
+	JamEntity* ordered = NULL;
+	JamEntity* next;
+
+	// The queue is newest first, so flip it to add entities in the order they were spawned
+	while (queue != NULL) {
+		next = queue->spawnNext;
+		queue->spawnNext = ordered;
+		ordered = queue;
+		queue = next;
+	}
+
+	while (ordered != NULL) {
+		next = ordered->spawnNext;
+		ordered->spawnNext = NULL;
+		_updateEntInMap(world, ordered);
+		if (world->cacheInRangeEntities)
+			jamEntityListAdd(world->inRangeCache, ordered);
+		ordered = next;
+	}
+}
+
 /// \brief Filters the entities in the space map into a new filtered cache.
 ///
 /// Here is a not-so-brief rundown on whats cooking in this function.
@@ -184,27 +370,38 @@ static void* _filterEntitiesIntoCache(void* voidWorld) {
 	
 	pthread_mutex_lock(&world->entityAddingLock);
 
-	cellStartX = _gridPosFromRealX(world, jamRendererGetCameraX() - world->procDistance);
-	cellStartY = _gridPosFromRealY(world, jamRendererGetCameraY() - world->procDistance);
-	cellEndX = _gridPosFromRealX(world, jamRendererGetCameraX() + jamRendererGetBufferWidth() + world->procDistance);
-	cellEndY = _gridPosFromRealY(world, jamRendererGetCameraY() + jamRendererGetBufferHeight() + world->procDistance);
-
-	for (i = cellStartY; i <= cellEndY; i++) {
-		for (j = cellStartX; j <= cellEndX; j++) {
-			currentList = _getListAtPos(world, j, i);
-
-			// Call this one's frame update
-			for (k = 0; k < currentList->size; k++) {
-				if (currentList->entities[k] != NULL) {
-					exists = false;
-
-					// Make sure this isn't in the list
-					for (l = 0; l < newList->size; l++)
-						if (currentList->entities[k] == newList->entities[l])
-							exists = true;
-
-					if (!exists)
-						jamEntityListAdd(newList, currentList->entities[k]);
+	// The tree never holds an entity twice, so there is nothing to filter out. Entities are
+	// moved in the tree while the cache is locked by jamWorldProcFrame, so the tree gets its
+	// own lock (which is never held while taking another, so it can't deadlock with the others)
+	if (world->broadphase == bp_AABBTree) {
+		world->cellsVisited = 0;
+		pthread_mutex_lock(&world->entityTreeLock);
+		_queryTreeInRange(world, newList);
+		pthread_mutex_unlock(&world->entityTreeLock);
+	} else {
+		cellStartX = _gridPosFromRealX(world, jamRendererGetCameraX() - world->procDistance);
+		cellStartY = _gridPosFromRealY(world, jamRendererGetCameraY() - world->procDistance);
+		cellEndX = _gridPosFromRealX(world, jamRendererGetCameraX() + jamRendererGetBufferWidth() + world->procDistance);
+		cellEndY = _gridPosFromRealY(world, jamRendererGetCameraY() + jamRendererGetBufferHeight() + world->procDistance);
+		world->cellsVisited = (cellEndX - cellStartX + 1) * (cellEndY - cellStartY + 1);
+
+		for (i = cellStartY; i <= cellEndY; i++) {
+			for (j = cellStartX; j <= cellEndX; j++) {
+				currentList = _getListAtPos(world, j, i);
+
+				// Call this one's frame update
+				for (k = 0; k < currentList->size; k++) {
+					if (currentList->entities[k] != NULL) {
+						exists = false;
+
+						// Make sure this isn't in the list
+						for (l = 0; l < newList->size; l++)
+							if (currentList->entities[k] == newList->entities[l])
+								exists = true;
+
+						if (!exists)
+							jamEntityListAdd(newList, currentList->entities[k]);
+					}
 				}
 			}
 		}
@@ -242,12 +439,19 @@ JamWorld* jamWorldCreate(int gridWidth, int gridHeight, int cellWidth, int cellH
 	// Allocate the map first, then the 2D grid, then the countless lists
 	if (world != NULL) {
 		world->entityGrid = (JamEntityList**)malloc(((gridWidth * gridHeight) + 1) * sizeof(JamEntityList));
+		world->cellBoxes = (JamWorldCellBoxes*)calloc((gridWidth * gridHeight) + 1, sizeof(JamWorldCellBoxes));
 		world->worldEntities = jamEntityListCreate();
 		world->gridWidth = gridWidth;
 		world->gridHeight = gridHeight;
 		world->cellWidth = cellWidth;
 		world->cellHeight = cellHeight;
 		world->cacheInRangeEntities = cache;
+		world->messageBus = _jamMessageBusCreate();
+		world->contacts = _jamContactCacheCreate();
+		world->broadphase = bp_Grid;
+		world->inRangeScratch = jamEntityListCreate();
+		if (world->messageBus == NULL || world->contacts == NULL || world->inRangeScratch == NULL)
+			error = true;
 
 		if (world->cacheInRangeEntities) {
 			world->inRangeCache = jamEntityListCreate();
@@ -263,8 +467,11 @@ JamWorld* jamWorldCreate(int gridWidth, int gridHeight, int cellWidth, int cellH
 		pthread_mutexattr_init(&t);
 		pthread_mutexattr_setprotocol(&t, PTHREAD_MUTEX_DEFAULT);
 		pthread_mutex_init(&world->entityAddingLock, &t);
+		pthread_mutexattr_init(&t);
+		pthread_mutexattr_setprotocol(&t, PTHREAD_MUTEX_DEFAULT);
+		pthread_mutex_init(&world->entityTreeLock, &t);
 
-		if (world->entityGrid != NULL) {
+		if (world->entityGrid != NULL && world->cellBoxes != NULL) {
 			for (i = 0; i < (gridWidth * gridHeight) + 1; i++) {
 				world->entityGrid[i] = jamEntityListCreate();
 				if (world->entityGrid[i] == NULL)
@@ -285,16 +492,64 @@ JamWorld* jamWorldCreate(int gridWidth, int gridHeight, int cellWidth, int cellH
 }
 ///////////////////////////////////////////////////////
 
+///////////////////////////////////////////////////////
+int _jamWorldEntityCells(JamWorld* world, JamEntity* ent, double x, double y, int* cells) {
+	int corners[4];
+	int count = 0;
+	int i;
+
+	corners[0] = _gridPosFromCoords(world, jamEntityVisibleX1(ent, x), jamEntityVisibleY1(ent, y));
+	corners[1] = _gridPosFromCoords(world, jamEntityVisibleX2(ent, x), jamEntityVisibleY1(ent, y));
+	corners[2] = _gridPosFromCoords(world, jamEntityVisibleX1(ent, x), jamEntityVisibleY2(ent, y));
+	corners[3] = _gridPosFromCoords(world, jamEntityVisibleX2(ent, x), jamEntityVisibleY2(ent, y));
+
+	// Small entities are usually in the same cell 4 times over
+	for (i = 0; i < 4; i++)
+		if ((count < 1 || corners[i] != cells[0]) && (count < 2 || corners[i] != cells[1]) && (count < 3 || corners[i] != cells[2]))
+			cells[count++] = corners[i];
+
+	return count;
+}
+///////////////////////////////////////////////////////
+
+/// \brief Where jamWorldEntityCollision is at while it walks a world's tree
+typedef struct {
+	JamEntity* ent; ///< Entity looking for collisions
+	double x;       ///< Where ent is being checked at
+	double y;       ///< Where ent is being checked at
+	int skip;       ///< Candidates already gone through by earlier calls
+	int seen;       ///< Candidates gone through so far
+	JamEntity* hit; ///< What ent collides with, if anything
+} _JamTreeCollision;
+
+/// \brief Checks one entity the tree found against the one looking for collisions
+static bool _treeCollision(void* data, void* userData) {
+	JamEntity* other = data;
+	_JamTreeCollision* query = userData;
+
+	if (query->seen++ < query->skip)
+		return true;
+
+	if (other != query->ent && (query->ent->collisionMask & other->collisionLayer) != 0 &&
+		jamEntityCheckCollision(query->x, query->y, query->ent, other)) {
+		query->hit = other;
+		return false;
+	}
+
+	return true;
+}
+
 ///////////////////////////////////////////////////////
 /*********How this function works
  * 1. Locate the 4 cells ent would hypothetically be in at the given x/y coords
  * 2. For each of the 4 cells, check each entity in them for a collision against ent
  * 3. As soon as a collision is found, we can stop searching and just return that one
+ * With the AABB tree, everything whose box overlaps ent's is checked instead of the 4 cells
  */
 JamEntity* jamWorldEntityCollision(JamWorld* world, JamEntity* ent, double x, double y) {
-	static JamEntity* rememberedEnt = NULL;
-	static int listPos = 0;
-	static int corner = 0;
+	static _Thread_local JamEntity* rememberedEnt = NULL;
+	static _Thread_local int listPos = 0;
+	static _Thread_local int corner = 0;
 
 	if (rememberedEnt != ent) {
 		rememberedEnt = ent;
@@ -303,25 +558,54 @@ JamEntity* jamWorldEntityCollision(JamWorld* world, JamEntity* ent, double x, do
 	}
 
 	JamEntity* returnEnt = NULL;
+	JamEntityList* list;
+	JamWorldCellBoxes* cellBoxes;
 	int cells[4];
-	int i, j;
-
-	if (ent != NULL && world != NULL) {
-		cells[0] = _gridPosFromCoords(world, jamEntityVisibleX1(ent, x), jamEntityVisibleY1(ent, y));
-		cells[1] = _gridPosFromCoords(world, jamEntityVisibleX2(ent, x), jamEntityVisibleY1(ent, y));
-		cells[2] = _gridPosFromCoords(world, jamEntityVisibleX1(ent, x), jamEntityVisibleY2(ent, y));
-		cells[3] = _gridPosFromCoords(world, jamEntityVisibleX2(ent, x), jamEntityVisibleY2(ent, y));
-
-		for (i = corner; i < 4 && returnEnt == NULL; i++) {
-			for (j = listPos; j < world->entityGrid[cells[i]]->size && returnEnt == NULL; j++) {
-				if (world->entityGrid[cells[i]]->entities[j] != NULL &&
-					world->entityGrid[cells[i]]->entities[j] != ent &&
-					jamEntityCheckCollision(x, y, ent, world->entityGrid[cells[i]]->entities[j])) {
-					returnEnt = world->entityGrid[cells[i]]->entities[j];
-					listPos = j + 1;
-					corner = i;
+	uint32 hits[COLLISION_BATCH_SIZE / 32];
+	double qx1, qy1, qx2, qy2;
+	uint32 start, size, k;
+	int i, cellCount;
+	_JamTreeCollision treeQuery;
+
+	if (ent != NULL && world != NULL && world->broadphase == bp_AABBTree) {
+		// The tree is walked in the same order every time, so pick up after the last one returned
+		treeQuery.ent = ent;
+		treeQuery.x = x;
+		treeQuery.y = y;
+		treeQuery.skip = listPos;
+		treeQuery.seen = 0;
+		treeQuery.hit = NULL;
+		jamAABBTreeQuery(world->entityTree, jamEntityVisibleX1(ent, x), jamEntityVisibleY1(ent, y),
+						 jamEntityVisibleX2(ent, x), jamEntityVisibleY2(ent, y), _treeCollision, &treeQuery);
+		returnEnt = treeQuery.hit;
+		listPos = treeQuery.seen;
+	} else if (ent != NULL && world != NULL) {
+		cellCount = _jamWorldEntityCells(world, ent, x, y, cells);
+		_jamEntityHitboxBounds(ent, x, y, &qx1, &qy1, &qx2, &qy2);
+
+		for (i = corner; i < cellCount && returnEnt == NULL; i++) {
+			list = world->entityGrid[cells[i]];
+			cellBoxes = &world->cellBoxes[cells[i]];
+			size = list->size < cellBoxes->capacity ? list->size : cellBoxes->capacity;
+
+			// The cell's boxes are already packed a chunk at a time, so only entities whose boxes overlap are touched
+			for (start = (uint32)listPos - ((uint32)listPos % COLLISION_BATCH_SIZE); start < size && returnEnt == NULL; start += COLLISION_BATCH_SIZE) {
+				if (jamHitboxBatchAABB((float)qx1, (float)qy1, (float)qx2, (float)qy2, cellBoxes->boxes + start * 4, COLLISION_BATCH_SIZE, hits) > 0) {
+					for (k = start < (uint32)listPos ? (uint32)listPos - start : 0; k < COLLISION_BATCH_SIZE && start + k < size && returnEnt == NULL; k++) {
+						if ((hits[k / 32] & ((uint32)1 << (k % 32))) &&
+							list->entities[start + k] != NULL && list->entities[start + k] != ent &&
+							(ent->collisionMask & list->entities[start + k]->collisionLayer) != 0 &&
+							jamEntityCheckCollision(x, y, ent, list->entities[start + k])) {
+							returnEnt = list->entities[start + k];
+							listPos = start + k + 1;
+							corner = i;
+						}
+					}
 				}
 			}
+
+			if (returnEnt == NULL)
+				listPos = 0;
 		}
 	} else {
 		if (world == NULL)
@@ -396,6 +680,54 @@ JamEntity* jamWorldFindEntity(JamWorld *world, int id) {
 }
 ///////////////////////////////////////////////////////
 
+///////////////////////////////////////////////////////
+JamEntity* jamWorldFindEntityHandle(JamWorld *world, JamEntityHandle handle) {
+	JamEntity* ent = NULL;
+
+	if (world != NULL) {
+		if (handle.id >= 0 && handle.id < world->worldEntities->size)
+			ent = world->worldEntities->entities[handle.id];
+		if (ent != NULL && ent->generation != handle.generation)
+			ent = NULL;
+	} else {
+		jSetError(ERROR_NULL_POINTER, "World does not exist (jamWorldFindEntityHandle)");
+	}
+
+	return ent;
+}
+///////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////
+void jamWorldSpawnEntity(JamWorld *world, JamEntity *entity) {
+	JamEntity* head;
+
+	if (world != NULL && entity != NULL) {
+		// Push it onto the front of the queue, retrying if another thread got there first
+		head = __atomic_load_n(&world->spawnQueue, __ATOMIC_RELAXED);
+		do {
+			entity->spawnNext = head;
+		} while (!__atomic_compare_exchange_n(&world->spawnQueue, &head, entity, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	} else {
+		if (world == NULL)
+			jSetError(ERROR_NULL_POINTER, "JamWorld does not exist (jamWorldSpawnEntity)");
+		if (entity == NULL)
+			jSetError(ERROR_NULL_POINTER, "JamEntity does not exist (jamWorldSpawnEntity)");
+	}
+}
+///////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////
+void jamWorldFlushSpawns(JamWorld *world) {
+	if (world != NULL) {
+		pthread_mutex_lock(&world->entityAddingLock);
+		_addSpawnedEntities(world);
+		pthread_mutex_unlock(&world->entityAddingLock);
+	} else {
+		jSetError(ERROR_NULL_POINTER, "JamWorld does not exist (jamWorldFlushSpawns)");
+	}
+}
+///////////////////////////////////////////////////////
+
 ///////////////////////////////////////////////////////
 int jamWorldFindEntityType(JamWorld* world, uint32 type) {
 	int i;
@@ -420,13 +752,25 @@ void jamWorldDestroyEntity(JamEntity* entity){
 
 ///////////////////////////////////////////////////////
 void jamWorldProcFrame(JamWorld *world) {
-	int i, j, k, l;
+	int i, j, k;
 	int cellStartX, cellStartY;
 	int cellEndX, cellEndY;
 	JamEntityList* currentList;
-	JamEntity* ent, *tempEnt;
+	JamEntity* ent;
 
 	if (world != NULL) {
+		// Bring in anything that was spawned since last frame, unless the caching thread has the map
+		if (__atomic_load_n(&world->spawnQueue, __ATOMIC_RELAXED) != NULL && pthread_mutex_trylock(&world->entityAddingLock) == 0) {
+			_addSpawnedEntities(world);
+			pthread_mutex_unlock(&world->entityAddingLock);
+		}
+
+		// Every so often, make sure the spatial map still suits the world's entities
+		if (world->autoTuneGrid && world->broadphase == bp_Grid && ++world->framesSinceTune >= GRID_TUNE_INTERVAL) {
+			world->framesSinceTune = 0;
+			jamWorldAutoTuneGrid(world);
+		}
+
 		// If we're using the in-range cache we must lock the cache
 		if (world->cacheInRangeEntities) {
 			// If the cache changes while we're using it here we're most likely getting a segfault
@@ -437,10 +781,7 @@ void jamWorldProcFrame(JamWorld *world) {
 				if (world->inRangeCache->entities[i] != NULL && !world->inRangeCache->entities[i]->destroy)
 					_updateEntity(world, world->inRangeCache->entities[i]);
 				else if (world->inRangeCache->entities[i] != NULL) { // Delet entity
-					for (j = 0; j < world->inRangeCache->entities[i]->cells; j++)
-						world->entityGrid[world->inRangeCache->entities[i]->cellsIn[j]]->entities[world->inRangeCache->entities[i]->cellsLoc[j]] = NULL;
-					world->worldEntities->entities[world->inRangeCache->entities[i]->id] = NULL;
-					jamEntityFree(world->inRangeCache->entities[i], false, false, false);
+					_deleteEntity(world, world->inRangeCache->entities[i]);
 					world->inRangeCache->entities[i] = NULL;
 				}
 			}
@@ -450,6 +791,27 @@ void jamWorldProcFrame(JamWorld *world) {
 				_drawEntity(world, world->inRangeCache->entities[i]);
 
 			pthread_mutex_unlock(&world->entityCacheMutex);
+		} else if (world->broadphase == bp_AABBTree) {
+			// Same as the cache, but the in-range entities are found right now
+			world->inRangeScratch->size = 0;
+			world->cellsVisited = 0;
+			_queryTreeInRange(world, world->inRangeScratch);
+
+			for (i = 0; i < world->inRangeScratch->size; i++) {
+				ent = world->inRangeScratch->entities[i];
+				if (!ent->destroy) {
+					ent->proc = false;
+					ent->draw = false;
+				} else { // Delet entity
+					_deleteEntity(world, ent);
+					world->inRangeScratch->entities[i] = NULL;
+				}
+			}
+
+			for (i = 0; i < world->inRangeScratch->size; i++)
+				_updateEntity(world, world->inRangeScratch->entities[i]);
+			for (i = 0; i < world->inRangeScratch->size; i++)
+				_drawEntity(world, world->inRangeScratch->entities[i]);
 		} else {
 			// In this case, we are to just go through the space map and find all entities in the viewport
 			// Calculate the starting and ending cells
@@ -457,6 +819,7 @@ void jamWorldProcFrame(JamWorld *world) {
 			cellStartY = _gridPosFromRealY(world, jamRendererGetCameraY() - world->procDistance);
 			cellEndX = _gridPosFromRealX(world, jamRendererGetCameraX() + jamRendererGetBufferWidth() + world->procDistance);
 			cellEndY = _gridPosFromRealY(world, jamRendererGetCameraY() + jamRendererGetBufferHeight() + world->procDistance);
+			world->cellsVisited = (cellEndX - cellStartX + 1) * (cellEndY - cellStartY + 1);
 
 			// Tell them they haven't been processed yet
 			for (i = cellStartY; i <= cellEndY; i++) {
@@ -467,11 +830,7 @@ void jamWorldProcFrame(JamWorld *world) {
 							currentList->entities[k]->proc = false;
 							currentList->entities[k]->draw = false;
 						} else if (currentList->entities[k] != NULL) { // Delet entity
-							tempEnt = currentList->entities[k];
-							for (l = 0; l < tempEnt->cells; l++)
-								world->entityGrid[tempEnt->cellsIn[l]]->entities[tempEnt->cellsLoc[l]] = NULL;
-							world->worldEntities->entities[tempEnt->id] = NULL;
-							jamEntityFree(tempEnt, false, false, false);
+							_deleteEntity(world, currentList->entities[k]);
 						}
 					}
 				}
@@ -491,6 +850,15 @@ void jamWorldProcFrame(JamWorld *world) {
 				}
 			}
 		}
+
+		// Every entity has moved, so work out who is touching who
+		jamWorldUpdateContacts(world);
+
+		// Every entity has had its turn, so now they can read their mail
+		jamWorldDeliverMessages(world);
+
+		if (world->drawGridHeatmap)
+			jamDrawWorldGridHeatmap(world, 128);
 	} else {
 		jSetError(ERROR_NULL_POINTER, "JamWorld does not exist (jamWorldProcFrame)");
 	}
@@ -517,12 +885,317 @@ void jamWorldFilter(JamWorld *world) {
 }
 ///////////////////////////////////////////////////////
 
+///////////////////////////////////////////////////////
+void jamWorldGetGridStats(JamWorld* world, JamWorldGridStats* stats) {
+	int i, j, cellCount;
+	int multiCell = 0;
+	int inCell;
+	JamEntity* ent;
+
+	if (world != NULL && stats != NULL) {
+		memset(stats, 0, sizeof(JamWorldGridStats));
+		cellCount = world->gridWidth * world->gridHeight;
+
+		// First the entities themselves
+		for (i = 0; i < world->worldEntities->size; i++) {
+			ent = world->worldEntities->entities[i];
+			if (ent != NULL) {
+				stats->entities++;
+				stats->averageWidth += jamEntityVisibleX2(ent, ent->x) - jamEntityVisibleX1(ent, ent->x);
+				stats->averageHeight += jamEntityVisibleY2(ent, ent->y) - jamEntityVisibleY1(ent, ent->y);
+				if (ent->cells > 1)
+					multiCell++;
+			}
+		}
+
+		// Then how they sit in the grid
+		for (i = 0; i < cellCount + 1; i++) {
+			inCell = 0;
+			for (j = 0; j < world->entityGrid[i]->size; j++)
+				if (world->entityGrid[i]->entities[j] != NULL)
+					inCell++;
+			stats->totalSize += world->entityGrid[i]->size;
+			stats->totalCapacity += world->entityGrid[i]->capacity;
+			stats->totalHoles += world->entityGrid[i]->size - inCell;
+
+			if (i == cellCount) {
+				stats->overflowEntities = inCell;
+			} else if (inCell > 0) {
+				stats->occupiedCells++;
+				stats->entitiesPerCell += inCell;
+				if (inCell > stats->maxEntitiesInCell)
+					stats->maxEntitiesInCell = inCell;
+			}
+		}
+
+		stats->cellsVisited = world->cellsVisited;
+		if (stats->occupiedCells > 0)
+			stats->entitiesPerCell /= stats->occupiedCells;
+		if (stats->entities > 0) {
+			stats->multiCellRatio = (double)multiCell / stats->entities;
+			stats->averageWidth /= stats->entities;
+			stats->averageHeight /= stats->entities;
+		}
+
+		// Twice the average size keeps most entities in 1-2 cells without crowding each one
+		stats->suggestedCellWidth = world->cellWidth;
+		stats->suggestedCellHeight = world->cellHeight;
+		if (stats->averageWidth >= 1)
+			stats->suggestedCellWidth = (int)ceil((stats->averageWidth * 2) / GRID_TUNE_MIN_CELL) * GRID_TUNE_MIN_CELL;
+		if (stats->averageHeight >= 1)
+			stats->suggestedCellHeight = (int)ceil((stats->averageHeight * 2) / GRID_TUNE_MIN_CELL) * GRID_TUNE_MIN_CELL;
+	} else {
+		if (world == NULL)
+			jSetError(ERROR_NULL_POINTER, "World does not exist (jamWorldGetGridStats)");
+		if (stats == NULL)
+			jSetError(ERROR_NULL_POINTER, "Stats do not exist (jamWorldGetGridStats)");
+	}
+}
+///////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////
+void jamWorldGetCellStats(JamWorld* world, int cellX, int cellY, JamWorldCellStats* stats) {
+	JamEntityList* list;
+	int i;
+
+	if (world != NULL && stats != NULL) {
+		list = _getListAtPos(world, cellX, cellY);
+		stats->entities = 0;
+		stats->size = list->size;
+		stats->capacity = list->capacity;
+		for (i = 0; i < list->size; i++)
+			if (list->entities[i] != NULL)
+				stats->entities++;
+		stats->holes = stats->size - stats->entities;
+	} else {
+		if (world == NULL)
+			jSetError(ERROR_NULL_POINTER, "World does not exist (jamWorldGetCellStats)");
+		if (stats == NULL)
+			jSetError(ERROR_NULL_POINTER, "Stats do not exist (jamWorldGetCellStats)");
+	}
+}
+///////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////
+void jamDrawWorldGridHeatmap(JamWorld* world, uint8 alpha) {
+	int cellStartX, cellStartY, cellEndX, cellEndY;
+	int i, j, k, count;
+	int busiest = 1;
+	double heat;
+	JamEntityList* list;
+	uint8 oR, oG, oB, oA;
+
+	if (world != NULL) {
+		// Only the cells in the viewport, clamped to the grid since the overflow cell has no place to be drawn
+		cellStartX = (int)clamp(_gridPosFromRealX(world, jamRendererGetCameraX()), 0, world->gridWidth - 1);
+		cellStartY = (int)clamp(_gridPosFromRealY(world, jamRendererGetCameraY()), 0, world->gridHeight - 1);
+		cellEndX = (int)clamp(_gridPosFromRealX(world, jamRendererGetCameraX() + jamRendererGetBufferWidth()), 0, world->gridWidth - 1);
+		cellEndY = (int)clamp(_gridPosFromRealY(world, jamRendererGetCameraY() + jamRendererGetBufferHeight()), 0, world->gridHeight - 1);
+		jamDrawGetColour(&oR, &oG, &oB, &oA);
+
+		// Find the busiest cell first so the colours are relative to whats on screen
+		for (i = cellStartY; i <= cellEndY; i++) {
+			for (j = cellStartX; j <= cellEndX; j++) {
+				list = world->entityGrid[(i * world->gridWidth) + j];
+				count = 0;
+				for (k = 0; k < list->size; k++)
+					if (list->entities[k] != NULL)
+						count++;
+				if (count > busiest)
+					busiest = count;
+			}
+		}
+
+		for (i = cellStartY; i <= cellEndY; i++) {
+			for (j = cellStartX; j <= cellEndX; j++) {
+				list = world->entityGrid[(i * world->gridWidth) + j];
+				count = 0;
+				for (k = 0; k < list->size; k++)
+					if (list->entities[k] != NULL)
+						count++;
+
+				if (count > 0) {
+					heat = (double)count / busiest;
+					jamDrawSetColour((uint8)(255 * heat), 0, (uint8)(255 * (1 - heat)), alpha);
+					jamDrawRectangleFilled(j * world->cellWidth, i * world->cellHeight, world->cellWidth, world->cellHeight);
+				}
+				jamDrawSetColour(255, 255, 255, alpha);
+				jamDrawRectangle(j * world->cellWidth, i * world->cellHeight, world->cellWidth, world->cellHeight);
+			}
+		}
+
+		jamDrawSetColour(oR, oG, oB, oA);
+	} else {
+		jSetError(ERROR_NULL_POINTER, "World does not exist (jamDrawWorldGridHeatmap)");
+	}
+}
+///////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////
+void jamWorldResizeGrid(JamWorld* world, int cellWidth, int cellHeight) {
+	JamEntityList** newGrid;
+	JamEntityList** oldGrid;
+	JamWorldCellBoxes* newBoxes;
+	int oldCellCount, newCellCount;
+	double extentX, extentY;
+	int gridWidth, gridHeight;
+	bool error = false;
+	JamEntity* ent;
+	int i;
+
+	if (world != NULL && cellWidth > 0 && cellHeight > 0) {
+		// Nothing can be added or filtered while the grid is being swapped out
+		pthread_mutex_lock(&world->entityAddingLock);
+		pthread_mutex_lock(&world->entityCacheMutex);
+
+		// The new grid must cover the old one plus anything that fell out of it
+		extentX = (double)world->gridWidth * world->cellWidth;
+		extentY = (double)world->gridHeight * world->cellHeight;
+		for (i = 0; i < world->worldEntities->size; i++) {
+			ent = world->worldEntities->entities[i];
+			if (ent != NULL) {
+				if (jamEntityVisibleX2(ent, ent->x) > extentX)
+					extentX = jamEntityVisibleX2(ent, ent->x);
+				if (jamEntityVisibleY2(ent, ent->y) > extentY)
+					extentY = jamEntityVisibleY2(ent, ent->y);
+			}
+		}
+		gridWidth = (int)ceil(extentX / cellWidth);
+		gridHeight = (int)ceil(extentY / cellHeight);
+		newCellCount = (gridWidth * gridHeight) + 1;
+		newGrid = (JamEntityList**)malloc(newCellCount * sizeof(JamEntityList*));
+		newBoxes = (JamWorldCellBoxes*)calloc(newCellCount, sizeof(JamWorldCellBoxes));
+
+		if (newGrid != NULL && newBoxes != NULL) {
+			for (i = 0; i < newCellCount; i++) {
+				newGrid[i] = jamEntityListCreate();
+				if (newGrid[i] == NULL)
+					error = true;
+			}
+
+			if (!error) {
+				oldGrid = world->entityGrid;
+				oldCellCount = (world->gridWidth * world->gridHeight) + 1;
+				_freeCellBoxes(world->cellBoxes, oldCellCount);
+				world->entityGrid = newGrid;
+				world->cellBoxes = newBoxes;
+				world->gridWidth = gridWidth;
+				world->gridHeight = gridHeight;
+				world->cellWidth = cellWidth;
+				world->cellHeight = cellHeight;
+
+				// One pass to move every entity into the new grid
+				for (i = 0; i < world->worldEntities->size; i++)
+					if (world->worldEntities->entities[i] != NULL)
+						_placeEntInMap(world, world->worldEntities->entities[i]);
+
+				for (i = 0; i < oldCellCount; i++)
+					jamEntityListFree(oldGrid[i], false);
+				free(oldGrid);
+			} else {
+				for (i = 0; i < newCellCount; i++)
+					jamEntityListFree(newGrid[i], false);
+				free(newGrid);
+				free(newBoxes);
+				jSetError(ERROR_ALLOC_FAILED, "Failed to create the new spatial map's cells (jamWorldResizeGrid)");
+			}
+		} else {
+			free(newGrid);
+			free(newBoxes);
+			jSetError(ERROR_ALLOC_FAILED, "Failed to allocate new spatial map (jamWorldResizeGrid)");
+		}
+
+		pthread_mutex_unlock(&world->entityCacheMutex);
+		pthread_mutex_unlock(&world->entityAddingLock);
+	} else {
+		if (world == NULL)
+			jSetError(ERROR_NULL_POINTER, "World does not exist (jamWorldResizeGrid)");
+		else
+			jSetError(ERROR_OUT_OF_BOUNDS, "Invalid cell size %ix%i (jamWorldResizeGrid)", cellWidth, cellHeight);
+	}
+}
+///////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////
+void jamWorldSetBroadphase(JamWorld* world, JamBroadphaseType broadphase) {
+	int i;
+
+	if (world != NULL) {
+		if (world->broadphase != broadphase) {
+			// Nothing can be added or filtered while entities are being moved over
+			pthread_mutex_lock(&world->entityAddingLock);
+			pthread_mutex_lock(&world->entityCacheMutex);
+
+			if (broadphase == bp_AABBTree && world->entityTree == NULL)
+				world->entityTree = jamAABBTreeCreate(AABB_TREE_MARGIN);
+
+			if (broadphase != bp_AABBTree || world->entityTree != NULL) {
+				// Entities leave the old one before the switch and join the new one after
+				for (i = 0; i < world->worldEntities->size; i++)
+					if (world->worldEntities->entities[i] != NULL)
+						_removeEntFromMap(world, world->worldEntities->entities[i]);
+				world->broadphase = broadphase;
+				for (i = 0; i < world->worldEntities->size; i++)
+					if (world->worldEntities->entities[i] != NULL)
+						_placeEntInMap(world, world->worldEntities->entities[i]);
+
+				// Whichever isn't in use anymore is left empty
+				if (broadphase == bp_AABBTree) {
+					for (i = 0; i < (world->gridWidth * world->gridHeight) + 1; i++)
+						jamEntityListEmpty(world->entityGrid[i], false);
+				} else {
+					jamAABBTreeFree(world->entityTree);
+					world->entityTree = NULL;
+				}
+			}
+
+			pthread_mutex_unlock(&world->entityCacheMutex);
+			pthread_mutex_unlock(&world->entityAddingLock);
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "World does not exist (jamWorldSetBroadphase)");
+	}
+}
+///////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////
+bool jamWorldAutoTuneGrid(JamWorld* world) {
+	JamWorldGridStats stats;
+	bool rebuild = false;
+
+	if (world != NULL) {
+		jamWorldGetGridStats(world, &stats);
+
+		// Only bother if the new size is meaningfully different (25%)
+		if (stats.entities > 0 && world->broadphase == bp_Grid &&
+			(abs(stats.suggestedCellWidth - world->cellWidth) * 4 > world->cellWidth ||
+			 abs(stats.suggestedCellHeight - world->cellHeight) * 4 > world->cellHeight)) {
+			jamWorldResizeGrid(world, stats.suggestedCellWidth, stats.suggestedCellHeight);
+			rebuild = true;
+		}
+	} else {
+		jSetError(ERROR_NULL_POINTER, "World does not exist (jamWorldAutoTuneGrid)");
+	}
+
+	return rebuild;
+}
+///////////////////////////////////////////////////////
+
 ///////////////////////////////////////////////////////
 void jamWorldFree(JamWorld *world) {
+	JamEntity* next;
 	int i;
 	if (world != NULL) {
+		// Entities that never made it into the world are still the world's to free
+		while (world->spawnQueue != NULL) {
+			next = world->spawnQueue->spawnNext;
+			jamEntityFree(world->spawnQueue, false, false, false);
+			world->spawnQueue = next;
+		}
+
 		for (i = 0; i < (world->gridWidth * world->gridHeight) + 1; i++)
 			jamEntityListFree(world->entityGrid[i], false);
+		_freeCellBoxes(world->cellBoxes, (world->gridWidth * world->gridHeight) + 1);
 		for (i = 0; i < MAX_TILEMAPS; i++)
 			jamTileMapFree(world->worldMaps[i]);
 		for (i = 0; i < world->worldEntities->size; i++)
@@ -532,6 +1205,11 @@ void jamWorldFree(JamWorld *world) {
 				(*world->worldEntities->entities[i]->behaviour->onDestruction)(world, world->worldEntities->entities[i]);
 
 		free(world->entityGrid);
+		jamAABBTreeFree(world->entityTree);
+		jamEntityListFree(world->inRangeScratch, false);
+		_jamComponentFreeTables(world);
+		_jamMessageBusFree(world->messageBus);
+		_jamContactCacheFree(world->contacts);
 		jamEntityListFree(world->inRangeCache, false);
 		jamEntityListFree(world->worldEntities, true);
 		free(world);
@@ -21,6 +21,9 @@
 #define SCREEN_HEIGHT GAME_HEIGHT * VIEW_MULTIPLIER
 #define BLOCK_WIDTH 16
 #define BLOCK_HEIGHT 16
+#define BENCHMARK_POLYGONS 512
+#define BENCHMARK_ENTITIES 2000
+#define BENCHMARK_FRAMES 60
 
 JamAssetHandler* gHandler;
 
@@ -35,10 +38,24 @@ void onEnemyFrame(JamWorld* world, JamEntity* self) {
 								   (int) self->y + 17))
 		self->hSpeed = -self->hSpeed;
 
+	self->x += self->hSpeed * jamRendererGetDelta();
+
+	// Enemies that walk into each other get pushed back out in one go (instead of stepping back a pixel at
+	// a time until they stop colliding) and turn around if the push is against the way they're walking
+	JamCollisionInfo info;
+	double pushX = 0;
+	JamEntity* other = jamWorldEntityCollision(world, self, self->x, self->y);
+	while (other != NULL) {
+		if (other->behaviour == self->behaviour && jamEntityCollisionInfo(self->x, self->y, self, other, &info))
+			pushX += info.normalX * info.depth;
+		other = jamWorldEntityCollision(world, self, self->x, self->y);
+	}
+	self->x += pushX;
+	if (pushX * self->hSpeed < 0)
+		self->hSpeed = -self->hSpeed;
+
 	// Make them face the direction they are walking in
 	self->scaleX = (float)sign(self->hSpeed);
-
-	self->x += self->hSpeed * jamRendererGetDelta();
 }
 
 void onPlayerFrame(JamWorld* world, JamEntity* self) {
@@ -61,22 +78,14 @@ void onPlayerFrame(JamWorld* world, JamEntity* self) {
 	// TESTING - check for world collisions and draw the entity should there be one
 	JamEntity* collEnt = jamWorldEntityCollision(world, self, self->x, self->y);
 
-	if (jamEntityTileMapCollision(self, world->worldMaps[0], self->x + self->hSpeed, self->y)) {
-		self->x -= sign(self->hSpeed);
-		self->x = round(self->x);
-		while (!jamEntityTileMapCollision(self, world->worldMaps[0], self->x + sign(self->hSpeed), self->y))
-			self->x += sign(self->hSpeed);
+	// Sweep each axis on its own so the player slides along walls
+	JamTileSweep sweep;
+	if (jamEntityTileMapSweep(self, world->worldMaps[0], self->hSpeed * jamRendererGetDelta(), 0, &sweep))
 		self->hSpeed = 0;
-	}
-	if (jamEntityTileMapCollision(self, world->worldMaps[0], self->x, self->y + self->vSpeed)) {
-		self->y -= sign(self->vSpeed);
-		self->y = round(self->y);
-		while (!jamEntityTileMapCollision(self, world->worldMaps[0], self->x, self->y + sign(self->vSpeed)))
-			self->y += sign(self->vSpeed);
+	self->x = sweep.x;
+	if (jamEntityTileMapSweep(self, world->worldMaps[0], 0, self->vSpeed * jamRendererGetDelta(), &sweep))
 		self->vSpeed = 0;
-	}
-	self->x += self->hSpeed * jamRendererGetDelta();
-	self->y += self->vSpeed * jamRendererGetDelta();
+	self->y = sweep.y;
 
 	jamAudioSetListenerPosition((float)self->x, (float)self->y, 0);
 
@@ -220,7 +229,7 @@ bool runGame() {
 				// Draw the game world
 				for (i = 0; i < MAX_TILEMAPS; i++)
 					if (gameWorld->worldMaps[i] != NULL)
-						jamDrawTileMap(gameWorld->worldMaps[i], 0, 0, 0, 0, 0, 0);
+						jamDrawTileMapCached(gameWorld->worldMaps[i], 0, 0);
 				jamWorldProcFrame(gameWorld);
 
 				// Debug
@@ -255,6 +264,166 @@ void onDraw(JamWorld* world, JamEntity* self) {
 	jamDrawEntity(self);
 }
 
+// Makes a random convex polygon (up to 16 vertices) by walking around a circle
+JamPolygon* createRandomPolygon(int vertices, double radius) {
+	JamPolygon* poly = jamPolygonCreate(0);
+	double angles[16];
+	double temp;
+	int i, j;
+
+	for (i = 0; i < vertices; i++)
+		angles[i] = ((double)rand() / RAND_MAX) * 6.283185;
+	for (i = 0; i < vertices; i++)
+		for (j = i + 1; j < vertices; j++)
+			if (angles[j] < angles[i]) {
+				temp = angles[i];
+				angles[i] = angles[j];
+				angles[j] = temp;
+			}
+	for (i = 0; i < vertices; i++)
+		jamPolygonAddVertex(poly, cos(angles[i]) * radius, sin(angles[i]) * radius);
+
+	return poly;
+}
+
+// The slope-based SAT check polygons used before they cached their normals, only kept to benchmark against
+// (it projects onto y - m * x, so it divides by zero on vertical edges and isn't always right)
+bool oldSatCheckGap(JamPolygon* p1, JamPolygon* p2, double x1, double y1, double x2, double y2) {
+	unsigned int i, j;
+	double slope, currentVal;
+	double min1 = 0, min2 = 0, max1 = 0, max2 = 0;
+
+	for (i = 0; i < p1->vertices; i++) {
+		if (i == 0)
+			slope = (p1->yVerts[0] - p1->yVerts[p1->vertices - 1]) / (p1->xVerts[0] - p1->xVerts[p1->vertices - 1]);
+		else
+			slope = (p1->yVerts[i] - p1->yVerts[i - 1]) / (p1->xVerts[i] - p1->xVerts[i - 1]);
+
+		for (j = 0; j < p1->vertices; j++) {
+			currentVal = (p1->yVerts[j] + y1) - slope * (p1->xVerts[j] + x1);
+			max1 = j == 0 || currentVal > max1 ? currentVal : max1;
+			min1 = j == 0 || currentVal < min1 ? currentVal : min1;
+		}
+		for (j = 0; j < p2->vertices; j++) {
+			currentVal = (p2->yVerts[j] + y2) - slope * (p2->xVerts[j] + x2);
+			max2 = j == 0 || currentVal > max2 ? currentVal : max2;
+			min2 = j == 0 || currentVal < min2 ? currentVal : min2;
+		}
+
+		if (max1 < min2 || max2 < min1)
+			return true;
+	}
+
+	return false;
+}
+
+// Checks every polygon against every other polygon with both the old check and jamHitboxPolygonCollision
+// and prints how many checks per second each manages
+void benchmarkPolygonCollisions(double spread) {
+	const int count = BENCHMARK_POLYGONS;
+	JamPolygon* polygons[BENCHMARK_POLYGONS];
+	double xs[BENCHMARK_POLYGONS];
+	double ys[BENCHMARK_POLYGONS];
+	JamProfile profile;
+	int i, j, hits = 0, oldHits = 0;
+
+	for (i = 0; i < count; i++) {
+		polygons[i] = createRandomPolygon(8, 16);
+		xs[i] = ((double)rand() / RAND_MAX) * spread;
+		ys[i] = ((double)rand() / RAND_MAX) * spread;
+	}
+
+	profile = jamProfileStart();
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < count; j++)
+			oldHits += !oldSatCheckGap(polygons[i], polygons[j], xs[i], ys[i], xs[j], ys[j]) &&
+					   !oldSatCheckGap(polygons[j], polygons[i], xs[j], ys[j], xs[i], ys[i]);
+		jamProfileTick(&profile);
+	}
+
+	printf("Polygon-to-polygon before (%ix%i, spread %.0f): %.2f million checks/second, %i hits\n", count, count, spread,
+		   (count / jamProfileGetMilliseconds(&profile)) / 1000, oldHits);
+
+	profile = jamProfileStart();
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < count; j++)
+			hits += jamHitboxPolygonCollision(polygons[i], polygons[j], xs[i], ys[i], xs[j], ys[j]);
+		jamProfileTick(&profile);
+	}
+
+	printf("Polygon-to-polygon after (%ix%i, spread %.0f): %.2f million checks/second, %i hits\n", count, count, spread,
+		   (count / jamProfileGetMilliseconds(&profile)) / 1000, hits);
+
+	for (i = 0; i < count; i++)
+		jamPolygonFree(polygons[i]);
+}
+
+void onBenchmarkFrame(JamWorld* world, JamEntity* self) {
+	self->x += 2.0f - ((double)rand() / RAND_MAX * 4.0f);
+	self->y += 2.0f - ((double)rand() / RAND_MAX * 4.0f);
+}
+
+// Drawing isn't what's being measured
+void onBenchmarkDraw(JamWorld* world, JamEntity* self) {}
+
+// Fills a world with jittering entities (hugeChance of them boss/platform sized, the rest bullet sized)
+// and times whole frames as well as looping jamWorldEntityCollision for every entity
+void benchmarkBroadphase(JamBroadphaseType broadphase, double hugeChance) {
+	JamBehaviourMap* map = jamBehaviourMapCreate();
+	JamSprite* smallSprite = jamSpriteCreate(0, 0, false);
+	JamSprite* hugeSprite = jamSpriteCreate(0, 0, false);
+	JamHitbox* smallHitbox = jamHitboxCreate(ht_Rectangle, 0, 8, 8, NULL);
+	JamHitbox* hugeHitbox = jamHitboxCreate(ht_Rectangle, 0, 256, 96, NULL);
+	JamWorld* world = jamWorldCreate(64, 64, 64, 64, false);
+	JamProfile frameProfile;
+	JamProfile queryProfile;
+	JamEntity* ent;
+	bool huge;
+	int i, hits = 0;
+
+	smallSprite->width = 8;
+	smallSprite->height = 8;
+	hugeSprite->width = 256;
+	hugeSprite->height = 96;
+	jamBehaviourMapAdd(map, "BenchmarkBehaviour", NULL, NULL, onBenchmarkFrame, onBenchmarkDraw);
+	jamWorldSetBroadphase(world, broadphase);
+	world->procDistance = 64 * 64;
+
+	for (i = 0; i < BENCHMARK_ENTITIES; i++) {
+		huge = ((double)rand() / RAND_MAX) < hugeChance;
+		ent = jamEntityCreate(huge ? hugeSprite : smallSprite, huge ? hugeHitbox : smallHitbox,
+							  ((double)rand() / RAND_MAX) * 64 * 64, ((double)rand() / RAND_MAX) * 64 * 64, 0, 0,
+							  jamBehaviourMapGet(map, "BenchmarkBehaviour"));
+		jamWorldAddEntity(world, ent);
+	}
+
+	frameProfile = jamProfileStart();
+	for (i = 0; i < BENCHMARK_FRAMES; i++) {
+		jamWorldProcFrame(world);
+		jamProfileTick(&frameProfile);
+	}
+
+	queryProfile = jamProfileStart();
+	for (i = 0; i < world->worldEntities->size; i++) {
+		ent = world->worldEntities->entities[i];
+		if (ent != NULL)
+			while (jamWorldEntityCollision(world, ent, ent->x, ent->y) != NULL)
+				hits++;
+		jamProfileTick(&queryProfile);
+	}
+
+	printf("%s (%i entities, %.0f%% huge): %.3f ms/frame, %.2f microseconds/query, %i hits\n",
+		   broadphase == bp_Grid ? "Grid broadphase" : "AABB tree broadphase", BENCHMARK_ENTITIES, hugeChance * 100,
+		   jamProfileGetMilliseconds(&frameProfile), jamProfileGetMilliseconds(&queryProfile) * 1000, hits);
+
+	jamWorldFree(world);
+	jamBehaviourMapFree(map);
+	jamHitboxFree(smallHitbox);
+	jamHitboxFree(hugeHitbox);
+	jamSpriteFree(smallSprite, false, false);
+	jamSpriteFree(hugeSprite, false, false);
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////
 int main(int argc, char* argv[]) {
 	// Decide if we're in testing suite mode or not
@@ -278,7 +447,15 @@ int main(int argc, char* argv[]) {
 				run = runGame();
 		}
 	} else { // Test specific functionality of JamEngine
-		
+		srand(0);
+		benchmarkPolygonCollisions(40);
+		benchmarkPolygonCollisions(400);
+		benchmarkBroadphase(bp_Grid, 0);
+		benchmarkBroadphase(bp_AABBTree, 0);
+		benchmarkBroadphase(bp_Grid, 0.05);
+		benchmarkBroadphase(bp_AABBTree, 0.05);
+		benchmarkBroadphase(bp_Grid, 0.25);
+		benchmarkBroadphase(bp_AABBTree, 0.25);
 	}
 
 	jamRendererQuit();